@@ -0,0 +1,1115 @@
+#include "../src/shapes.h"
+#include "../src/ray.h"
+#include "../src/triangle_records.h"
+#include "../src/kernels.h"
+#include "../src/obj_loader.h"
+#include "../src/mesh_file.h"
+#include "../src/ply_loader.h"
+#include "../src/scene.h"
+#include "../src/framebuffer.h"
+#include "../src/thread_pool.h"
+#include "../src/sampler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#elif !defined(__linux__)
+#include <sys/resource.h>
+#endif
+////the loader that load_obj() replaces, for comparison////
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+///////////////////////////////////////////////////////////
+
+#define TRIANGLE_COUNT 1024
+#define RAY_COUNT 4096
+#define SEED 42
+#define TRACE_WIDTH 64
+#define TRACE_HEIGHT 48
+#define TRACE_SAMPLES 32
+#define OBJ_GRID_SIZE 512
+#define SCENE_SPHERE_COUNT 200000
+#define FRAMEBUFFER_SIZE 4096
+#define FRAMEBUFFER_TILE 64
+#define SAMPLER_SIZE 512
+#define SAMPLER_SAMPLES 32
+#define SAMPLER_BUCKETS 256
+#define MICRO_ROUNDS 9
+#define MICRO_PASSES 64
+#define MICRO_TRACE_RAYS 512
+
+/**
+	The test_ray struct holds the origin and the target of a benchmark ray.
+*/
+struct test_ray {
+	glm::vec3 m_origin;
+	glm::vec3 m_target;
+};
+
+/**
+	Generates random triangles of roughly 0.3 units inside the [-1, 1] cube.
+
+	@param gen the random number generator.
+	@return std::vector<triangle> the triangles.
+*/
+std::vector<triangle> random_triangles(std::mt19937& gen) {
+	std::uniform_real_distribution<float> center(-1.f, 1.f);
+	std::uniform_real_distribution<float> offset(-.15f, .15f);
+
+	std::vector<triangle> triangles;
+	for (unsigned int i = 0; i < TRIANGLE_COUNT; i++) {
+		glm::vec3 c(center(gen), center(gen), center(gen));
+		glm::vec3 pos[triangle::VERTEX_COUNT];
+		for (glm::vec3& p : pos) {
+			p = c + glm::vec3(offset(gen), offset(gen), offset(gen));
+		}
+		triangles.push_back(triangle(pos[0], pos[1], pos[2], 0));
+	}
+	return triangles;
+}
+
+/**
+	Generates random rays from a sphere of radius 5 towards the [-1, 1] cube.
+
+	@param gen the random number generator.
+	@return std::vector<test_ray> the rays.
+*/
+std::vector<test_ray> random_rays(std::mt19937& gen) {
+	std::uniform_real_distribution<float> dist(-1.f, 1.f);
+
+	std::vector<test_ray> rays;
+	for (unsigned int i = 0; i < RAY_COUNT; i++) {
+		glm::vec3 dir(dist(gen), dist(gen), dist(gen));
+		rays.push_back({ glm::normalize(dir) * 5.f, glm::vec3(dist(gen), dist(gen), dist(gen)) });
+	}
+	return rays;
+}
+
+/**
+	Prints one line of the benchmark results.
+
+	@param name the name of the benchmark.
+	@param seconds the time taken by all the tests.
+	@param hits the number of hits, to compare the algorithms with each other.
+	@param bytes the size of one triangle record.
+*/
+void report(const std::string& name, double seconds, unsigned long long hits, size_t bytes) {
+	double tests = (double)TRIANGLE_COUNT * RAY_COUNT;
+	std::cout << std::left << std::setw(26) << name << std::right
+		<< std::setw(10) << std::fixed << std::setprecision(2) << seconds * 1e9 / tests << " ns"
+		<< std::setw(12) << tests / seconds / 1e6 << " M/s"
+		<< std::setw(10) << hits << " hits"
+		<< std::setw(8) << bytes << " B/triangle" << std::endl;
+}
+
+/**
+	Times the intersection of every ray with every record of records.
+
+	@param name the name of the benchmark.
+	@param records the triangle records.
+	@param rays the rays.
+*/
+template <typename record>
+void bench_records(const char* name, const std::vector<record>& records, const std::vector<test_ray>& rays) {
+	unsigned long long hits = 0;
+	float t, u, v;
+
+	auto start = std::chrono::steady_clock::now();
+	for (const test_ray& test_ray_ : rays) {
+		ray ray_(test_ray_.m_origin, test_ray_.m_target);
+		for (const record& record_ : records) {
+			hits += intersect(record_, ray_.m_origin, ray_.m_direction, t, u, v);
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	report(name, elapsed.count(), hits, sizeof(record));
+}
+
+/**
+	Times a kernel finding the closest hit of every ray among all the records.
+
+	@param name the name of the benchmark.
+	@param kernel the intersect kernel.
+	@param records the triangle records.
+	@param rays the rays.
+*/
+template <typename record>
+void bench_kernel(const std::string& name,
+	bool (*kernel)(const record*, unsigned int, const glm::vec3&, const glm::vec3&, hit&),
+	const std::vector<record>& records, const std::vector<test_ray>& rays) {
+	unsigned long long hits = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (const test_ray& test_ray_ : rays) {
+		ray ray_(test_ray_.m_origin, test_ray_.m_target);
+		hits += kernel(records.data(), (unsigned int)records.size(), ray_.m_origin, ray_.m_direction, ray_.m_hit);
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	report(name, elapsed.count(), hits, sizeof(record));
+}
+
+/**
+	Compares the triangle intersection algorithms.
+
+	The triangle class recomputes its edges on every call, and is the reference
+	for the precomputed records of triangle_records.h.
+*/
+void bench_triangles() {
+	std::mt19937 gen(SEED);
+	std::vector<triangle> triangles = random_triangles(gen);
+	std::vector<test_ray> rays = random_rays(gen);
+
+	std::vector<moller_record> moller_records;
+	std::vector<woop_record> woop_records;
+	std::vector<havel_record> havel_records;
+	for (const triangle& triangle_ : triangles) {
+		const vertex* v = triangle_.m_vertices;
+		moller_records.push_back(moller_record(v[0].m_pos, v[1].m_pos, v[2].m_pos));
+		woop_records.push_back(woop_record(v[0].m_pos, v[1].m_pos, v[2].m_pos));
+		havel_records.push_back(havel_record(v[0].m_pos, v[1].m_pos, v[2].m_pos));
+	}
+
+	std::cout << "triangle intersection (" << TRIANGLE_COUNT << " triangles x " << RAY_COUNT << " rays)" << std::endl;
+
+	unsigned long long hits = 0;
+	float t, u, v;
+	auto start = std::chrono::steady_clock::now();
+	for (const test_ray& test_ray_ : rays) {
+		ray ray_(test_ray_.m_origin, test_ray_.m_target);
+		for (const triangle& triangle_ : triangles) {
+			hits += triangle_.intersect(ray_, t, u, v);
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	report("triangle (reference)", elapsed.count(), hits, sizeof(triangle));
+
+	bench_records("moller", moller_records, rays);
+	bench_records("woop", woop_records, rays);
+	bench_records("havel", havel_records, rays);
+
+	// the kernels report one hit per ray that hits any triangle.
+	const isa levels[] = { isa::generic, isa::sse42, isa::avx2, isa::avx512 };
+	isa detected = detect_isa();
+	for (isa level : levels) {
+		if (level > detected) break;
+
+		const kernels& kernels_ = get_kernels(level);
+		std::string suffix = std::string(" kernel ") + to_string(level);
+		bench_kernel("moller" + suffix, kernels_.m_intersect_moller, moller_records, rays);
+		bench_kernel("woop" + suffix, kernels_.m_intersect_woop, woop_records, rays);
+		bench_kernel("havel" + suffix, kernels_.m_intersect_havel, havel_records, rays);
+	}
+}
+
+/**
+	The trace_scene struct holds a small scene for the trace kernels: a plane, two
+	spheres and the random triangles as a mesh. m_view points into the vectors.
+*/
+struct trace_scene {
+	std::vector<moller_record> m_records;
+	std::vector<glm::vec3> m_normals;
+	std::vector<shape_view> m_shapes;
+	std::vector<light> m_lights;
+	std::vector<shape::material> m_materials;
+	scene_view m_view;
+};
+
+/**
+	Builds the scene of the trace benchmarks.
+
+	@param gen the random number generator of the triangles.
+	@param eye the position of the camera.
+	@param scene_ [out] the scene.
+*/
+void make_trace_scene(std::mt19937& gen, const glm::vec3& eye, trace_scene& scene_) {
+	std::vector<triangle> triangles = random_triangles(gen);
+	for (const triangle& triangle_ : triangles) {
+		const vertex* v = triangle_.m_vertices;
+		scene_.m_records.push_back(moller_record(v[0].m_pos, v[1].m_pos, v[2].m_pos));
+		for (unsigned int i = 0; i < triangle::VERTEX_COUNT; i++) {
+			scene_.m_normals.push_back(v[i].m_norm);
+		}
+	}
+
+	plane plane_(XZ_NORM, glm::vec3(0.f, -1.5f, 0.f), 0);
+	sphere sphere0(glm::vec3(-1.5f, 0.f, -1.f), 1.f, 1);
+	sphere sphere1(glm::vec3(1.5f, .5f, -.5f), .75f, 1);
+	shape_view mesh_view = {};
+	mesh_view.m_type = shape_type::mesh;
+	mesh_view.m_material = 2;
+	mesh_view.m_algorithm = triangle_algorithm::moller_trumbore;
+	mesh_view.m_records = scene_.m_records.data();
+	mesh_view.m_normals = scene_.m_normals.data();
+	mesh_view.m_count = (unsigned int)scene_.m_records.size();
+	scene_.m_shapes = { plane_.get_view(), sphere0.get_view(), sphere1.get_view(), mesh_view };
+
+	scene_.m_lights = {
+		light(glm::vec3(0.f, 10.f, 10.f), glm::vec3(.7f), glm::vec3(.7f)),
+		light(glm::vec3(-10.f, 5.f, 0.f), glm::vec3(.3f, .3f, .5f), glm::vec3(.3f))
+	};
+	scene_.m_materials = {
+		shape::material(glm::vec3(.1f), glm::vec3(.4f, .6f, .3f), glm::vec3(.2f), 5.f),
+		shape::material(glm::vec3(.1f, 0.f, 0.f), glm::vec3(1.f, .2f, .2f), glm::vec3(1.f), 16.f),
+		shape::material(glm::vec3(0.f, 0.f, .1f), glm::vec3(.2f, .2f, 1.f), glm::vec3(.5f), 32.f)
+	};
+	scene_.m_view = {
+		scene_.m_shapes.data(), (unsigned int)scene_.m_shapes.size(),
+		scene_.m_lights.data(), (unsigned int)scene_.m_lights.size(),
+		scene_.m_materials.data(), eye
+	};
+}
+
+/**
+	Traces a small scene with every packet width of every level up to the detected
+	one, and compares the colors with the scalar reference: width 1 of the generic
+	kernels. See trace_scene.
+*/
+void bench_trace() {
+	std::mt19937 gen(SEED);
+	camera camera_(glm::vec3(0.f, 0.f, 5.f), 60.f, 1.f, (float)TRACE_WIDTH / TRACE_HEIGHT);
+	screen screen_(camera_, TRACE_HEIGHT);
+	screen_view screen_view_ = screen_.get_view();
+	trace_scene trace_scene_;
+	make_trace_scene(gen, camera_.m_position, trace_scene_);
+	const scene_view& scene_ = trace_scene_.m_view;
+
+	std::uniform_real_distribution<float> dist(0.f, 1.f);
+	std::vector<float> offsets(TRACE_SAMPLES);
+	for (float& offset : offsets) {
+		offset = dist(gen);
+	}
+
+	std::cout << "packet trace (" << TRACE_WIDTH << "x" << TRACE_HEIGHT << " pixels x " << TRACE_SAMPLES
+		<< " rays, " << trace_scene_.m_shapes.size() - 1 + TRIANGLE_COUNT << " shapes and triangles)" << std::endl;
+
+	std::vector<glm::vec3> reference;
+	const isa levels[] = { isa::generic, isa::sse42, isa::avx2, isa::avx512 };
+	isa detected = detect_isa();
+	for (isa level : levels) {
+		if (level > detected) break;
+
+		for (unsigned int width : PACKET_WIDTHS) {
+			trace_function trace = get_trace(get_kernels(level), width);
+			if (!trace) continue;
+
+			std::vector<glm::vec3> colors;
+			render_stats stats;
+			auto start = std::chrono::steady_clock::now();
+			for (unsigned int v = 0; v < TRACE_HEIGHT; v++) {
+				for (unsigned int u = 0; u < TRACE_WIDTH; u++) {
+					colors.push_back(trace(scene_, screen_view_, (float)u, (float)v, offsets.data(), TRACE_SAMPLES, stats) / (float)TRACE_SAMPLES);
+				}
+			}
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			if (reference.empty()) reference = colors;
+
+			float max_error = 0.f;
+			for (size_t i = 0; i < colors.size(); i++) {
+				glm::vec3 error = glm::abs(colors[i] - reference[i]);
+				max_error = glm::max(max_error, glm::max(error.x, glm::max(error.y, error.z)));
+			}
+
+			double rays = (double)TRACE_WIDTH * TRACE_HEIGHT * TRACE_SAMPLES;
+			std::string name = std::string(to_string(level)) + " x" + std::to_string(width);
+			std::cout << std::left << std::setw(26) << name << std::right
+				<< std::setw(10) << std::fixed << std::setprecision(2) << elapsed.count() * 1e9 / rays << " ns/ray"
+				<< std::setw(12) << rays / elapsed.count() / 1e6 << " M/s"
+				<< "   max error " << std::scientific << std::setprecision(1) << max_error << std::endl;
+		}
+	}
+}
+
+/**
+	Resets the peak memory of the process, where the OS allows it.
+*/
+void reset_peak_memory() {
+#if defined(__linux__)
+	std::ofstream clear_refs("/proc/self/clear_refs");
+	clear_refs << "5";
+#endif
+}
+
+/**
+	@return size_t the peak memory of the process (resident set size) in bytes.
+*/
+size_t peak_memory() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize;
+#elif defined(__linux__)
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line)) {
+		if (line.compare(0, 6, "VmHWM:") == 0) return std::stoull(line.substr(6)) * 1024;
+	}
+	return 0;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (size_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+/**
+	Writes a bumpy grid of OBJ_GRID_SIZE x OBJ_GRID_SIZE quads, split in triangles.
+
+	@param file_name the .obj file to write.
+*/
+void write_obj(const char* file_name) {
+	std::mt19937 gen(SEED);
+	std::uniform_real_distribution<float> bump(-.01f, .01f);
+	std::ofstream file(file_name);
+
+	file << "# benchmark grid" << std::endl;
+	for (unsigned int y = 0; y <= OBJ_GRID_SIZE; y++) {
+		for (unsigned int x = 0; x <= OBJ_GRID_SIZE; x++) {
+			file << "v " << (float)x / OBJ_GRID_SIZE << " " << bump(gen) << " " << (float)y / OBJ_GRID_SIZE << "\n";
+		}
+	}
+	for (unsigned int y = 0; y < OBJ_GRID_SIZE; y++) {
+		for (unsigned int x = 0; x < OBJ_GRID_SIZE; x++) {
+			unsigned int i = y * (OBJ_GRID_SIZE + 1) + x + 1;
+			file << "f " << i << " " << i + OBJ_GRID_SIZE + 1 << " " << i + 1 << "\n";
+			file << "f " << i + 1 << " " << i + OBJ_GRID_SIZE + 1 << " " << i + OBJ_GRID_SIZE + 2 << "\n";
+		}
+	}
+}
+
+/**
+	Writes a mesh as a binary little endian .ply file, the way scanners do.
+
+	@param file_name the .ply file to write.
+	@param positions the vertex positions.
+	@param indices the indices of the vertices of the triangles, 3 per triangle.
+*/
+void write_ply(const char* file_name, const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices) {
+	std::ofstream file(file_name, std::ios::binary);
+	file << "ply\nformat binary_little_endian 1.0\n"
+		<< "element vertex " << positions.size() << "\nproperty float x\nproperty float y\nproperty float z\n"
+		<< "element face " << indices.size() / 3 << "\nproperty list uchar int vertex_indices\nend_header\n";
+	file.write((const char*)positions.data(), positions.size() * sizeof(glm::vec3));
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		const unsigned char count = 3;
+		file.write((const char*)&count, 1);
+		file.write((const char*)&indices[i], 3 * sizeof(unsigned int));
+	}
+}
+
+/**
+	Prints one line of the loader benchmark.
+*/
+void report_load(const std::string& name, double seconds, size_t bytes, size_t triangles, size_t memory) {
+	std::cout << std::left << std::setw(26) << name << std::right
+		<< std::setw(10) << std::fixed << std::setprecision(1) << seconds * 1e3 << " ms"
+		<< std::setw(10) << bytes / seconds / 1e6 << " MB/s"
+		<< std::setw(10) << triangles << " triangles"
+		<< std::setw(10) << memory / 1e6 << " MB peak" << std::endl;
+}
+
+/**
+	Compares the construction of a mesh from an .obj file with the construction
+	from the same mesh converted to a .mesh file, records included.
+
+	A .mesh file is mapped, so its pages are only read from the disk when the
+	renderer first touches them. The last line adds that first touch of every
+	record and normal, which a render pays for during its first rays.
+
+	@param file_name the .obj file.
+*/
+void bench_mesh(const char* file_name) {
+	const char* MESH_FILE = "benchmark.mesh";
+	std::cout << "mesh loading (" << to_string(TRIANGLE_ALGORITHM) << " records)" << std::endl;
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<unsigned int> indices;
+		std::string error;
+		if (!load_obj(file_name, positions, indices, error) ||
+			!write_mesh_file(MESH_FILE, positions, indices, mesh::get_smooth_normals(positions, indices), { TRIANGLE_ALGORITHM }, error)) {
+			std::cerr << error << std::endl;
+			return;
+		}
+	}
+	std::ifstream obj_file(file_name, std::ios::binary | std::ios::ate);
+	std::ifstream mesh_file_(MESH_FILE, std::ios::binary | std::ios::ate);
+	size_t obj_bytes = (size_t)obj_file.tellg();
+	size_t mesh_bytes = (size_t)mesh_file_.tellg();
+
+	for (int touch = -1; touch < 2; touch++) {
+		reset_peak_memory();
+		auto start = std::chrono::steady_clock::now();
+		mesh mesh_(touch < 0 ? file_name : MESH_FILE, 0);
+
+		if (touch > 0) {
+			shape_view view = mesh_.get_view();
+			const size_t record_sizes[] = { sizeof(moller_record), sizeof(woop_record), sizeof(havel_record) };
+			const size_t PAGE = 4096;
+			const char* records = (const char*)view.m_records;
+			const char* normals = (const char*)view.m_normals;
+			volatile char sink = 0;
+			for (size_t i = 0; i < view.m_count * record_sizes[(int)view.m_algorithm]; i += PAGE) sink += records[i];
+			for (size_t i = 0; i < view.m_count * 3 * sizeof(glm::vec3); i += PAGE) sink += normals[i];
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		const char* names[] = { "mesh from .obj", "mesh from .mesh", "mesh from .mesh + touch" };
+		report_load(names[touch + 1], elapsed.count(), touch < 0 ? obj_bytes : mesh_bytes, mesh_.triangle_count(), peak_memory());
+	}
+	std::remove(MESH_FILE);
+}
+
+/**
+	Compares loading the same mesh from an .obj file and from a binary .ply file,
+	first the triangles alone, then the whole mesh construction.
+
+	@param file_name the .obj file.
+*/
+void bench_ply(const char* file_name) {
+	const char* PLY_FILE = "benchmark.ply";
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<unsigned int> indices;
+		std::string error;
+		if (!load_obj(file_name, positions, indices, error)) {
+			std::cerr << error << std::endl;
+			return;
+		}
+		write_ply(PLY_FILE, positions, indices);
+	}
+	std::ifstream obj_file(file_name, std::ios::binary | std::ios::ate);
+	std::ifstream ply_file(PLY_FILE, std::ios::binary | std::ios::ate);
+	size_t obj_bytes = (size_t)obj_file.tellg();
+	size_t ply_bytes = (size_t)ply_file.tellg();
+	std::cout << "ply loading (" << std::fixed << std::setprecision(1) << ply_bytes / 1e6 << " MB, "
+		<< (double)obj_bytes / ply_bytes << "x smaller than the .obj file)" << std::endl;
+
+	for (int ply = 0; ply < 2; ply++) {
+		reset_peak_memory();
+		auto start = std::chrono::steady_clock::now();
+		std::vector<glm::vec3> positions;
+		std::vector<unsigned int> indices;
+		std::string error;
+		bool loaded = ply ? load_ply(PLY_FILE, positions, indices, error) : load_obj(file_name, positions, indices, error);
+		if (!loaded) std::cerr << error << std::endl;
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		report_load(ply ? "load_ply" : "load_obj", elapsed.count(), ply ? ply_bytes : obj_bytes, indices.size() / 3, peak_memory());
+	}
+	for (int ply = 0; ply < 2; ply++) {
+		reset_peak_memory();
+		auto start = std::chrono::steady_clock::now();
+		mesh mesh_(ply ? PLY_FILE : file_name, 0);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		report_load(ply ? "mesh from .ply" : "mesh from .obj", elapsed.count(), ply ? ply_bytes : obj_bytes, mesh_.triangle_count(), peak_memory());
+	}
+	std::remove(PLY_FILE);
+}
+
+/**
+	Compares load_obj() with the tinyobj loader it replaced, up to the triangles
+	that the mesh turns into records. Each loader releases its memory before the
+	next one runs, and the peak memory is reset in between where the OS allows it.
+	Otherwise, the peak of the second loader includes the first one.
+
+	@param file_name [optional] the .obj file to load, or nullptr for a generated grid.
+*/
+void bench_obj(const char* file_name) {
+	const char* GRID_FILE = "benchmark_grid.obj";
+	if (!file_name) {
+		write_obj(GRID_FILE);
+		file_name = GRID_FILE;
+	}
+	std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+	size_t bytes = (size_t)file.tellg();
+	std::cout << "obj loading (" << file_name << ", " << std::fixed << std::setprecision(1) << bytes / 1e6 << " MB)" << std::endl;
+
+	{
+		reset_peak_memory();
+		auto start = std::chrono::steady_clock::now();
+		std::vector<glm::vec3> positions;
+		std::vector<unsigned int> indices;
+		std::string error;
+		if (!load_obj(file_name, positions, indices, error)) std::cerr << error << std::endl;
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		report_load("load_obj", elapsed.count(), bytes, indices.size() / 3, peak_memory());
+	}
+	{
+		reset_peak_memory();
+		auto start = std::chrono::steady_clock::now();
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string err;
+		tinyobj::LoadObj(&attrib, &shapes, &materials, &err, file_name, NULL, false);
+
+		// the copy into triangles that mesh::mesh() used to make.
+		std::vector<triangle> triangles;
+		for (const tinyobj::shape_t& shape_ : shapes) {
+			const std::vector<tinyobj::index_t>& indices = shape_.mesh.indices;
+			for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+				glm::vec3 pos[triangle::VERTEX_COUNT];
+				for (unsigned int v = 0; v < triangle::VERTEX_COUNT; v++) {
+					const float* p = &attrib.vertices[3 * indices[i + v].vertex_index];
+					pos[v] = glm::vec3(p[0], p[1], p[2]);
+				}
+				triangles.push_back(triangle(pos[0], pos[1], pos[2], 0));
+			}
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		report_load("tinyobj", elapsed.count(), bytes, triangles.size(), peak_memory());
+	}
+
+	bench_mesh(file_name);
+	bench_ply(file_name);
+	if (file_name == GRID_FILE) std::remove(GRID_FILE);
+}
+
+/**
+	Writes a scene of SCENE_SPHERE_COUNT random spheres.
+
+	@param file_name the scene file to write.
+	@param block true to write the spheres as one block, false for one object per sphere.
+*/
+void write_scene(const char* file_name, bool block) {
+	std::mt19937 gen(SEED);
+	std::uniform_real_distribution<float> position(-100.f, 100.f);
+	std::uniform_real_distribution<float> radius(.1f, 1.f);
+	std::ofstream file(file_name);
+	const char* material = "amb: 0.3 0.8 0.4\ndif: 0.3 0.8 0.4\nspe: 0.3 0.8 0.4\nshi: 1\n";
+
+	file << (block ? 3 : SCENE_SPHERE_COUNT + 2) << "\ncamera\npos: 0 0 0\nfov: 60\nf: 200\na: 1.33\n";
+	if (block) file << "spheres " << SCENE_SPHERE_COUNT << "\n" << material;
+	for (unsigned int i = 0; i < SCENE_SPHERE_COUNT; i++) {
+		float x = position(gen), y = position(gen), z = position(gen), r = radius(gen);
+		if (block) file << x << " " << y << " " << z << " " << r << "\n";
+		else file << "sphere\npos: " << x << " " << y << " " << z << "\nrad: " << r << "\n" << material;
+	}
+	file << "light\npos: 0 200 -10\ndif: 0.9 0.9 0.9\nspe: 0.9 0.9 0.9\n";
+}
+
+/**
+	Parses the scene file of write_scene() with std::ifstream, the way the scene
+	did before it had a tokenizer, for comparison.
+
+	@return size_t the number of spheres.
+*/
+size_t parse_scene_ifstream(const char* file_name) {
+	std::ifstream file(file_name);
+	std::vector<sphere*> spheres;
+	std::string word;
+	glm::vec3 vector;
+	float number;
+	int count;
+	file >> count;
+	while (file >> word) {
+		if (word == "camera") file >> word >> vector.x >> vector.y >> vector.z >> word >> number >> word >> number >> word >> number;
+		else if (word == "sphere") {
+			glm::vec3 center, ambient, diffuse, specular;
+			float radius;
+			file >> word >> center.x >> center.y >> center.z >> word >> radius;
+			file >> word >> ambient.x >> ambient.y >> ambient.z >> word >> diffuse.x >> diffuse.y >> diffuse.z;
+			file >> word >> specular.x >> specular.y >> specular.z >> word >> number;
+			spheres.push_back(new sphere(center, radius, 0));
+		}
+		else file >> word >> vector.x >> vector.y >> vector.z >> word >> vector.x >> vector.y >> vector.z >> word >> vector.x >> vector.y >> vector.z;
+	}
+	for (sphere* sphere_ : spheres) delete sphere_;
+	return spheres.size();
+}
+
+/**
+	Compares parsing a scene of many spheres with std::ifstream, with the
+	tokenizer of the scene, and with the tokenizer and the spheres block syntax.
+*/
+void bench_scene() {
+	const char* SCENE_FILE = "benchmark_scene.txt";
+	const char* BLOCK_FILE = "benchmark_block.txt";
+	write_scene(SCENE_FILE, false);
+	write_scene(BLOCK_FILE, true);
+	std::cout << "scene parsing (" << SCENE_SPHERE_COUNT << " spheres)" << std::endl;
+
+	char program[] = "benchmark";
+	char* argv[] = { program };
+	options options_(1, argv);
+	for (int i = 0; i < 3; i++) {
+		const char* file_name = i < 2 ? SCENE_FILE : BLOCK_FILE;
+		std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+		size_t bytes = (size_t)file.tellg();
+
+		std::streambuf* log = std::cout.rdbuf(nullptr);
+		auto start = std::chrono::steady_clock::now();
+		size_t sphere_count;
+		if (i == 0) sphere_count = parse_scene_ifstream(file_name);
+		else sphere_count = scene(file_name, options_).m_shapes.size();
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout.rdbuf(log);
+
+		const char* names[] = { "std::ifstream", "tokenizer", "tokenizer, spheres block" };
+		std::cout << std::left << std::setw(26) << names[i] << std::right
+			<< std::setw(10) << std::fixed << std::setprecision(1) << elapsed.count() * 1e3 << " ms"
+			<< std::setw(10) << bytes / elapsed.count() / 1e6 << " MB/s"
+			<< std::setw(10) << sphere_count << " spheres" << std::endl;
+	}
+	std::remove(SCENE_FILE);
+	std::remove(BLOCK_FILE);
+}
+
+/**
+	Writes a large image in every pixel format, in tiles on every core as the
+	raytracer does, and reports the memory used, the write bandwidth and the
+	largest error of the colors read back.
+*/
+void bench_framebuffer() {
+	std::cout << "framebuffer (" << FRAMEBUFFER_SIZE << "x" << FRAMEBUFFER_SIZE << " pixels, "
+		<< FRAMEBUFFER_TILE << " pixel tiles)" << std::endl;
+
+	const pixel_format formats[] = { pixel_format::srgb8, pixel_format::half, pixel_format::float32 };
+	const uint32_t tiles_across = FRAMEBUFFER_SIZE / FRAMEBUFFER_TILE;
+	thread_pool pool;
+	for (pixel_format format : formats) {
+		framebuffer image(FRAMEBUFFER_SIZE, FRAMEBUFFER_SIZE, format);
+		auto color = [](uint32_t x, uint32_t y) {
+			return glm::vec3(x / (float)FRAMEBUFFER_SIZE, y / (float)FRAMEBUFFER_SIZE, ((x ^ y) & 255) / 255.f);
+		};
+
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < tiles_across * tiles_across; i++) {
+			pool.submit([&, i] {
+				uint32_t tile_x = i % tiles_across * FRAMEBUFFER_TILE;
+				uint32_t tile_y = i / tiles_across * FRAMEBUFFER_TILE;
+				for (uint32_t y = tile_y; y < tile_y + FRAMEBUFFER_TILE; y++) {
+					for (uint32_t x = tile_x; x < tile_x + FRAMEBUFFER_TILE; x++) {
+						image.set(x, y, color(x, y));
+					}
+				}
+			});
+		}
+		pool.wait();
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		float error = 0.f;
+		for (uint32_t y = 0; y < FRAMEBUFFER_SIZE; y += 7) {
+			for (uint32_t x = 0; x < FRAMEBUFFER_SIZE; x += 7) {
+				glm::vec3 difference = glm::abs(image.get(x, y) - color(x, y));
+				error = glm::max(error, glm::max(difference.x, glm::max(difference.y, difference.z)));
+			}
+		}
+
+		double pixels = (double)FRAMEBUFFER_SIZE * FRAMEBUFFER_SIZE;
+		std::cout << std::left << std::setw(26) << to_string(format) << std::right
+			<< std::setw(10) << std::fixed << std::setprecision(1) << image.memory_usage() / 1e6 << " MB"
+			<< std::setw(10) << elapsed.count() * 1e3 << " ms"
+			<< std::setw(10) << std::setprecision(2) << pixels * image.pixel_size() / elapsed.count() / 1e9 << " GB/s"
+			<< std::setw(10) << std::setprecision(1) << pixels / elapsed.count() / 1e6 << " Mpixel/s"
+			<< std::setw(12) << std::setprecision(6) << error << " max error" << std::endl;
+	}
+}
+
+/**
+	A PCG32 generator: 8 bytes of state and one multiply per number. Stands for
+	the per-thread generators that the hashes of sampler.h make unnecessary.
+*/
+struct pcg32 {
+	uint64_t m_state;
+
+	explicit pcg32(uint64_t seed) : m_state(seed * 6364136223846793005ull + 1442695040888963407ull) {}
+
+	uint32_t next() {
+		uint64_t state = m_state;
+		m_state = state * 6364136223846793005ull + 1442695040888963407ull;
+		uint32_t xorshifted = (uint32_t)(((state >> 18u) ^ state) >> 27u);
+		uint32_t rotation = (uint32_t)(state >> 59u);
+		return (xorshifted >> rotation) | (xorshifted << ((32u - rotation) & 31u));
+	}
+};
+
+/**
+	Times filling the anti-aliasing offsets of SAMPLER_SIZE x SAMPLER_SIZE pixels
+	with SAMPLER_SAMPLES samples each, and checks the offsets.
+
+	@param name the name of the generator.
+	@param fill the function that saves the offsets of a pixel.
+	@param reference the offsets of sample_offset(), or empty.
+	@return std::vector<float> the offsets, pixel after pixel.
+*/
+std::vector<float> bench_offsets(const std::string& name, const std::function<void(uint32_t, uint32_t, float*)>& fill,
+	const std::vector<float>& reference) {
+	std::vector<float> offsets((size_t)SAMPLER_SIZE * SAMPLER_SIZE * SAMPLER_SAMPLES);
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t y = 0; y < SAMPLER_SIZE; y++) {
+		for (uint32_t x = 0; x < SAMPLER_SIZE; x++) {
+			fill(x, y, offsets.data() + ((size_t)y * SAMPLER_SIZE + x) * SAMPLER_SAMPLES);
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::cout << std::left << std::setw(26) << name << std::right
+		<< std::setw(10) << std::fixed << std::setprecision(2) << elapsed.count() * 1e9 / offsets.size() << " ns"
+		<< std::setw(12) << offsets.size() / elapsed.count() / 1e6 << " M/s";
+	if (!reference.empty()) {
+		size_t mismatches = 0;
+		for (size_t i = 0; i < offsets.size(); i++) {
+			mismatches += offsets[i] != reference[i];
+		}
+		std::cout << std::setw(10) << mismatches << " differences with sample_offset()";
+	}
+	std::cout << std::endl;
+	return offsets;
+}
+
+/**
+	Prints a statistic of the offsets with the range it is expected in.
+
+	@param name the name of the statistic.
+	@param value the value.
+	@param expected the expected value.
+	@param tolerance the largest difference with the expected value.
+*/
+void report_statistic(const std::string& name, double value, double expected, double tolerance) {
+	bool passed = std::abs(value - expected) <= tolerance;
+	std::cout << std::left << std::setw(26) << name << std::right << std::setw(14) << std::fixed << std::setprecision(6)
+		<< value << "   expected " << expected << " +- " << tolerance << (passed ? "   ok" : "   FAILED") << std::endl;
+}
+
+/**
+	Compares the generators of anti-aliasing offsets: the std::mt19937 the raytracer
+	used, a PCG32 stream, the hashes of sampler.h one at a time, and the offsets
+	kernels of every level. The kernels must give the same offsets as the scalar
+	hashes. Last, checks the statistics of the offsets: their mean and variance,
+	the uniformity of their histogram, and the correlation of the samples of a
+	pixel and of neighbouring pixels.
+*/
+void bench_sampler() {
+	std::cout << "sample offsets (" << SAMPLER_SIZE << "x" << SAMPLER_SIZE << " pixels x " << SAMPLER_SAMPLES
+		<< " samples)" << std::endl;
+	std::vector<float> none;
+
+	std::mt19937 gen(SEED);
+	std::uniform_real_distribution<float> dist(0.f, 1.f);
+	bench_offsets("std::mt19937", [&](uint32_t, uint32_t, float* offsets) {
+		for (unsigned int i = 0; i < SAMPLER_SAMPLES; i++) offsets[i] = dist(gen);
+	}, none);
+	pcg32 pcg(SEED);
+	bench_offsets("pcg32", [&](uint32_t, uint32_t, float* offsets) {
+		for (unsigned int i = 0; i < SAMPLER_SAMPLES; i++) offsets[i] = (pcg.next() >> 8) * (1.f / 16777216.f);
+	}, none);
+	std::vector<float> reference = bench_offsets("sample_offset()", [](uint32_t x, uint32_t y, float* offsets) {
+		uint32_t key = pixel_key(SEED, x, y);
+		for (unsigned int i = 0; i < SAMPLER_SAMPLES; i++) offsets[i] = sample_offset(key, i);
+	}, none);
+
+	const isa levels[] = { isa::generic, isa::sse42, isa::avx2, isa::avx512 };
+	isa detected = detect_isa();
+	for (isa level : levels) {
+		if (level > detected) break;
+
+		const kernels& kernels_ = get_kernels(level);
+		bench_offsets(std::string("sample kernel ") + to_string(level), [&](uint32_t x, uint32_t y, float* offsets) {
+			kernels_.m_sample_offsets(pixel_key(SEED, x, y), 0, SAMPLER_SAMPLES, offsets);
+		}, reference);
+		// the same offsets, a sample of a row of pixels at a time.
+		std::vector<float> row(SAMPLER_SIZE);
+		bench_offsets(std::string("row kernel ") + to_string(level), [&](uint32_t x, uint32_t y, float* offsets) {
+			if (x > 0) return;
+			for (unsigned int i = 0; i < SAMPLER_SAMPLES; i++) {
+				kernels_.m_row_offsets(SEED, 0, y, i, SAMPLER_SIZE, row.data());
+				for (uint32_t j = 0; j < SAMPLER_SIZE; j++) offsets[j * SAMPLER_SAMPLES + i] = row[j];
+			}
+		}, reference);
+	}
+
+	double sum = 0., square_sum = 0., sample_product = 0., pixel_product = 0.;
+	std::vector<size_t> buckets(SAMPLER_BUCKETS);
+	for (size_t i = 0; i < reference.size(); i++) {
+		double offset = reference[i];
+		sum += offset;
+		square_sum += offset * offset;
+		buckets[(size_t)(offset * SAMPLER_BUCKETS)]++;
+		if (i % SAMPLER_SAMPLES + 1 < SAMPLER_SAMPLES) sample_product += offset * reference[i + 1];
+		if (i + SAMPLER_SAMPLES < reference.size()) pixel_product += offset * reference[i + SAMPLER_SAMPLES];
+	}
+	double count = (double)reference.size();
+	double mean = sum / count;
+	double variance = square_sum / count - mean * mean;
+	double chi_square = 0.;
+	for (size_t bucket : buckets) {
+		double expected = count / SAMPLER_BUCKETS;
+		chi_square += (bucket - expected) * (bucket - expected) / expected;
+	}
+	// the correlation of pairs of offsets, each pair counted about once per offset.
+	double sample_correlation = (sample_product / (count * (SAMPLER_SAMPLES - 1) / SAMPLER_SAMPLES) - mean * mean) / variance;
+	double pixel_correlation = (pixel_product / (count - SAMPLER_SAMPLES) - mean * mean) / variance;
+	double freedom = SAMPLER_BUCKETS - 1;
+	report_statistic("mean", mean, .5, 1e-3);
+	report_statistic("variance", variance, 1. / 12., 1e-3);
+	report_statistic("chi-square", chi_square, freedom, 5. * std::sqrt(2. * freedom));
+	report_statistic("sample correlation", sample_correlation, 0., 5e-3);
+	report_statistic("pixel correlation", pixel_correlation, 0., 5e-3);
+}
+
+/**
+	The micro_result struct holds the result of a microbenchmark.
+*/
+struct micro_result {
+	std::string m_name;
+	uint64_t m_calls; // the calls of a round.
+	double m_median_ns; // the median time of a call over the rounds.
+	double m_min_ns; // the time of a call in the fastest round.
+	uint64_t m_result; // a count computed from the outputs, which only changes if the code behaves differently.
+};
+
+/**
+	Times a microbenchmark: MICRO_ROUNDS rounds of calls, each one prepared
+	untimed, and prints the median time per call, the throughput and the result.
+
+	@param name the name of the benchmark.
+	@param calls the calls of a round.
+	@param prepare the function that prepares a round, such as copying the rays.
+	@param run the function that makes the calls of a round, and returns its result.
+	@param results [in, out] the results, the new one appended.
+*/
+void bench_micro(const std::string& name, uint64_t calls, const std::function<void()>& prepare,
+	const std::function<uint64_t()>& run, std::vector<micro_result>& results) {
+	std::vector<double> round_ns;
+	uint64_t result = 0;
+	for (unsigned int round = 0; round < MICRO_ROUNDS; round++) {
+		prepare();
+		auto start = std::chrono::steady_clock::now();
+		result = run();
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		round_ns.push_back(elapsed.count() / calls);
+	}
+	std::sort(round_ns.begin(), round_ns.end());
+	micro_result result_ = { name, calls, round_ns[round_ns.size() / 2], round_ns.front(), result };
+	results.push_back(result_);
+
+	std::cout << std::left << std::setw(26) << name << std::right
+		<< std::setw(10) << std::fixed << std::setprecision(2) << result_.m_median_ns << " ns"
+		<< std::setw(12) << 1e3 / result_.m_median_ns << " M/s"
+		<< std::setw(12) << result << " result" << std::endl;
+}
+
+/**
+	Times the intersection of a shape with rays, MICRO_PASSES times over the rays.
+	The result is the number of rays that hit the shape.
+
+	@param name the name of the benchmark.
+	@param shape_ the shape.
+	@param rays the rays, without hits.
+	@param results [in, out] the results.
+*/
+void bench_intersection(const std::string& name, shape& shape_, const std::vector<ray>& rays, std::vector<micro_result>& results) {
+	std::vector<ray> traced;
+	bench_micro(name, (uint64_t)rays.size() * MICRO_PASSES, [&] { traced = rays; }, [&] {
+		for (unsigned int pass = 0; pass < MICRO_PASSES; pass++) {
+			for (ray& ray_ : traced) {
+				shape_.intersection(&ray_);
+			}
+		}
+		return (uint64_t)std::count_if(traced.begin(), traced.end(), [](const ray& ray_) { return ray_.m_hit.m_shape != nullptr; });
+	}, results);
+}
+
+/**
+	@param gen the random number generator.
+	@return glm::vec3 a random direction.
+*/
+glm::vec3 random_direction(std::mt19937& gen) {
+	std::normal_distribution<float> dist;
+	glm::vec3 direction;
+	do {
+		direction = glm::vec3(dist(gen), dist(gen), dist(gen));
+	} while (glm::dot(direction, direction) < 1e-6f);
+	return glm::normalize(direction);
+}
+
+/**
+	Saves the results of the microbenchmarks as JSON, to compare versions.
+
+	@param file_name the name of the JSON file.
+	@param results the results.
+	@return bool false if the file could not be written.
+*/
+bool save_micro_results(const std::string& file_name, const std::vector<micro_result>& results) {
+	std::ofstream file(file_name);
+	file << "{" << std::endl;
+	file << "  \"isa\": \"" << to_string(detect_isa()) << "\"," << std::endl;
+	file << "  \"seed\": " << SEED << "," << std::endl;
+	file << "  \"rounds\": " << MICRO_ROUNDS << "," << std::endl;
+	file << "  \"benchmarks\": [" << std::endl;
+	file << std::fixed << std::setprecision(3);
+	for (size_t i = 0; i < results.size(); i++) {
+		const micro_result& result = results[i];
+		file << "    { \"name\": \"" << result.m_name << "\", \"calls\": " << result.m_calls
+			<< ", \"ns_per_call\": " << result.m_median_ns << ", \"min_ns_per_call\": " << result.m_min_ns
+			<< ", \"calls_per_second\": " << 1e9 / result.m_median_ns << ", \"result\": " << result.m_result << " }"
+			<< (i + 1 < results.size() ? "," : "") << std::endl;
+	}
+	file << "  ]" << std::endl << "}" << std::endl;
+	return (bool)file.flush();
+}
+
+/**
+	Times the building blocks of a ray: its construction, screen::to_world(), the
+	intersection of the shapes in the hit, miss and backface cases, and the color
+	of a ray by the trace kernel of the detected level, which replaced
+	raytracer::get_color(). The inputs are random with SEED, so the results of two
+	versions are comparable: a result that differs means the code does too.
+
+	@param json_file the file the results are saved to as JSON, or nullptr.
+*/
+void bench_micro_suite(const char* json_file) {
+	std::mt19937 gen(SEED);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	std::uniform_real_distribution<float> centered(-1.f, 1.f);
+	std::vector<micro_result> results;
+
+	std::cout << "microbenchmarks (" << RAY_COUNT << " inputs x " << MICRO_PASSES << " passes, median of "
+		<< MICRO_ROUNDS << " rounds)" << std::endl;
+
+	std::vector<test_ray> test_rays = random_rays(gen);
+	bench_micro("ray construction", (uint64_t)test_rays.size() * MICRO_PASSES, [] {}, [&] {
+		uint64_t positive = 0;
+		for (unsigned int pass = 0; pass < MICRO_PASSES; pass++) {
+			for (const test_ray& test_ray_ : test_rays) {
+				ray ray_(test_ray_.m_origin, test_ray_.m_target);
+				positive += ray_.m_direction.x > 0.f;
+			}
+		}
+		return positive / MICRO_PASSES;
+	}, results);
+
+	camera camera_(glm::vec3(0.f, 0.f, 5.f), 60.f, 1.f, (float)TRACE_WIDTH / TRACE_HEIGHT);
+	screen screen_(camera_, TRACE_HEIGHT);
+	std::vector<glm::vec2> pixels;
+	for (unsigned int i = 0; i < RAY_COUNT; i++) {
+		pixels.push_back(glm::vec2(unit(gen) * TRACE_WIDTH, unit(gen) * TRACE_HEIGHT));
+	}
+	bench_micro("screen::to_world", (uint64_t)pixels.size() * MICRO_PASSES, [] {}, [&] {
+		uint64_t positive = 0;
+		for (unsigned int pass = 0; pass < MICRO_PASSES; pass++) {
+			for (const glm::vec2& pixel : pixels) {
+				positive += screen_.to_world(pixel.x, pixel.y).x > 0.f;
+			}
+		}
+		return positive / MICRO_PASSES;
+	}, results);
+
+	// a unit sphere at the origin, hit by rays towards its center and missed by rays tangent to a larger sphere.
+	sphere sphere_(glm::vec3(0.f), 1.f, 0);
+	std::vector<ray> hits, misses;
+	for (unsigned int i = 0; i < RAY_COUNT; i++) {
+		glm::vec3 origin = random_direction(gen) * 5.f;
+		hits.push_back(ray(origin, random_direction(gen) * .5f * unit(gen)));
+		glm::vec3 tangent = glm::normalize(glm::cross(origin, random_direction(gen)));
+		misses.push_back(ray(origin, origin + tangent));
+	}
+	bench_intersection("sphere hit", sphere_, hits, results);
+	bench_intersection("sphere miss", sphere_, misses, results);
+
+	// the plane y = 0, hit from above and missed by rays parallel to it.
+	plane plane_(XZ_NORM, glm::vec3(0.f), 0);
+	hits.clear();
+	misses.clear();
+	for (unsigned int i = 0; i < RAY_COUNT; i++) {
+		glm::vec3 origin(centered(gen) * 5.f, 1.f + unit(gen) * 4.f, centered(gen) * 5.f);
+		hits.push_back(ray(origin, glm::vec3(centered(gen) * 5.f, 0.f, centered(gen) * 5.f)));
+		misses.push_back(ray(origin, origin + glm::vec3(centered(gen), 0.f, centered(gen))));
+	}
+	bench_intersection("plane hit", plane_, hits, results);
+	bench_intersection("plane miss", plane_, misses, results);
+
+	// a triangle facing +z: hit from the front, missed beside it, and culled from the back.
+	triangle triangle_(glm::vec3(-1.f, -1.f, 0.f), glm::vec3(1.f, -1.f, 0.f), glm::vec3(0.f, 1.f, 0.f), 0);
+	std::vector<ray> backfaces;
+	hits.clear();
+	misses.clear();
+	for (unsigned int i = 0; i < RAY_COUNT; i++) {
+		float u = unit(gen), v = unit(gen);
+		if (u + v > 1.f) {
+			u = 1.f - u;
+			v = 1.f - v;
+		}
+		glm::vec3 inside = (1.f - u - v) * triangle_.m_vertices[0].m_pos + u * triangle_.m_vertices[1].m_pos + v * triangle_.m_vertices[2].m_pos;
+		glm::vec3 beside(2.f + unit(gen) * 2.f, centered(gen), 0.f);
+		glm::vec3 front(centered(gen), centered(gen), 5.f);
+		hits.push_back(ray(front, inside));
+		misses.push_back(ray(front, beside));
+		backfaces.push_back(ray(glm::vec3(front.x, front.y, -5.f), inside));
+	}
+	bench_intersection("triangle hit", triangle_, hits, results);
+	bench_intersection("triangle miss", triangle_, misses, results);
+	bench_intersection("triangle backface", triangle_, backfaces, results);
+
+	// the trace kernel traces one ray per call, with the shadow rays and the shading of its hit.
+	trace_scene trace_scene_;
+	make_trace_scene(gen, camera_.m_position, trace_scene_);
+	screen_view screen_view_ = screen_.get_view();
+	trace_function trace = get_trace(get_kernels(detect_isa()), 1);
+	std::vector<float> offsets;
+	for (unsigned int i = 0; i < MICRO_TRACE_RAYS; i++) {
+		offsets.push_back(unit(gen));
+	}
+	// tested against every shape and triangle, a ray costs thousands of intersections: fewer are traced, once.
+	bench_micro(std::string("trace ray ") + to_string(detect_isa()), MICRO_TRACE_RAYS, [] {}, [&] {
+		uint64_t lit = 0;
+		render_stats stats;
+		for (size_t i = 0; i < MICRO_TRACE_RAYS; i++) {
+			glm::vec3 color = trace(trace_scene_.m_view, screen_view_, std::floor(pixels[i].x), std::floor(pixels[i].y), &offsets[i], 1, stats);
+			lit += color.x + color.y + color.z > 0.f;
+		}
+		return lit;
+	}, results);
+
+	if (json_file) {
+		if (save_micro_results(json_file, results)) std::cout << "Saved " << json_file << "." << std::endl;
+		else std::cerr << "Cannot write " << json_file << "." << std::endl;
+	}
+}
+
+/**
+	Runs the benchmarks.
+
+	Usage: benchmark [--micro] [--json file.json] [file.obj]
+	--micro runs the microbenchmarks only, and --json saves their results.
+	The .obj file is used by the loader benchmark instead of a generated grid.
+*/
+int main(int argc, char** argv) {
+	bool micro_only = false;
+	const char* json_file = nullptr;
+	const char* obj_file = nullptr;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--micro") micro_only = true;
+		else if (arg == "--json" && i + 1 < argc) json_file = argv[++i];
+		else obj_file = argv[i];
+	}
+
+	bench_micro_suite(json_file);
+	if (micro_only) return 0;
+	std::cout << std::endl;
+	bench_triangles();
+	std::cout << std::endl;
+	bench_trace();
+	std::cout << std::endl;
+	bench_sampler();
+	std::cout << std::endl;
+	bench_obj(obj_file);
+	std::cout << std::endl;
+	bench_scene();
+	std::cout << std::endl;
+	bench_framebuffer();
+}
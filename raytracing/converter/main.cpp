@@ -0,0 +1,60 @@
+#include "../src/shapes.h"
+#include "../src/mesh_file.h"
+#include "../src/triangle_records.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+	Prints the usage message and exits.
+
+	@param program the name of the program.
+*/
+void usage(const char* program) {
+	std::cerr << "Usage: " << program << " input.obj|input.ply output.mesh [--triangle moller|woop|havel]..." << std::endl
+		<< "  --triangle   precomputes the records of an intersection algorithm, can be repeated (default: "
+		<< to_string(TRIANGLE_ALGORITHM) << ")" << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+/**
+	Converts an .obj or .ply file to the native mesh format. See mesh_file.h.
+
+	The vertex normals are the smooth normals the renderer computes when it loads
+	the input file, so both files render the same.
+*/
+int main(int argc, char** argv) {
+	if (argc < 3) usage(argv[0]);
+
+	std::vector<triangle_algorithm> algorithms;
+	for (int i = 3; i < argc; i++) {
+		triangle_algorithm algorithm;
+		if (std::string(argv[i]) == "--triangle" && i + 1 < argc && from_string(argv[i + 1], algorithm)) {
+			algorithms.push_back(algorithm);
+			i++;
+		}
+		else usage(argv[0]);
+	}
+	if (algorithms.empty()) algorithms.push_back(TRIANGLE_ALGORITHM);
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> indices;
+	std::string error;
+	if (!mesh::load_triangles(argv[1], positions, indices, error)) {
+		std::cerr << error << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	std::vector<glm::vec3> normals = mesh::get_smooth_normals(positions, indices);
+	if (!write_mesh_file(argv[2], positions, indices, normals, algorithms, error)) {
+		std::cerr << error << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << argv[2] << ": " << positions.size() << " vertices, " << indices.size() / 3 << " triangles in "
+		<< elapsed.count() << " s." << std::endl;
+}
@@ -0,0 +1,198 @@
+#include "aov_buffers.h"
+#include "tile_writer.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+const char* const AOV_NAMES[AOV_TYPE_COUNT] = { "cycles", "tests", "shadow_rays" };
+
+// the colors of the false color images, from 0 to the scale, black to yellow through purple and red.
+const glm::vec3 FALSE_COLORS[] = {
+	{ 0.f, 0.f, 0.02f },
+	{ 0.34f, 0.06f, 0.38f },
+	{ 0.73f, 0.21f, 0.33f },
+	{ 0.98f, 0.55f, 0.04f },
+	{ 0.99f, 1.f, 0.64f }
+};
+const size_t FALSE_COLOR_COUNT = sizeof(FALSE_COLORS) / sizeof(FALSE_COLORS[0]);
+
+// the percentile of the values the false colors end at, so that a few outliers do not darken the image.
+const double SCALE_PERCENTILE = 0.99;
+
+/**
+	@param value the value, from 0 to 1. Clamped.
+	@return glm::vec3 the false color of the value.
+*/
+glm::vec3 false_color(float value) {
+	float position = glm::clamp(value, 0.f, 1.f) * (FALSE_COLOR_COUNT - 1);
+	size_t i = std::min((size_t)position, FALSE_COLOR_COUNT - 2);
+	return glm::mix(FALSE_COLORS[i], FALSE_COLORS[i + 1], position - i);
+}
+
+/**
+	@param values the values.
+	@return float the value the false colors end at: the SCALE_PERCENTILE
+	percentile of the values, or their maximum if it is 0, or 1 if they are all 0.
+*/
+float get_scale(const std::vector<float>& values) {
+	if (values.empty()) return 1.f;
+	std::vector<float> sorted(values);
+	std::vector<float>::iterator percentile = sorted.begin() + (size_t)((sorted.size() - 1) * SCALE_PERCENTILE);
+	std::nth_element(sorted.begin(), percentile, sorted.end());
+	if (*percentile > 0.f) return *percentile;
+	float maximum = *std::max_element(percentile, sorted.end());
+	return maximum > 0.f ? maximum : 1.f;
+}
+
+}
+
+/**
+	Parameterized constructor. The images start at 0.
+
+	@param width the width of the image in pixels.
+	@param height the height of the image in pixels.
+*/
+aov_buffers::aov_buffers(uint32_t width, uint32_t height)
+	:
+	m_width(width),
+	m_height(height)
+{
+	for (std::vector<float>& values : m_values) {
+		values.assign((size_t)width * height, 0.f);
+	}
+}
+
+/**
+	Saves the cost of a pixel. The tiles of a render may call it from any thread,
+	as they set different pixels.
+
+	@param x the column of the pixel.
+	@param y the row of the pixel.
+	@param cycles the cycles spent tracing the pixel.
+	@param stats the counters of the rays of the pixel only.
+*/
+void aov_buffers::set(uint32_t x, uint32_t y, unsigned long long cycles, const render_stats& stats) {
+	size_t index = (size_t)y * m_width + x;
+	uint64_t tests = 0;
+	for (uint64_t shape_tests : stats.m_tests) {
+		tests += shape_tests;
+	}
+	m_values[(size_t)aov_type::cycles][index] = (float)cycles;
+	m_values[(size_t)aov_type::tests][index] = (float)tests;
+	m_values[(size_t)aov_type::shadow_rays][index] = (float)stats.m_shadow_rays;
+}
+
+/**
+	@param type the image.
+	@param x the column of the pixel.
+	@param y the row of the pixel.
+	@return float the value of the pixel in the image.
+*/
+float aov_buffers::get(aov_type type, uint32_t x, uint32_t y) const {
+	return m_values[(size_t)type][(size_t)y * m_width + x];
+}
+
+/**
+	Saves every image twice, next to file_name: as a false color image in the
+	format of file_name, see open_tile_writer(), and as floats in a PFM file. The
+	name of the image is inserted before the extension: cost.png gives
+	cost.cycles.png and cost.cycles.pfm, and so on.
+
+	The false colors go from black for 0 to yellow for the 99th percentile of
+	the image, and the files are listed on the standard output with that value.
+
+	@param file_name the name of the false color images.
+	@param tile_size the side of the tiles the images are written in.
+	@param error [out] the reason the images could not be written.
+	@return bool false on failure.
+*/
+bool aov_buffers::save(const std::string& file_name, uint32_t tile_size, std::string& error) const {
+	size_t dot = file_name.find_last_of('.');
+	if (dot == std::string::npos) {
+		error = file_name + ": unknown image format, use .tif or .png.";
+		return false;
+	}
+	std::string base = file_name.substr(0, dot);
+	std::string extension = file_name.substr(dot);
+
+	for (size_t i = 0; i < AOV_TYPE_COUNT; i++) {
+		std::string name = base + "." + AOV_NAMES[i];
+		float scale = get_scale(m_values[i]);
+		if (!save_false_color(m_values[i], scale, name + extension, tile_size, error)
+			|| !save_pfm(m_values[i], name + ".pfm", error)) {
+			return false;
+		}
+		std::cout << "Saved " << name << extension << " and " << name << ".pfm, " << AOV_NAMES[i]
+			<< " per pixel up to " << scale << " in yellow." << std::endl;
+	}
+	return true;
+}
+
+/**
+	Saves an image as a grayscale PFM file: a text header, then the rows as
+	little endian floats, bottom to top.
+
+	@param values the rows of the image, top to bottom.
+	@param file_name the name of the file.
+	@param error [out] the reason the file could not be written.
+	@return bool false on failure.
+*/
+bool aov_buffers::save_pfm(const std::vector<float>& values, const std::string& file_name, std::string& error) const {
+	std::ofstream file(file_name, std::ios::binary);
+	// a negative scale marks little endian floats, the order of the CPUs of the kernels.
+	file << "Pf\n" << m_width << " " << m_height << "\n-1.0\n";
+	for (uint32_t y = m_height; y-- > 0;) {
+		file.write((const char*)(values.data() + (size_t)y * m_width), m_width * sizeof(float));
+	}
+	if (!file.flush()) {
+		error = "Cannot write " + file_name + ".";
+		return false;
+	}
+	return true;
+}
+
+/**
+	Saves an image in false colors, tile by tile, see tile_writer.
+
+	@param values the rows of the image, top to bottom.
+	@param scale the value of the last false color.
+	@param file_name the name of the file, see open_tile_writer().
+	@param tile_size the side of the tiles.
+	@param error [out] the reason the file could not be written.
+	@return bool false on failure.
+*/
+bool aov_buffers::save_false_color(const std::vector<float>& values, float scale, const std::string& file_name,
+	uint32_t tile_size, std::string& error) const {
+	std::unique_ptr<tile_writer> writer = open_tile_writer(file_name, m_width, m_height, tile_size, error);
+	if (!writer) return false;
+
+	uint64_t tiles_across = writer->tiles_across();
+	uint64_t tile_count = tiles_across * writer->tiles_down();
+	for (uint64_t i = 0; i < tile_count; i++) {
+		tile tile_;
+		tile_.m_index = i;
+		tile_.m_x = (uint32_t)(i % tiles_across * tile_size);
+		tile_.m_y = (uint32_t)(i / tiles_across * tile_size);
+		tile_.m_width = std::min(tile_size, m_width - tile_.m_x);
+		tile_.m_height = std::min(tile_size, m_height - tile_.m_y);
+		tile_.m_pixels = framebuffer(tile_.m_width, tile_.m_height, pixel_format::float32);
+		for (uint32_t y = 0; y < tile_.m_height; y++) {
+			const float* row = values.data() + (size_t)(tile_.m_y + y) * m_width + tile_.m_x;
+			for (uint32_t x = 0; x < tile_.m_width; x++) {
+				tile_.m_pixels.set(x, y, false_color(row[x] / scale));
+			}
+		}
+		if (!writer->write(tile_)) {
+			error = writer->error();
+			return false;
+		}
+	}
+	if (!writer->finish()) {
+		error = writer->error();
+		return false;
+	}
+	return true;
+}
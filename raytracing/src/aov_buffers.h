@@ -0,0 +1,46 @@
+/**
+	The aov_buffers class holds images of the cost of a render, besides the
+	colors: the cycles spent tracing every pixel, the ray-shape tests of its rays
+	(one per triangle of a mesh) and its shadow rays. They show which shapes of a
+	scene are expensive.
+
+	The buffers are filled by the tiles as they are rendered, see
+	raytracer::render_tile(), and saved once the render is done, as false color
+	images and as raw floats. The counts need the counters of the kernels, see
+	RENDER_STATS.
+*/
+#pragma once
+#include "render_stats.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+	The images of aov_buffers.
+*/
+enum class aov_type {
+	cycles,
+	tests,
+	shadow_rays,
+	count
+};
+
+#define AOV_TYPE_COUNT ((size_t)aov_type::count)
+
+class aov_buffers {
+public:
+	aov_buffers(uint32_t width, uint32_t height);
+
+	void set(uint32_t x, uint32_t y, unsigned long long cycles, const render_stats& stats);
+	float get(aov_type type, uint32_t x, uint32_t y) const;
+	bool save(const std::string& file_name, uint32_t tile_size, std::string& error) const;
+
+private:
+	bool save_pfm(const std::vector<float>& values, const std::string& file_name, std::string& error) const;
+	bool save_false_color(const std::vector<float>& values, float scale, const std::string& file_name,
+		uint32_t tile_size, std::string& error) const;
+
+	uint32_t m_width;
+	uint32_t m_height;
+	std::vector<float> m_values[AOV_TYPE_COUNT]; // the rows of every image, top to bottom.
+};
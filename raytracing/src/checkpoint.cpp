@@ -0,0 +1,262 @@
+#include "checkpoint.h"
+#include "fingerprint.h"
+#include "event_trace.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace {
+
+const char CHECKPOINT_MAGIC[4] = { 'R', 'T', 'C', 'K' };
+const uint32_t CHECKPOINT_VERSION = 1;
+
+/**
+	Appends the bytes of a value to a buffer.
+
+	@param buffer the buffer.
+	@param value the value.
+*/
+template <typename T>
+void append(std::vector<unsigned char>& buffer, const T& value) {
+	const unsigned char* bytes = (const unsigned char*)&value;
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+/**
+	Reads a value from a buffer.
+
+	@param p [in, out] the position in the buffer, moved past the value.
+	@param end the end of the buffer.
+	@param value [out] the value.
+	@return bool false if the buffer ends before the value.
+*/
+template <typename T>
+bool extract(const unsigned char*& p, const unsigned char* end, T& value) {
+	if ((size_t)(end - p) < sizeof(T)) return false;
+	std::memcpy(&value, p, sizeof(T));
+	p += sizeof(T);
+	return true;
+}
+
+/**
+	Replaces a file by another one, in one step.
+
+	@param from the new file.
+	@param to the file to replace.
+	@return bool false on failure.
+*/
+bool replace_file(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+}
+
+/**
+	Saves a checkpoint, see checkpoint.
+
+	@param path the path of the checkpoint file.
+	@param checkpoint_ the checkpoint.
+	@param error [out] the reason the file could not be written.
+	@return bool false on failure.
+*/
+bool save_checkpoint(const std::string& path, const checkpoint& checkpoint_, std::string& error) {
+	std::vector<unsigned char> header;
+	header.insert(header.end(), CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + sizeof(CHECKPOINT_MAGIC));
+	append(header, CHECKPOINT_VERSION);
+	append(header, checkpoint_.m_key);
+	append(header, (uint32_t)checkpoint_.m_seed);
+	append(header, (uint32_t)checkpoint_.m_passes);
+	append(header, checkpoint_.m_width);
+	append(header, checkpoint_.m_height);
+	append(header, checkpoint_.m_tile_size);
+	append(header, (uint32_t)checkpoint_.m_format);
+	append(header, (uint64_t)checkpoint_.m_tile_samples.size());
+	for (unsigned int samples : checkpoint_.m_tile_samples) {
+		append(header, (uint32_t)samples);
+	}
+	append(header, (uint64_t)checkpoint_.m_pixels.size());
+	uint64_t hash = hash_bytes(header.data(), header.size()) ^ hash_bytes(checkpoint_.m_pixels.data(), checkpoint_.m_pixels.size());
+
+	std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary);
+		file.write((const char*)header.data(), header.size());
+		file.write((const char*)checkpoint_.m_pixels.data(), checkpoint_.m_pixels.size());
+		file.write((const char*)&hash, sizeof(hash));
+		if (!file.flush()) {
+			error = "Cannot write " + temporary + ".";
+			return false;
+		}
+	}
+	if (!replace_file(temporary, path)) {
+		error = "Cannot replace " + path + ".";
+		return false;
+	}
+	return true;
+}
+
+/**
+	Loads a checkpoint, see checkpoint.
+
+	@param path the path of the checkpoint file.
+	@param checkpoint_ [out] the checkpoint.
+	@param error [out] the reason the file could not be read.
+	@return bool false if the file cannot be read, or is not a valid checkpoint.
+*/
+bool load_checkpoint(const std::string& path, checkpoint& checkpoint_, std::string& error) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		error = "Cannot open " + path + ".";
+		return false;
+	}
+	std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	error = path + " is not a valid checkpoint.";
+	if (data.size() < sizeof(CHECKPOINT_MAGIC) + sizeof(uint64_t) || std::memcmp(data.data(), CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+		return false;
+	}
+
+	const unsigned char* p = data.data() + sizeof(CHECKPOINT_MAGIC);
+	const unsigned char* end = data.data() + data.size() - sizeof(uint64_t);
+	uint32_t version, seed, passes, format;
+	uint64_t tile_count, pixel_size, hash;
+	if (!extract(p, end, version) || version != CHECKPOINT_VERSION || !extract(p, end, checkpoint_.m_key)
+		|| !extract(p, end, seed) || !extract(p, end, passes) || !extract(p, end, checkpoint_.m_width)
+		|| !extract(p, end, checkpoint_.m_height) || !extract(p, end, checkpoint_.m_tile_size) || !extract(p, end, format)
+		|| format > (uint32_t)pixel_format::float32 || !extract(p, end, tile_count) || tile_count > (uint64_t)(end - p) / sizeof(uint32_t)) {
+		return false;
+	}
+	checkpoint_.m_seed = seed;
+	checkpoint_.m_passes = passes;
+	checkpoint_.m_format = (pixel_format)format;
+	checkpoint_.m_tile_samples.resize((size_t)tile_count);
+	for (unsigned int& samples : checkpoint_.m_tile_samples) {
+		uint32_t value = 0;
+		extract(p, end, value);
+		samples = value;
+	}
+	if (!extract(p, end, pixel_size) || pixel_size != (uint64_t)(end - p)) return false;
+	const unsigned char* pixels = p;
+	std::memcpy(&hash, end, sizeof(hash));
+	if ((hash_bytes(data.data(), pixels - data.data()) ^ hash_bytes(pixels, (size_t)pixel_size)) != hash) return false;
+	checkpoint_.m_pixels.assign(pixels, pixels + pixel_size);
+	error.clear();
+	return true;
+}
+
+/**
+	Parameterized constructor. Starts the thread of the writer.
+
+	@param path the path of the checkpoint file.
+	@param interval the time between two checkpoints, in seconds.
+*/
+checkpoint_writer::checkpoint_writer(const std::string& path, unsigned int interval)
+	:
+	m_path(path),
+	m_interval(std::chrono::seconds(interval)),
+	m_last(std::chrono::steady_clock::now()),
+	m_copy_time(0),
+	m_write_time(0),
+	m_thread(&checkpoint_writer::work, this)
+{}
+
+/**
+	Destructor. Saves the queued checkpoint, and stops the thread.
+*/
+checkpoint_writer::~checkpoint_writer() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_changed.notify_all();
+	m_thread.join();
+}
+
+/**
+	@return bool true once the interval has passed since the last checkpoint.
+*/
+bool checkpoint_writer::is_due() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return std::chrono::steady_clock::now() - m_last >= m_interval;
+}
+
+/**
+	Queues a checkpoint to save. A checkpoint that is queued and not started yet
+	is replaced.
+
+	@param checkpoint_ the checkpoint.
+	@param copy_time the time the render spent copying it.
+*/
+void checkpoint_writer::write(std::unique_ptr<checkpoint> checkpoint_, std::chrono::steady_clock::duration copy_time) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queued = std::move(checkpoint_);
+		m_copy_time += copy_time;
+		m_last = std::chrono::steady_clock::now();
+	}
+	m_changed.notify_all();
+}
+
+/**
+	Waits until the queued checkpoint is saved.
+*/
+void checkpoint_writer::finish() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_changed.wait(lock, [this] { return !m_queued && !m_writing; });
+}
+
+/**
+	Prints the number and the size of the checkpoints, and the time spent on
+	them by the render and in the background.
+
+	@param out the stream.
+*/
+void checkpoint_writer::report(std::ostream& out) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::chrono::duration<double, std::milli> copy_time = m_copy_time;
+	std::chrono::duration<double, std::milli> write_time = m_write_time;
+	out << "Checkpoints: " << m_count << " saved, " << m_bytes / 1024 << " KB each, " << copy_time.count()
+		<< " ms copying during the render, " << write_time.count() << " ms writing in the background." << std::endl;
+	if (!m_error.empty()) out << m_error << std::endl;
+}
+
+/**
+	The loop of the thread: saves the queued checkpoints until the writer stops.
+*/
+void checkpoint_writer::work() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_changed.wait(lock, [this] { return m_stop || m_queued; });
+		if (!m_queued) return;
+
+		std::unique_ptr<checkpoint> checkpoint_ = std::move(m_queued);
+		m_writing = true;
+		lock.unlock();
+		auto start = std::chrono::steady_clock::now();
+		std::string error;
+		bool saved;
+		{
+			scoped_event event("checkpoint", "output");
+			saved = save_checkpoint(m_path, *checkpoint_, error);
+		}
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		lock.lock();
+
+		m_writing = false;
+		m_write_time += elapsed;
+		if (saved) {
+			m_count++;
+			m_bytes = checkpoint_->m_pixels.size() + checkpoint_->m_tile_samples.size() * sizeof(uint32_t);
+		}
+		else m_error = error;
+		m_changed.notify_all();
+	}
+}
@@ -0,0 +1,76 @@
+/**
+	The checkpoint struct holds the progress of a render to a file, so that a
+	render that was stopped resumes where it was. See raytracer::run().
+
+	A checkpoint holds the seed of the render, the samples per pixel of every
+	tile, and the pixels of the tiles that have samples: the colors of a tiled
+	render, or the sums of the samples of a progressive render. With the same
+	seed, a resumed render is identical to a render that was not stopped.
+
+	The file is a header, the samples of the tiles, the rows of the tiles that
+	have samples, tile after tile, and a hash of all of it. It is written to a
+	temporary file first, then renamed, so that a render stopped while writing
+	keeps the previous checkpoint.
+*/
+#pragma once
+#include "framebuffer.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct checkpoint {
+	uint64_t m_key = 0; // identifies the scene and the settings the checkpoint is valid for.
+	unsigned int m_seed = 0;
+	unsigned int m_passes = 0; // the complete passes of a progressive render.
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	uint32_t m_tile_size = 0;
+	pixel_format m_format = pixel_format::float32; // the format of m_pixels.
+	std::vector<unsigned int> m_tile_samples; // the samples per pixel of every tile, 0 if it has none.
+	std::vector<unsigned char> m_pixels;
+};
+
+bool save_checkpoint(const std::string& path, const checkpoint& checkpoint_, std::string& error);
+bool load_checkpoint(const std::string& path, checkpoint& checkpoint_, std::string& error);
+
+/**
+	The checkpoint_writer class saves the checkpoints of a render on a thread of
+	its own, so that the render only waits for them to be copied.
+*/
+class checkpoint_writer {
+public:
+	checkpoint_writer(const std::string& path, unsigned int interval);
+	~checkpoint_writer();
+	checkpoint_writer(const checkpoint_writer&) = delete;
+	checkpoint_writer& operator=(const checkpoint_writer&) = delete;
+
+	bool is_due() const;
+	void write(std::unique_ptr<checkpoint> checkpoint_, std::chrono::steady_clock::duration copy_time);
+	void finish();
+	void report(std::ostream& out) const;
+
+private:
+	void work();
+
+	std::string m_path;
+	std::chrono::steady_clock::duration m_interval;
+	std::chrono::steady_clock::time_point m_last; // the time the last checkpoint was taken.
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_changed;
+	std::unique_ptr<checkpoint> m_queued; // the checkpoint to save next, replaced by a newer one.
+	bool m_writing = false;
+	bool m_stop = false;
+	unsigned int m_count = 0;
+	uint64_t m_bytes = 0; // the size of the last checkpoint.
+	std::chrono::steady_clock::duration m_copy_time; // the time the render spent copying the checkpoints.
+	std::chrono::steady_clock::duration m_write_time; // the time spent writing them in the background.
+	std::string m_error;
+	std::thread m_thread;
+};
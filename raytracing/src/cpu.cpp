@@ -0,0 +1,107 @@
+#include "cpu.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#define BIT(n) (1u << (n))
+
+/**
+	Executes the CPUID instruction.
+
+	@param leaf the CPUID leaf.
+	@param subleaf the CPUID subleaf.
+	@param regs [out] the eax, ebx, ecx and edx registers.
+*/
+static void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4]) {
+#ifdef _MSC_VER
+	__cpuidex((int*)regs, (int)leaf, (int)subleaf);
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/**
+	Reads the XCR0 register, which tells which register states the OS saves.
+
+	Must only be called if CPUID reports OSXSAVE.
+
+	@return unsigned long long the content of XCR0.
+*/
+static unsigned long long xgetbv() {
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+/**
+	@param isa_ the instruction set level.
+	@return const char* the name of the level as given on the command line.
+*/
+const char* to_string(isa isa_) {
+	switch (isa_) {
+	case isa::sse42: return "sse4.2";
+	case isa::avx2: return "avx2";
+	case isa::avx512: return "avx512";
+	default: return "generic";
+	}
+}
+
+/**
+	Finds the instruction set level with the given name.
+
+	@param name the name of the level. See to_string().
+	@param isa_ [out] the level, if found.
+	@return bool true if name is a valid level name.
+*/
+bool from_string(const std::string& name, isa& isa_) {
+	const isa levels[] = { isa::generic, isa::sse42, isa::avx2, isa::avx512 };
+
+	for (isa level : levels) {
+		if (name == to_string(level)) {
+			isa_ = level;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+	Detects the highest instruction set level supported by the CPU and the OS.
+
+	AVX2 requires FMA as well, and AVX-512 requires the F, VL, BW and DQ subsets.
+	Both also require the OS to save the extended register state.
+
+	@return isa the highest supported level.
+*/
+isa detect_isa() {
+	unsigned int regs[4];
+	cpuid(0, 0, regs);
+	unsigned int max_leaf = regs[0];
+	if (max_leaf < 7) return isa::generic;
+
+	cpuid(1, 0, regs);
+	unsigned int ecx1 = regs[2];
+	if (!(ecx1 & BIT(20))) return isa::generic; // SSE4.2
+
+	const unsigned int avx_fma_osxsave = BIT(12) | BIT(27) | BIT(28);
+	if ((ecx1 & avx_fma_osxsave) != avx_fma_osxsave) return isa::sse42;
+
+	unsigned long long xcr0 = xgetbv();
+	if ((xcr0 & 0x6) != 0x6) return isa::sse42; // XMM and YMM state
+
+	cpuid(7, 0, regs);
+	unsigned int ebx7 = regs[1];
+	if (!(ebx7 & BIT(5))) return isa::sse42; // AVX2
+
+	const unsigned int avx512 = BIT(16) | BIT(17) | BIT(30) | BIT(31); // F, DQ, BW, VL
+	if ((ebx7 & avx512) != avx512) return isa::avx2;
+	if ((xcr0 & 0xe0) != 0xe0) return isa::avx2; // opmask and ZMM state
+
+	return isa::avx512;
+}
@@ -0,0 +1,19 @@
+/**
+	Detection of the instruction set extensions supported by the CPU.
+*/
+#pragma once
+#include <string>
+
+/**
+	The instruction set levels the kernels are compiled for, from lowest to highest.
+*/
+enum class isa {
+	generic,
+	sse42,
+	avx2,
+	avx512
+};
+
+const char* to_string(isa isa_);
+bool from_string(const std::string& name, isa& isa_);
+isa detect_isa();
@@ -0,0 +1,17 @@
+#pragma once
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+/**
+	Reads the time stamp counter of the CPU.
+
+	Used to measure the cost of short sections of code, such as tracing a single ray.
+
+	@return unsigned long long the current cycle count.
+*/
+inline unsigned long long read_cycles() {
+	return __rdtsc();
+}
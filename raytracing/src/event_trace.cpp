@@ -0,0 +1,177 @@
+#include "event_trace.h"
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+bool event_trace::s_enabled = false;
+
+namespace {
+
+/**
+	The event struct holds an event that ended.
+*/
+struct event {
+	const char* m_name;
+	const char* m_category;
+	int64_t m_arg;
+	std::string m_detail;
+	uint64_t m_start;
+	uint64_t m_end;
+};
+
+/**
+	The thread_events struct holds the ring buffer of the events of a thread.
+	Only the thread writes to it.
+*/
+struct thread_events {
+	unsigned int m_thread; // the threads are numbered in the order they record their first event.
+	std::vector<event> m_events;
+	std::atomic<uint64_t> m_count; // the events recorded, the last ones in m_events.
+};
+
+/**
+	The registry struct holds the buffers of the threads. They are kept once the
+	threads end, so that their events are saved.
+*/
+struct registry {
+	std::mutex m_mutex;
+	std::vector<std::unique_ptr<thread_events>> m_threads;
+	size_t m_capacity = EVENT_TRACE_CAPACITY;
+	uint64_t m_start = 0; // the time recording started, the 0 of the saved times.
+};
+
+/**
+	@return registry& the registry of the program.
+*/
+registry& get_registry() {
+	static registry registry_;
+	return registry_;
+}
+
+/**
+	@return thread_events& the buffer of the calling thread, created on the first call.
+*/
+thread_events& get_thread_events() {
+	thread_local thread_events* events = nullptr;
+	if (!events) {
+		registry& registry_ = get_registry();
+		std::lock_guard<std::mutex> lock(registry_.m_mutex);
+		std::unique_ptr<thread_events> created(new thread_events());
+		created->m_thread = (unsigned int)registry_.m_threads.size();
+		created->m_events.resize(registry_.m_capacity);
+		created->m_count = 0;
+		events = created.get();
+		registry_.m_threads.push_back(std::move(created));
+	}
+	return *events;
+}
+
+/**
+	Writes a text as a JSON string, in quotes.
+
+	@param out the stream.
+	@param text the text.
+*/
+void write_string(std::ostream& out, const char* text) {
+	out << '"';
+	for (const char* c = text; *c; c++) {
+		if (*c == '"' || *c == '\\') out << '\\' << *c;
+		else if ((unsigned char)*c < 0x20) out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)*c << std::dec << std::setfill(' ');
+		else out << *c;
+	}
+	out << '"';
+}
+
+}
+
+/**
+	Starts recording the events. Must be called before the threads that record
+	events start.
+
+	@param capacity [optional] the events kept per thread.
+*/
+void event_trace::enable(size_t capacity) {
+	registry& registry_ = get_registry();
+	registry_.m_capacity = capacity;
+	registry_.m_start = now();
+	s_enabled = true;
+}
+
+/**
+	Records an event that ended on the calling thread. See scoped_event.
+
+	@param name the name of the event.
+	@param category the category of the event.
+	@param arg a number that identifies the event, -1 for none.
+	@param detail a text that identifies the event, or nullptr.
+	@param start the start time of the event, see now().
+	@param end the end time of the event.
+*/
+void event_trace::add(const char* name, const char* category, int64_t arg, const std::string* detail, uint64_t start, uint64_t end) {
+	thread_events& events = get_thread_events();
+	uint64_t count = events.m_count.load(std::memory_order_relaxed);
+	event& event_ = events.m_events[(size_t)(count % events.m_events.size())];
+	event_.m_name = name;
+	event_.m_category = category;
+	event_.m_arg = arg;
+	if (detail) event_.m_detail = *detail;
+	else event_.m_detail.clear();
+	event_.m_start = start;
+	event_.m_end = end;
+	events.m_count.store(count + 1, std::memory_order_release);
+}
+
+/**
+	Saves the recorded events as a Chrome trace: a JSON object with the events
+	of every thread as complete events, in microseconds since recording started.
+	The threads should be idle, as the events they record while saving may be
+	saved half written.
+
+	@param path the path of the JSON file.
+	@param error [out] the reason the file could not be written.
+	@return bool false on failure.
+*/
+bool event_trace::save(const std::string& path, std::string& error) {
+	registry& registry_ = get_registry();
+	std::lock_guard<std::mutex> lock(registry_.m_mutex);
+	std::ofstream file(path);
+	file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+	file << std::fixed << std::setprecision(3);
+	bool first = true;
+	for (const std::unique_ptr<thread_events>& events : registry_.m_threads) {
+		file << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << events->m_thread
+			<< ", \"args\": {\"name\": \"thread " << events->m_thread << "\"}}";
+		first = false;
+
+		uint64_t count = events->m_count.load(std::memory_order_acquire);
+		uint64_t capacity = events->m_events.size();
+		for (uint64_t i = count > capacity ? count - capacity : 0; i < count; i++) {
+			const event& event_ = events->m_events[(size_t)(i % capacity)];
+			file << ",\n{\"name\": ";
+			write_string(file, event_.m_name);
+			file << ", \"cat\": ";
+			write_string(file, event_.m_category);
+			file << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << events->m_thread
+				<< ", \"ts\": " << (event_.m_start - registry_.m_start) * 1e-3 << ", \"dur\": " << (event_.m_end - event_.m_start) * 1e-3;
+			if (event_.m_arg >= 0 || !event_.m_detail.empty()) {
+				file << ", \"args\": {";
+				if (event_.m_arg >= 0) file << "\"id\": " << event_.m_arg << (event_.m_detail.empty() ? "" : ", ");
+				if (!event_.m_detail.empty()) {
+					file << "\"detail\": ";
+					write_string(file, event_.m_detail.c_str());
+				}
+				file << "}";
+			}
+			file << "}";
+		}
+	}
+	file << std::endl << "]}" << std::endl;
+	if (!file.flush()) {
+		error = "Cannot write " + path + ".";
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,86 @@
+/**
+	The event_trace class records when the tasks of a render ran, and on which
+	thread: the tiles, the loading of the meshes, the triangle records, the
+	output and the waits of the thread pool. The events are saved in the Chrome
+	trace format, which Perfetto and chrome://tracing open, to see where threads
+	stall.
+
+	Events are recorded by scoped_event. Every thread appends to a ring buffer of
+	its own, without locks, and the oldest events of a thread are overwritten once
+	its buffer is full. Recording is off unless enable() is called before the
+	threads start: a scoped_event then only tests a flag. An event is recorded
+	when it ends, so the waits of the threads that are still idle are not saved.
+*/
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// the events kept per thread.
+#define EVENT_TRACE_CAPACITY 65536
+
+class event_trace {
+public:
+	static void enable(size_t capacity = EVENT_TRACE_CAPACITY);
+	static bool save(const std::string& path, std::string& error);
+
+	/**
+		@return bool true if the events are recorded.
+	*/
+	static bool is_enabled() {
+		return s_enabled;
+	}
+
+	/**
+		@return uint64_t the time of the steady clock, in nanoseconds.
+	*/
+	static uint64_t now() {
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static void add(const char* name, const char* category, int64_t arg, const std::string* detail, uint64_t start, uint64_t end);
+
+private:
+	static bool s_enabled;
+};
+
+/**
+	The scoped_event class records an event of event_trace, from its construction
+	to its destruction, on the calling thread.
+*/
+class scoped_event {
+public:
+	/**
+		Parameterized constructor.
+
+		@param name the name of the event. Must outlive the program, such as a literal.
+		@param category the category of the event, such as "render". Must outlive the program.
+		@param arg [optional] a number that identifies the event, such as the index of a tile, -1 for none.
+		@param detail [optional] a text that identifies the event, such as a file name. Must outlive the event.
+	*/
+	scoped_event(const char* name, const char* category, int64_t arg = -1, const std::string* detail = nullptr)
+		:
+		m_name(name),
+		m_category(category),
+		m_arg(arg),
+		m_detail(detail),
+		m_start(event_trace::is_enabled() ? event_trace::now() : 0)
+	{}
+
+	/**
+		Destructor. Records the event.
+	*/
+	~scoped_event() {
+		if (event_trace::is_enabled()) event_trace::add(m_name, m_category, m_arg, m_detail, m_start, event_trace::now());
+	}
+
+	scoped_event(const scoped_event&) = delete;
+	scoped_event& operator=(const scoped_event&) = delete;
+
+private:
+	const char* m_name;
+	const char* m_category;
+	int64_t m_arg;
+	const std::string* m_detail;
+	uint64_t m_start;
+};
@@ -0,0 +1,107 @@
+#include "fingerprint.h"
+#include "mapped_file.h"
+#include <sys/stat.h>
+#include <cstring>
+#include <ctime>
+
+/**
+	Reads the size and the time of modification of a file.
+
+	@param path the path of the file.
+	@param size [out] the size in bytes.
+	@param modified [out] the time of modification, in seconds.
+	@return bool false if the file does not exist.
+*/
+static bool get_status(const std::string& path, uint64_t& size, int64_t& modified) {
+#ifdef _WIN32
+	struct _stat64 status;
+	if (_stat64(path.c_str(), &status) != 0) return false;
+#else
+	struct stat status;
+	if (stat(path.c_str(), &status) != 0) return false;
+#endif
+	size = (uint64_t)status.st_size;
+	modified = (int64_t)status.st_mtime;
+	return true;
+}
+
+/**
+	Hashes the content of a file.
+
+	@param path the path of the file.
+	@param hash [out] the hash of the content. See hash_bytes().
+	@return bool false if the file cannot be read.
+*/
+static bool hash_file(const std::string& path, uint64_t& hash) {
+	mapped_file file(path.c_str());
+	if (!file.is_open()) return false;
+	hash = hash_bytes(file.data(), file.size());
+	return true;
+}
+
+/**
+	Takes the fingerprint of a file.
+
+	@param path the path of the file.
+	@param fingerprint [out] the fingerprint.
+	@return bool false if the file cannot be read.
+*/
+bool get_fingerprint(const std::string& path, file_fingerprint& fingerprint) {
+	fingerprint.m_path = path;
+	fingerprint.m_hashed = (int64_t)std::time(nullptr);
+	return get_status(path, fingerprint.m_size, fingerprint.m_modified) && hash_file(path, fingerprint.m_hash);
+}
+
+/**
+	Tells if a file still has the content of its fingerprint.
+
+	The content is hashed again if the size or the time of modification changed,
+	or if the file was modified in the second it was hashed, as the time of
+	modification would not show a change made later in that second. The
+	fingerprint is updated if the content is the same.
+
+	@param fingerprint [in, out] the fingerprint of the file.
+	@return bool true if the file has the same content.
+*/
+bool is_current(file_fingerprint& fingerprint) {
+	uint64_t size;
+	int64_t modified;
+	if (!get_status(fingerprint.m_path, size, modified)) return false;
+	if (size == fingerprint.m_size && modified == fingerprint.m_modified && modified < fingerprint.m_hashed) return true;
+
+	file_fingerprint current;
+	if (!get_fingerprint(fingerprint.m_path, current) || current.m_hash != fingerprint.m_hash) return false;
+	fingerprint = current;
+	return true;
+}
+
+/**
+	Hashes bytes, 8 at a time.
+
+	The hash is not cryptographic: it tells apart the versions of a file.
+
+	@param data the bytes.
+	@param size the number of bytes.
+	@return uint64_t the hash.
+*/
+uint64_t hash_bytes(const void* data, size_t size) {
+	const uint64_t MULTIPLIER = 0x9e3779b97f4a7c15ull;
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = size * MULTIPLIER;
+
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		std::memcpy(&word, bytes + i, 8);
+		hash = (hash ^ (word * MULTIPLIER)) * 0xff51afd7ed558ccdull;
+		hash ^= hash >> 29;
+	}
+	uint64_t tail = 0;
+	if (i < size) std::memcpy(&tail, bytes + i, size - i);
+	hash = (hash ^ (tail * MULTIPLIER)) * 0xff51afd7ed558ccdull;
+
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ull;
+	hash ^= hash >> 33;
+	return hash;
+}
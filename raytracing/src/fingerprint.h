@@ -0,0 +1,24 @@
+/**
+	The file_fingerprint struct identifies the content of a file, to tell if a
+	file that was loaded before has changed since.
+
+	The content is hashed once. Later checks only compare the size and the time
+	of modification of the file, and hash it again if they changed, so a file
+	that is saved again with the same content is still current.
+*/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct file_fingerprint {
+	std::string m_path;
+	uint64_t m_size = 0;
+	int64_t m_modified = 0; // the time of modification, in seconds.
+	int64_t m_hashed = 0; // the time the content was hashed, in seconds.
+	uint64_t m_hash = 0;
+};
+
+bool get_fingerprint(const std::string& path, file_fingerprint& fingerprint);
+bool is_current(file_fingerprint& fingerprint);
+uint64_t hash_bytes(const void* data, size_t size);
@@ -0,0 +1,308 @@
+#include "framebuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+#define SRGB_BUCKETS 4096
+
+/**
+	The srgb_table struct holds the conversions between 8 bit sRGB and linear
+	values. A linear value is encoded as the byte whose decoded value is the
+	nearest, found among the midpoints between decoded values. The value selects
+	a bucket that holds the first candidate byte: buckets are narrower than the
+	gaps between midpoints, so the byte is at most one past the candidate.
+*/
+struct srgb_table {
+	srgb_table() {
+		for (int i = 0; i < 256; i++) {
+			float c = i / 255.f;
+			m_to_linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (int i = 0; i < 255; i++) {
+			m_midpoints[i] = (m_to_linear[i] + m_to_linear[i + 1]) * .5f;
+		}
+		m_midpoints[255] = 2.f;
+		for (int i = 0; i < SRGB_BUCKETS; i++) {
+			float start = i / (float)SRGB_BUCKETS;
+			m_buckets[i] = (unsigned char)(std::upper_bound(m_midpoints, m_midpoints + 255, start) - m_midpoints);
+		}
+	}
+
+	unsigned char encode(float value) const {
+		if (!(value > 0.f)) return 0;
+		if (value >= 1.f) return 255;
+		unsigned char byte = m_buckets[(int)(value * SRGB_BUCKETS)];
+		return byte + (value > m_midpoints[byte]);
+	}
+
+	float m_to_linear[256];
+	float m_midpoints[256]; // the midpoints between decoded values, then a sentinel.
+	unsigned char m_buckets[SRGB_BUCKETS];
+};
+
+const srgb_table& get_srgb_table() {
+	static const srgb_table table;
+	return table;
+}
+
+}
+
+/**
+	@param format the pixel format.
+	@return const char* the name of the format as given on the command line.
+*/
+const char* to_string(pixel_format format) {
+	switch (format) {
+	case pixel_format::half: return "half";
+	case pixel_format::float32: return "float32";
+	default: return "srgb8";
+	}
+}
+
+/**
+	Finds the pixel format with the given name.
+
+	@param name the name of the format. See to_string().
+	@param format [out] the format, if found.
+	@return bool true if name is a valid format name.
+*/
+bool from_string(const std::string& name, pixel_format& format) {
+	const pixel_format formats[] = { pixel_format::srgb8, pixel_format::half, pixel_format::float32 };
+	for (pixel_format format_ : formats) {
+		if (name == to_string(format_)) {
+			format = format_;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+	Converts a float to a 16 bit float, rounding to the nearest even.
+
+	@param value the float.
+	@return uint16_t the bits of the half float.
+*/
+uint16_t to_half(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, 4);
+	uint32_t sign = (bits >> 16) & 0x8000u;
+	uint32_t magnitude = bits & 0x7fffffffu;
+
+	if (magnitude >= 0x7f800000u) return (uint16_t)(sign | 0x7c00u | (magnitude > 0x7f800000u ? 0x200u : 0)); // inf or nan
+	if (magnitude >= 0x477ff000u) return (uint16_t)(sign | 0x7c00u); // overflow
+	if (magnitude < 0x38800000u) {
+		// subnormal: shift the mantissa with its implicit bit, rounding to even.
+		if (magnitude < 0x33000000u) return (uint16_t)sign;
+		uint32_t exponent = magnitude >> 23;
+		uint32_t mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+		uint32_t shift = 126 - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1))) half++;
+		return (uint16_t)(sign | half);
+	}
+
+	uint32_t half = (magnitude - 0x38000000u) >> 13;
+	uint32_t rest = magnitude & 0x1fffu;
+	if (rest > 0x1000u || (rest == 0x1000u && (half & 1))) half++;
+	return (uint16_t)(sign | half);
+}
+
+/**
+	Converts a 16 bit float to a float.
+
+	@param value the bits of the half float.
+	@return float the float.
+*/
+float from_half(uint16_t value) {
+	uint32_t sign = (uint32_t)(value & 0x8000u) << 16;
+	uint32_t exponent = (value >> 10) & 0x1fu;
+	uint32_t mantissa = value & 0x3ffu;
+
+	uint32_t bits;
+	if (exponent == 0x1fu) bits = sign | 0x7f800000u | (mantissa << 13);
+	else if (exponent != 0) bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	else if (mantissa == 0) bits = sign;
+	else {
+		// subnormal: normalize the mantissa.
+		exponent = 113;
+		while (!(mantissa & 0x400u)) {
+			mantissa <<= 1;
+			exponent--;
+		}
+		bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+	}
+
+	float result;
+	std::memcpy(&result, &bits, 4);
+	return result;
+}
+
+/**
+	Default constructor. An empty framebuffer.
+*/
+framebuffer::framebuffer() {}
+
+/**
+	Parameterized constructor.
+
+	The pixels are cleared to black.
+
+	@param width the width in pixels.
+	@param height the height in pixels.
+	@param format the storage format of the pixels.
+*/
+framebuffer::framebuffer(uint32_t width, uint32_t height, pixel_format format)
+	:
+	m_width(width),
+	m_height(height),
+	m_format(format)
+{
+	m_stride = ((size_t)width * pixel_size() + FRAMEBUFFER_ALIGNMENT - 1) / FRAMEBUFFER_ALIGNMENT * FRAMEBUFFER_ALIGNMENT;
+	m_storage.reset(new unsigned char[m_stride * height + FRAMEBUFFER_ALIGNMENT]);
+	m_pixels = m_storage.get() + (FRAMEBUFFER_ALIGNMENT - (uintptr_t)m_storage.get() % FRAMEBUFFER_ALIGNMENT) % FRAMEBUFFER_ALIGNMENT;
+	clear();
+}
+
+/**
+	@return unsigned char* the first byte of the pixel (x, y).
+*/
+unsigned char* framebuffer::pixel(uint32_t x, uint32_t y) const {
+	return m_pixels + (size_t)y * m_stride + (size_t)x * pixel_size();
+}
+
+/**
+	Sets the color of a pixel, converted to the format of the framebuffer.
+
+	@param x the column of the pixel.
+	@param y the row of the pixel.
+	@param color the linear color.
+*/
+void framebuffer::set(uint32_t x, uint32_t y, const glm::vec3& color) {
+	unsigned char* p = pixel(x, y);
+	switch (m_format) {
+	case pixel_format::srgb8: {
+		const srgb_table& table = get_srgb_table();
+		p[0] = table.encode(color.x);
+		p[1] = table.encode(color.y);
+		p[2] = table.encode(color.z);
+		p[3] = 255;
+		break;
+	}
+	case pixel_format::half: {
+		uint16_t channels[4] = { to_half(color.x), to_half(color.y), to_half(color.z), 0x3c00u };
+		std::memcpy(p, channels, sizeof(channels));
+		break;
+	}
+	default: {
+		float channels[4] = { color.x, color.y, color.z, 1.f };
+		std::memcpy(p, channels, sizeof(channels));
+		break;
+	}
+	}
+}
+
+/**
+	@param x the column of the pixel.
+	@param y the row of the pixel.
+	@return glm::vec3 the linear color of the pixel.
+*/
+glm::vec3 framebuffer::get(uint32_t x, uint32_t y) const {
+	const unsigned char* p = pixel(x, y);
+	switch (m_format) {
+	case pixel_format::srgb8: {
+		const float* to_linear = get_srgb_table().m_to_linear;
+		return glm::vec3(to_linear[p[0]], to_linear[p[1]], to_linear[p[2]]);
+	}
+	case pixel_format::half: {
+		uint16_t channels[4];
+		std::memcpy(channels, p, sizeof(channels));
+		return glm::vec3(from_half(channels[0]), from_half(channels[1]), from_half(channels[2]));
+	}
+	default: {
+		float channels[4];
+		std::memcpy(channels, p, sizeof(channels));
+		return glm::vec3(channels[0], channels[1], channels[2]);
+	}
+	}
+}
+
+/**
+	Sets every pixel to black.
+*/
+void framebuffer::clear() {
+	for (uint32_t y = 0; y < m_height; y++) {
+		for (uint32_t x = 0; x < m_width; x++) {
+			set(x, y, glm::vec3(0.f));
+		}
+	}
+}
+
+/**
+	@return uint32_t the width in pixels.
+*/
+uint32_t framebuffer::width() const {
+	return m_width;
+}
+
+/**
+	@return uint32_t the height in pixels.
+*/
+uint32_t framebuffer::height() const {
+	return m_height;
+}
+
+/**
+	@return pixel_format the storage format of the pixels.
+*/
+pixel_format framebuffer::format() const {
+	return m_format;
+}
+
+/**
+	@return size_t the size of a pixel in bytes.
+*/
+size_t framebuffer::pixel_size() const {
+	switch (m_format) {
+	case pixel_format::half: return 4 * sizeof(uint16_t);
+	case pixel_format::float32: return 4 * sizeof(float);
+	default: return 4;
+	}
+}
+
+/**
+	@return size_t the size of a row in bytes, padding included.
+*/
+size_t framebuffer::stride() const {
+	return m_stride;
+}
+
+/**
+	The pixels of a row in the format of the framebuffer, to copy them as they
+	are: width() * pixel_size() bytes, in the byte order of the CPU.
+
+	@param y the row.
+	@return unsigned char* the first byte of the row.
+*/
+unsigned char* framebuffer::row(uint32_t y) {
+	return pixel(0, y);
+}
+
+/**
+	@param y the row.
+	@return const unsigned char* the first byte of the row. See row().
+*/
+const unsigned char* framebuffer::row(uint32_t y) const {
+	return pixel(0, y);
+}
+
+/**
+	@return size_t the memory allocated for the pixels in bytes.
+*/
+size_t framebuffer::memory_usage() const {
+	return m_storage ? m_stride * m_height + FRAMEBUFFER_ALIGNMENT : 0;
+}
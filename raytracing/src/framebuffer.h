@@ -0,0 +1,63 @@
+/**
+	The framebuffer class holds the colors of an image in a compact format.
+
+	Pixels are interleaved, with 4 channels so that a pixel never straddles a
+	cache line: 4 bytes in 8 bit sRGB, 8 bytes in half floats and 16 bytes in
+	floats. Rows start on a cache line, so threads that write tiles whose columns
+	are multiples of 16 pixels never write to the same line. Colors are given and
+	returned in linear space, and converted to the format on the fly.
+*/
+#pragma once
+#include "glm/glm/glm.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#define FRAMEBUFFER_ALIGNMENT 64
+
+/**
+	The storage formats of a framebuffer.
+*/
+enum class pixel_format {
+	srgb8, // 8 bits per channel, sRGB encoded. Clamped to [0, 1].
+	half, // 16 bit floats, for HDR colors.
+	float32 // 32 bit floats, for HDR accumulation.
+};
+
+const char* to_string(pixel_format format);
+bool from_string(const std::string& name, pixel_format& format);
+
+uint16_t to_half(float value);
+float from_half(uint16_t value);
+
+class framebuffer {
+public:
+	framebuffer();
+	framebuffer(uint32_t width, uint32_t height, pixel_format format);
+	framebuffer(framebuffer&&) = default;
+	framebuffer& operator=(framebuffer&&) = default;
+
+	void set(uint32_t x, uint32_t y, const glm::vec3& color);
+	glm::vec3 get(uint32_t x, uint32_t y) const;
+	void clear();
+
+	uint32_t width() const;
+	uint32_t height() const;
+	pixel_format format() const;
+	size_t pixel_size() const;
+	size_t stride() const;
+	unsigned char* row(uint32_t y);
+	const unsigned char* row(uint32_t y) const;
+	size_t memory_usage() const;
+
+private:
+	unsigned char* pixel(uint32_t x, uint32_t y) const;
+
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	pixel_format m_format = pixel_format::srgb8;
+	size_t m_stride = 0; // the size of a row in bytes, a multiple of FRAMEBUFFER_ALIGNMENT.
+	std::unique_ptr<unsigned char[]> m_storage;
+	unsigned char* m_pixels = nullptr; // m_storage, aligned to FRAMEBUFFER_ALIGNMENT.
+};
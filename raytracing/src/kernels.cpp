@@ -0,0 +1,88 @@
+#include "kernels.h"
+
+static const kernels* s_kernels = nullptr;
+static unsigned int s_width = 0;
+
+/**
+	@return const kernels& the kernels selected with select_kernels(), or the
+	kernels of the highest level supported by the CPU if none were selected.
+*/
+const kernels& get_kernels() {
+	if (!s_kernels) s_kernels = &get_kernels(detect_isa());
+	return *s_kernels;
+}
+
+/**
+	@param isa_ the instruction set level.
+	@return const kernels& the kernels compiled for isa_.
+*/
+const kernels& get_kernels(isa isa_) {
+	switch (isa_) {
+	case isa::sse42: return sse42_kernels();
+	case isa::avx2: return avx2_kernels();
+	case isa::avx512: return avx512_kernels();
+	default: return generic_kernels();
+	}
+}
+
+/**
+	Selects the kernels used by the raytracer.
+
+	Must be called before rendering starts, and only with a level that is
+	supported by the CPU. See detect_isa().
+
+	@param isa_ the instruction set level.
+	@param width [optional] the packet width, 0 for the widest one of the level.
+	Must be compiled for the level. See get_trace().
+*/
+void select_kernels(isa isa_, unsigned int width) {
+	s_kernels = &get_kernels(isa_);
+	s_width = width ? width : s_kernels->m_width;
+}
+
+/**
+	@return trace_function the trace kernel of the selected kernels and width.
+*/
+trace_function get_trace() {
+	return get_trace(get_kernels(), get_packet_width());
+}
+
+/**
+	@param kernels_ the kernels of an instruction set level.
+	@param width the packet width.
+	@return trace_function the trace kernel of kernels_ for width, or nullptr if
+	width is not compiled for the level.
+*/
+trace_function get_trace(const kernels& kernels_, unsigned int width) {
+	for (unsigned int i = 0; i < PACKET_WIDTH_COUNT; i++) {
+		if (PACKET_WIDTHS[i] == width) return kernels_.m_trace[i];
+	}
+	return nullptr;
+}
+
+/**
+	@return trace_row_function the trace row kernel of the selected kernels and width.
+*/
+trace_row_function get_trace_row() {
+	return get_trace_row(get_kernels(), get_packet_width());
+}
+
+/**
+	@param kernels_ the kernels of an instruction set level.
+	@param width the packet width.
+	@return trace_row_function the trace row kernel of kernels_ for width, or
+	nullptr if width is not compiled for the level.
+*/
+trace_row_function get_trace_row(const kernels& kernels_, unsigned int width) {
+	for (unsigned int i = 0; i < PACKET_WIDTH_COUNT; i++) {
+		if (PACKET_WIDTHS[i] == width) return kernels_.m_trace_row[i];
+	}
+	return nullptr;
+}
+
+/**
+	@return unsigned int the number of rays traced together by get_trace().
+*/
+unsigned int get_packet_width() {
+	return s_width ? s_width : get_kernels().m_width;
+}
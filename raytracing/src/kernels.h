@@ -0,0 +1,127 @@
+/**
+	The kernels are the hot loops of the raytracer compiled once per instruction set
+	level. The best level supported by the CPU is selected at startup.
+
+	Each kernels_<level>.cpp compiles kernels.inl with the flags of its level. See
+	kernels.inl for the restrictions on what the kernels may call.
+
+	The trace path is compiled for packets of 1, 4, 8 and 16 rays. The width is
+	chosen per machine: the widest one compiled for the selected level.
+*/
+#pragma once
+#include "cpu.h"
+#include "triangle_records.h"
+#include "shapes.h"
+#include "light.h"
+#include "ray.h"
+#include "screen.h"
+#include "render_stats.h"
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define SHADOW_BIAS 0.01f
+#define PACKET_WIDTH_COUNT 4
+
+// the packet widths of kernels::m_trace.
+static const unsigned int PACKET_WIDTHS[PACKET_WIDTH_COUNT] = { 1, 4, 8, 16 };
+
+/**
+	The scene_view struct is the scene as seen by the packet kernels.
+*/
+struct scene_view {
+	const shape_view* m_shapes;
+	unsigned int m_shape_count;
+	const light* m_lights;
+	unsigned int m_light_count;
+	const shape::material* m_materials;
+	glm::vec3 m_eye;
+};
+
+/**
+	Traces count rays through the pixel (u, v), in packets of the width of the kernel.
+
+	Ray i goes through (u + offsets[i], v + offsets[i]) on the screen. See screen::to_world().
+	The rays, tests and hits are added to stats, see render_stats.
+
+	@return glm::vec3 the sum of the colors of the rays.
+*/
+typedef glm::vec3 (*trace_function)(const scene_view& scene_, const screen_view& screen_,
+	float u, float v, const float* offsets, unsigned int count, render_stats& stats);
+
+/**
+	Traces one ray through each of count pixels of a row, from the pixel (u, v),
+	in packets of the width of the kernel.
+
+	Ray i goes through (u + i + offsets[i], v + offsets[i]) on the screen, and its
+	color is saved in colors[i]. See screen::to_world(). The rays, tests and hits
+	are added to stats.
+*/
+typedef void (*trace_row_function)(const scene_view& scene_, const screen_view& screen_,
+	float u, float v, const float* offsets, unsigned int count, glm::vec3* colors, render_stats& stats);
+
+/**
+	Saves the anti-aliasing offsets of count samples of a pixel, from the sample
+	first, in offsets. See sample_offset().
+*/
+typedef void (*sample_offsets_function)(uint32_t key, uint32_t first, unsigned int count, float* offsets);
+
+/**
+	Saves the anti-aliasing offsets of a sample of count pixels of a row, from the
+	pixel (x, y), in offsets. See pixel_key() and sample_offset().
+*/
+typedef void (*row_offsets_function)(uint32_t seed, uint32_t x, uint32_t y, uint32_t sample,
+	unsigned int count, float* offsets);
+
+/**
+	The kernels struct holds the kernels of one instruction set level.
+
+	The intersect kernels compute the closest intersection of a ray with an array of
+	triangle records. If one of the triangles is closer than hit_, they save its time
+	of intersection, index and barycentric coordinates in hit_ and return true.
+
+	The shade kernel computes the phong color of a surface lit by a light.
+
+	The trace kernels hold the whole trace path for each width of PACKET_WIDTHS, or
+	nullptr if the width is wider than the registers of the level. The single ray
+	kernels above are the width 1 instantiations of the same code. The trace row
+	kernels are the same path for packets of one ray per pixel.
+
+	The offsets kernels hash the anti-aliasing offsets of sampler.h 8 or 16 at a
+	time with AVX2 and AVX-512, and one at a time below. Their results are the
+	same at every level.
+*/
+struct kernels {
+	isa m_isa;
+	unsigned int m_width; // the widest packet of the level.
+
+	bool (*m_intersect_moller)(const moller_record* records, unsigned int count,
+		const glm::vec3& origin, const glm::vec3& direction, hit& hit_);
+	bool (*m_intersect_woop)(const woop_record* records, unsigned int count,
+		const glm::vec3& origin, const glm::vec3& direction, hit& hit_);
+	bool (*m_intersect_havel)(const havel_record* records, unsigned int count,
+		const glm::vec3& origin, const glm::vec3& direction, hit& hit_);
+
+	glm::vec3 (*m_shade)(const shape::material& material_, const surface& surface_,
+		const light& light_, const glm::vec3& eye);
+
+	trace_function m_trace[PACKET_WIDTH_COUNT];
+	trace_row_function m_trace_row[PACKET_WIDTH_COUNT];
+	sample_offsets_function m_sample_offsets;
+	row_offsets_function m_row_offsets;
+};
+
+const kernels& get_kernels();
+const kernels& get_kernels(isa isa_);
+void select_kernels(isa isa_, unsigned int width = 0);
+trace_function get_trace();
+trace_function get_trace(const kernels& kernels_, unsigned int width);
+trace_row_function get_trace_row();
+trace_row_function get_trace_row(const kernels& kernels_, unsigned int width);
+unsigned int get_packet_width();
+
+const kernels& generic_kernels();
+const kernels& sse42_kernels();
+const kernels& avx2_kernels();
+const kernels& avx512_kernels();
@@ -0,0 +1,838 @@
+/**
+	The kernels, compiled once per instruction set level by kernels_<level>.cpp.
+
+	Before including this file, define:
+		KERNEL_NAMESPACE the namespace of the kernels of the level.
+		KERNEL_ISA the isa of the level.
+		KERNEL_TABLE the function returning the kernels of the level.
+		KERNEL_WIDTH the widest packet of the level: 4, 8 or 16.
+
+	The trace path (ray generation, intersection and shading) is written once as
+	templates over the packet width W, using the lane types of lanes.inl. A packet
+	holds W rays in lanes. Width 1 is the scalar reference: its masks are bools, so
+	it compiles to the plain branchy code of a single ray.
+
+	Inline functions of other headers (glm, std) must not be called here. They
+	would be compiled for the instruction set of this level, and the linker could
+	pick that copy for the rest of the program, which would then crash on CPUs
+	that do not support it. Only the helpers below and plain C functions are used.
+	Templates of other headers must not be instantiated here either: they are
+	compiled with the flags of their definition, which precedes the flags of the
+	level, so the lane types cannot be passed to them.
+*/
+#include <math.h>
+#include <float.h>
+
+// a * b + c is not fused into an FMA at the levels that have it, so that every
+// level gives the same colors.
+#if defined(_MSC_VER)
+#pragma fp_contract(off)
+#elif defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace KERNEL_NAMESPACE {
+#include "lanes.inl"
+
+namespace {
+
+// a statement that counts for render_stats, removed with RENDER_STATS 0.
+#if RENDER_STATS
+#define COUNT_STATS(statement) statement
+#else
+#define COUNT_STATS(statement)
+#endif
+
+// a statement that times the kernels for render_stats, only kept with RENDER_STATS 2.
+#if RENDER_STATS >= 2
+#define COUNT_CYCLES(statement) statement
+#else
+#define COUNT_CYCLES(statement)
+#endif
+
+/**
+	@return unsigned int the number of lanes set in m.
+*/
+template <int W>
+inline unsigned int lane_count(const vmask<W>& m) {
+	// the bits are summed in pairs, nibbles and bytes, as the generic level has no popcnt.
+	unsigned int v = bits(m);
+	v = v - ((v >> 1) & 0x55555555u);
+	v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+	return (((v + (v >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24;
+}
+
+/**
+	W vectors, one per lane.
+*/
+template <int W>
+struct vvec3 {
+	vfloat<W> x, y, z;
+};
+
+template <int W>
+inline vvec3<W> broadcast(const glm::vec3& v) {
+	vvec3<W> r = { v.x, v.y, v.z };
+	return r;
+}
+
+template <int W>
+inline vvec3<W> broadcast(const glm::vec4& v) {
+	vvec3<W> r = { v.x, v.y, v.z };
+	return r;
+}
+
+template <int W>
+inline vvec3<W> operator+(const vvec3<W>& a, const vvec3<W>& b) {
+	vvec3<W> r = { a.x + b.x, a.y + b.y, a.z + b.z };
+	return r;
+}
+
+template <int W>
+inline vvec3<W> operator-(const vvec3<W>& a, const vvec3<W>& b) {
+	vvec3<W> r = { a.x - b.x, a.y - b.y, a.z - b.z };
+	return r;
+}
+
+template <int W>
+inline vvec3<W> operator*(const vvec3<W>& a, const vfloat<W>& s) {
+	vvec3<W> r = { a.x * s, a.y * s, a.z * s };
+	return r;
+}
+
+template <int W>
+inline vfloat<W> dot(const vvec3<W>& a, const vvec3<W>& b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+template <int W>
+inline vvec3<W> cross(const vvec3<W>& a, const vvec3<W>& b) {
+	vvec3<W> r = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	return r;
+}
+
+template <int W>
+inline vvec3<W> normalize(const vvec3<W>& a) {
+	return a * (vfloat<W>(1.f) / sqrt(dot(a, a)));
+}
+
+template <int W>
+inline vvec3<W> select(const vmask<W>& m, const vvec3<W>& a, const vvec3<W>& b) {
+	vvec3<W> r = { select(m, a.x, b.x), select(m, a.y, b.y), select(m, a.z, b.z) };
+	return r;
+}
+
+/**
+	Loads 3 arrays of W floats in a vvec3.
+*/
+template <int W>
+inline vvec3<W> load(const float (&v)[3][W]) {
+	vvec3<W> r = { vfloat<W>::load(v[0]), vfloat<W>::load(v[1]), vfloat<W>::load(v[2]) };
+	return r;
+}
+
+/**
+	The packet struct holds W rays and their closest hits.
+
+	Only the active lanes are traced. A lane without a hit has m_shape -1.
+*/
+template <int W>
+struct packet {
+	vvec3<W> m_origin;
+	vvec3<W> m_direction;
+	vmask<W> m_active;
+	vfloat<W> m_t;
+	vfloat<W> m_u;
+	vfloat<W> m_v;
+	int m_shape[W];
+	unsigned int m_primitive[W];
+};
+
+template <int W>
+inline void init_packet(packet<W>& packet_, const vvec3<W>& origin, const vvec3<W>& direction, const vmask<W>& active) {
+	packet_.m_origin = origin;
+	packet_.m_direction = direction;
+	packet_.m_active = active;
+	packet_.m_t = FLT_MAX;
+	packet_.m_u = 0.f;
+	packet_.m_v = 0.f;
+	for (int i = 0; i < W; i++) {
+		packet_.m_shape[i] = -1;
+		packet_.m_primitive[i] = 0;
+	}
+}
+
+/**
+	Saves the hits of the lanes of m.
+
+	Closest hits replace the previous ones. Occlusion tests (shadow rays) only
+	deactivate the lanes that were hit.
+
+	@return bool true if every lane of an occlusion test is occluded.
+*/
+template <int W, bool OCCLUSION>
+inline bool save_hits(packet<W>& packet_, const vmask<W>& m, const vfloat<W>& t, const vfloat<W>& u, const vfloat<W>& v,
+	int shape_, unsigned int primitive) {
+	if (OCCLUSION) {
+		packet_.m_active = packet_.m_active & !m;
+		return none(packet_.m_active);
+	}
+
+	packet_.m_t = select(m, t, packet_.m_t);
+	packet_.m_u = select(m, u, packet_.m_u);
+	packet_.m_v = select(m, v, packet_.m_v);
+
+	unsigned int lanes = bits(m);
+	for (int i = 0; i < W; i++) {
+		if (lanes & (1u << i)) {
+			packet_.m_shape[i] = shape_;
+			packet_.m_primitive[i] = primitive;
+		}
+	}
+	return false;
+}
+
+/**
+	MOLLER-TRUMBORE. See intersect(const moller_record&, ...).
+*/
+template <int W, bool OCCLUSION>
+bool intersect(const moller_record* records, unsigned int count, packet<W>& packet_, int shape_) {
+	const vvec3<W>& o = packet_.m_origin;
+	const vvec3<W>& d = packet_.m_direction;
+
+	for (unsigned int i = 0; i < count; i++) {
+		const moller_record& record = records[i];
+		vvec3<W> e1 = broadcast<W>(record.m_e1);
+		vvec3<W> e2 = broadcast<W>(record.m_e2);
+
+		vvec3<W> p = cross(d, e2);
+		vfloat<W> det = dot(p, e1);
+		vmask<W> m = packet_.m_active & (det >= TRIANGLE_EPSILON); // not a back face nor parallel
+		if (none(m)) continue;
+
+		vfloat<W> inv_det = vfloat<W>(1.f) / det;
+		vvec3<W> s = o - broadcast<W>(record.m_v0);
+		vfloat<W> u = dot(p, s) * inv_det;
+		m = m & (u >= 0.f) & (u <= 1.f);
+		if (none(m)) continue;
+
+		vvec3<W> q = cross(s, e1);
+		vfloat<W> v = dot(d, q) * inv_det;
+		m = m & (v >= 0.f) & (u + v <= 1.f);
+		if (none(m)) continue;
+
+		vfloat<W> t = dot(e2, q) * inv_det;
+		m = m & (t > TRIANGLE_EPSILON) & (t <= packet_.m_t);
+		if (none(m)) continue;
+
+		if (save_hits<W, OCCLUSION>(packet_, m, t, u, v, shape_, i)) return true;
+	}
+	return false;
+}
+
+/**
+	WOOP. See intersect(const woop_record&, ...).
+*/
+template <int W, bool OCCLUSION>
+bool intersect(const woop_record* records, unsigned int count, packet<W>& packet_, int shape_) {
+	const vvec3<W>& o = packet_.m_origin;
+	const vvec3<W>& d = packet_.m_direction;
+
+	for (unsigned int i = 0; i < count; i++) {
+		const glm::vec4* rows = records[i].m_rows;
+		vvec3<W> row2 = broadcast<W>(rows[2]);
+
+		vfloat<W> dz = dot(row2, d);
+		vmask<W> m = packet_.m_active & (dz <= -TRIANGLE_EPSILON); // not a back face nor parallel
+		if (none(m)) continue;
+
+		vfloat<W> t = -(dot(row2, o) + rows[2].w) / dz;
+		m = m & (t > TRIANGLE_EPSILON) & (t <= packet_.m_t);
+		if (none(m)) continue;
+
+		vvec3<W> p = o + d * t;
+		vfloat<W> u = dot(broadcast<W>(rows[0]), p) + rows[0].w;
+		m = m & (u >= 0.f) & (u <= 1.f);
+		if (none(m)) continue;
+
+		vfloat<W> v = dot(broadcast<W>(rows[1]), p) + rows[1].w;
+		m = m & (v >= 0.f) & (u + v <= 1.f);
+		if (none(m)) continue;
+
+		if (save_hits<W, OCCLUSION>(packet_, m, t, u, v, shape_, i)) return true;
+	}
+	return false;
+}
+
+/**
+	HAVEL-HEROUT. See intersect(const havel_record&, ...).
+*/
+template <int W, bool OCCLUSION>
+bool intersect(const havel_record* records, unsigned int count, packet<W>& packet_, int shape_) {
+	const vvec3<W>& o = packet_.m_origin;
+	const vvec3<W>& d = packet_.m_direction;
+
+	for (unsigned int i = 0; i < count; i++) {
+		const havel_record& record = records[i];
+		vvec3<W> n0 = broadcast<W>(record.m_n0);
+
+		vfloat<W> det = dot(n0, d);
+		vmask<W> m = packet_.m_active & (det <= -TRIANGLE_EPSILON); // not a back face nor parallel
+		if (none(m)) continue;
+
+		// every value below is scaled by det, which is negative.
+		vfloat<W> t_ = vfloat<W>(record.m_d0) - dot(n0, o);
+		m = m & (t_ < 0.f) & (t_ >= packet_.m_t * det); // in front of the origin and closer than the hit
+		if (none(m)) continue;
+
+		vvec3<W> p = o * det + d * t_;
+		vfloat<W> u_ = dot(broadcast<W>(record.m_n1), p) + det * record.m_d1;
+		m = m & (u_ <= 0.f) & (u_ >= det);
+		if (none(m)) continue;
+
+		vfloat<W> v_ = dot(broadcast<W>(record.m_n2), p) + det * record.m_d2;
+		m = m & (v_ <= 0.f) & (u_ + v_ >= det);
+		if (none(m)) continue;
+
+		vfloat<W> inv_det = vfloat<W>(1.f) / det;
+		vfloat<W> t = t_ * inv_det;
+		m = m & (t > TRIANGLE_EPSILON);
+		if (none(m)) continue;
+
+		if (save_hits<W, OCCLUSION>(packet_, m, t, u_ * inv_det, v_ * inv_det, shape_, i)) return true;
+	}
+	return false;
+}
+
+/**
+	See sphere::intersection().
+*/
+template <int W, bool OCCLUSION>
+bool intersect_sphere(const shape_view& sphere_, packet<W>& packet_, int shape_) {
+	vvec3<W> ray_to_center = packet_.m_origin - broadcast<W>(sphere_.m_position);
+
+	vfloat<W> b = vfloat<W>(2.f) * dot(ray_to_center, packet_.m_direction);
+	vfloat<W> c = dot(ray_to_center, ray_to_center) - sphere_.m_radius * sphere_.m_radius;
+	vfloat<W> delta = b * b - vfloat<W>(4.f) * c;
+	vmask<W> m = packet_.m_active & (delta >= 0.f);
+	if (none(m)) return false;
+
+	vfloat<W> t = (-b - sqrt(delta)) * .5f;
+	m = m & (t > 0.f) & (t <= packet_.m_t);
+	if (none(m)) return false;
+
+	return save_hits<W, OCCLUSION>(packet_, m, t, 0.f, 0.f, shape_, 0);
+}
+
+/**
+	See plane::intersection().
+*/
+template <int W, bool OCCLUSION>
+bool intersect_plane(const shape_view& plane_, packet<W>& packet_, int shape_) {
+	vvec3<W> normal = broadcast<W>(plane_.m_normal);
+	const glm::vec3& n = plane_.m_normal;
+	const glm::vec3& p = plane_.m_position;
+	float d = -(n.x * p.x + n.y * p.y + n.z * p.z);
+
+	vfloat<W> numerator = -(dot(normal, packet_.m_origin) + d);
+	vfloat<W> denominator = dot(normal, packet_.m_direction);
+	vmask<W> m = packet_.m_active & (denominator != 0.f); // else ray and plane are parallel
+	if (none(m)) return false;
+
+	vfloat<W> t = numerator / denominator;
+	m = m & (t > 0.f) & (t <= packet_.m_t);
+	if (none(m)) return false;
+
+	return save_hits<W, OCCLUSION>(packet_, m, t, 0.f, 0.f, shape_, 0);
+}
+
+/**
+	Finds the closest hits of packet_ with the shapes of scene_, or only whether
+	the rays are occluded if OCCLUSION is true. The tests of the active lanes are
+	counted in stats, and in the costs of the shapes if stats has them, with the
+	cycles spent on every shape.
+
+	@return bool true if every lane of an occlusion test is occluded.
+*/
+template <int W, bool OCCLUSION>
+bool intersect(const scene_view& scene_, packet<W>& packet_, render_stats& stats) {
+	// every shape is tested with the lanes active at the start, even occluded ones.
+	COUNT_STATS(uint64_t lanes = lane_count(packet_.m_active));
+	COUNT_STATS(shape_cost* costs = stats.m_shape_costs);
+	for (unsigned int i = 0; i < scene_.m_shape_count; i++) {
+		const shape_view& view = scene_.m_shapes[i];
+		bool occluded = false;
+		COUNT_STATS(uint64_t tests = view.m_type == shape_type::mesh ? lanes * view.m_count : lanes);
+		COUNT_STATS(stats.m_tests[(size_t)view.m_type] += tests);
+		COUNT_STATS(unsigned long long start = costs ? __rdtsc() : 0);
+
+		switch (view.m_type) {
+		case shape_type::plane:
+			occluded = intersect_plane<W, OCCLUSION>(view, packet_, i);
+			break;
+		case shape_type::sphere:
+			occluded = intersect_sphere<W, OCCLUSION>(view, packet_, i);
+			break;
+		case shape_type::triangle: {
+			const vertex* v = (const vertex*)view.m_records;
+			moller_record record(v[0].m_pos, v[1].m_pos, v[2].m_pos);
+			occluded = intersect<W, OCCLUSION>(&record, 1, packet_, i);
+			break;
+		}
+		case shape_type::mesh:
+			switch (view.m_algorithm) {
+			case triangle_algorithm::woop:
+				occluded = intersect<W, OCCLUSION>((const woop_record*)view.m_records, view.m_count, packet_, i);
+				break;
+			case triangle_algorithm::havel_herout:
+				occluded = intersect<W, OCCLUSION>((const havel_record*)view.m_records, view.m_count, packet_, i);
+				break;
+			default:
+				occluded = intersect<W, OCCLUSION>((const moller_record*)view.m_records, view.m_count, packet_, i);
+				break;
+			}
+			break;
+		}
+		COUNT_STATS(if (costs) {
+			costs[i].m_rays += lanes;
+			costs[i].m_tests += tests;
+			costs[i].m_cycles += __rdtsc() - start;
+		})
+		if (occluded) return true;
+	}
+	return false;
+}
+
+/**
+	The surface information at the closest hits of a packet, with their materials.
+*/
+template <int W>
+struct surface_packet {
+	vvec3<W> m_position;
+	vvec3<W> m_normal;
+	vvec3<W> m_ambient;
+	vvec3<W> m_diffuse;
+	vvec3<W> m_specular;
+	vfloat<W> m_shi;
+};
+
+template <int W>
+inline void set_lane(float (&v)[3][W], int lane, const glm::vec3& value) {
+	v[0][lane] = value.x;
+	v[1][lane] = value.y;
+	v[2][lane] = value.z;
+}
+
+/**
+	Computes the surface information at the hits of packet_. See shape::get_surface().
+
+	The normals and materials depend on the shape hit by each lane, so they are
+	gathered lane by lane. Lanes without a hit are left at 0.
+*/
+template <int W>
+void get_surfaces(const scene_view& scene_, const packet<W>& packet_, surface_packet<W>& surfaces) {
+	surfaces.m_position = packet_.m_origin + packet_.m_direction * packet_.m_t;
+
+	float position[3][W];
+	surfaces.m_position.x.store(position[0]);
+	surfaces.m_position.y.store(position[1]);
+	surfaces.m_position.z.store(position[2]);
+	float u[W], v[W];
+	packet_.m_u.store(u);
+	packet_.m_v.store(v);
+
+	float normal[3][W] = {}, ambient[3][W] = {}, diffuse[3][W] = {}, specular[3][W] = {}, shi[W] = {};
+	for (int i = 0; i < W; i++) {
+		if (packet_.m_shape[i] < 0) continue;
+		const shape_view& view = scene_.m_shapes[packet_.m_shape[i]];
+
+		float n[3];
+		switch (view.m_type) {
+		case shape_type::plane:
+			n[0] = view.m_normal.x;
+			n[1] = view.m_normal.y;
+			n[2] = view.m_normal.z;
+			break;
+		case shape_type::sphere:
+			n[0] = position[0][i] - view.m_position.x;
+			n[1] = position[1][i] - view.m_position.y;
+			n[2] = position[2][i] - view.m_position.z;
+			break;
+		default: {
+			// interpolated from the vertex normals of the triangle that was hit.
+			glm::vec3 norm[3];
+			if (view.m_type == shape_type::triangle) {
+				const vertex* vertices = (const vertex*)view.m_records;
+				for (int k = 0; k < 3; k++) norm[k] = vertices[k].m_norm;
+			}
+			else {
+				const glm::vec3* normals = view.m_normals + packet_.m_primitive[i] * 3;
+				for (int k = 0; k < 3; k++) norm[k] = normals[k];
+			}
+			float w = 1.f - u[i] - v[i];
+			n[0] = w * norm[0].x + u[i] * norm[1].x + v[i] * norm[2].x;
+			n[1] = w * norm[0].y + u[i] * norm[1].y + v[i] * norm[2].y;
+			n[2] = w * norm[0].z + u[i] * norm[1].z + v[i] * norm[2].z;
+			break;
+		}
+		}
+		float inv_length = 1.f / sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		for (int k = 0; k < 3; k++) normal[k][i] = n[k] * inv_length;
+
+		const shape::material& material_ = scene_.m_materials[view.m_material];
+		set_lane(ambient, i, material_.m_ambient);
+		set_lane(diffuse, i, material_.m_diffuse);
+		set_lane(specular, i, material_.m_specular);
+		shi[i] = material_.m_shi;
+	}
+
+	surfaces.m_normal = load(normal);
+	surfaces.m_ambient = load(ambient);
+	surfaces.m_diffuse = load(diffuse);
+	surfaces.m_specular = load(specular);
+	surfaces.m_shi = vfloat<W>::load(shi);
+}
+
+/**
+	Phong shading. See raytracer::run().
+*/
+template <int W>
+vvec3<W> shade(const surface_packet<W>& surfaces, const light& light_, const glm::vec3& eye) {
+	const vvec3<W>& normal = surfaces.m_normal;
+
+	vvec3<W> light_dir = normalize(broadcast<W>(light_.m_position) - surfaces.m_position);
+	vfloat<W> n_dot_l = dot(light_dir, normal);
+	vfloat<W> dot_diff = max(n_dot_l, 0.f);
+
+	// reflection of -light_dir about the normal.
+	vvec3<W> view_dir = normalize(broadcast<W>(eye) - surfaces.m_position);
+	vvec3<W> reflection = normal * (n_dot_l * 2.f) - light_dir;
+
+	float dot_spec[W], shi[W];
+	max(dot(view_dir, reflection), 0.f).store(dot_spec);
+	surfaces.m_shi.store(shi);
+	for (int i = 0; i < W; i++) {
+		dot_spec[i] = powf(dot_spec[i], shi[i]);
+	}
+	vfloat<W> spec = vfloat<W>::load(dot_spec);
+
+	vvec3<W> diffuse = { surfaces.m_diffuse.x * light_.m_diffuse.x, surfaces.m_diffuse.y * light_.m_diffuse.y, surfaces.m_diffuse.z * light_.m_diffuse.z };
+	vvec3<W> specular = { surfaces.m_specular.x * light_.m_specular.x, surfaces.m_specular.y * light_.m_specular.y, surfaces.m_specular.z * light_.m_specular.z };
+	return diffuse * dot_diff + specular * spec;
+}
+
+/**
+	Traces the active lanes of packet_ in scene_.
+
+	The closest hits are found first. A shadow packet is then sent from the hits to
+	every light, and the lanes that are not occluded are shaded. The rays and hits
+	are counted in stats, and with RENDER_STATS 2 the cycles spent intersecting and shading.
+
+	@return vvec3<W> the colors of the lanes, 0 for lanes without a hit.
+*/
+template <int W>
+vvec3<W> trace(const scene_view& scene_, packet<W>& packet_, render_stats& stats) {
+	vvec3<W> color = { 0.f, 0.f, 0.f };
+	COUNT_CYCLES(unsigned long long start = __rdtsc());
+	COUNT_STATS(stats.m_primary_rays += lane_count(packet_.m_active));
+
+	intersect<W, false>(scene_, packet_, stats);
+	vmask<W> hit_mask = packet_.m_t < FLT_MAX;
+	COUNT_STATS(unsigned int hits = lane_count(hit_mask));
+	COUNT_STATS(stats.m_hits += hits);
+	COUNT_CYCLES(unsigned long long intersected = __rdtsc());
+	COUNT_CYCLES(stats.m_intersect_cycles += intersected - start);
+	COUNT_CYCLES(unsigned long long shadow_cycles = 0);
+	if (none(hit_mask)) return color;
+
+	surface_packet<W> surfaces;
+	get_surfaces(scene_, packet_, surfaces);
+	vvec3<W> origin = surfaces.m_position + surfaces.m_normal * vfloat<W>(SHADOW_BIAS);
+
+	for (unsigned int i = 0; i < scene_.m_light_count; i++) {
+		const light& light_ = scene_.m_lights[i];
+
+		COUNT_CYCLES(unsigned long long shadow_start = __rdtsc());
+		packet<W> shadow;
+		init_packet(shadow, origin, normalize(broadcast<W>(light_.m_position) - origin), hit_mask);
+		intersect<W, true>(scene_, shadow, stats);
+		COUNT_STATS(stats.m_shadow_rays += hits);
+		COUNT_CYCLES(shadow_cycles += __rdtsc() - shadow_start);
+		if (none(shadow.m_active)) continue; // every lane is in shadows
+
+		color = color + select(shadow.m_active, shade(surfaces, light_, scene_.m_eye), vvec3<W>{ 0.f, 0.f, 0.f });
+	}
+	COUNT_CYCLES(stats.m_intersect_cycles += shadow_cycles);
+	COUNT_CYCLES(stats.m_shade_cycles += __rdtsc() - intersected - shadow_cycles);
+	return color + select(hit_mask, surfaces.m_ambient, vvec3<W>{ 0.f, 0.f, 0.f });
+}
+
+/**
+	See screen::to_world().
+*/
+template <int W>
+inline vvec3<W> to_world(const screen_view& screen_, const vfloat<W>& u, const vfloat<W>& v) {
+	vvec3<W> r = {
+		vfloat<W>(screen_.m_slope_x) * u + screen_.m_intersection_x,
+		-(vfloat<W>(screen_.m_slope_y) * v + screen_.m_intersection_y),
+		screen_.m_z
+	};
+	return r;
+}
+
+/**
+	Single ray wrapper of the width 1 intersection. See kernels::m_intersect_moller.
+*/
+template <typename record>
+bool intersect_ray(const record* records, unsigned int count,
+	const glm::vec3& origin, const glm::vec3& direction, hit& hit_) {
+	packet<1> packet_;
+	init_packet(packet_, broadcast<1>(origin), broadcast<1>(direction), vmask<1>(true));
+	packet_.m_t = hit_.m_t;
+
+	intersect<1, false>(records, count, packet_, 0);
+	if (packet_.m_shape[0] < 0) return false;
+
+	hit_.m_t = packet_.m_t.v;
+	hit_.m_u = packet_.m_u.v;
+	hit_.m_v = packet_.m_v.v;
+	hit_.m_primitive = packet_.m_primitive[0];
+	return true;
+}
+
+}
+
+bool intersect_moller(const moller_record* records, unsigned int count,
+	const glm::vec3& origin, const glm::vec3& direction, hit& hit_) {
+	return intersect_ray(records, count, origin, direction, hit_);
+}
+
+bool intersect_woop(const woop_record* records, unsigned int count,
+	const glm::vec3& origin, const glm::vec3& direction, hit& hit_) {
+	return intersect_ray(records, count, origin, direction, hit_);
+}
+
+bool intersect_havel(const havel_record* records, unsigned int count,
+	const glm::vec3& origin, const glm::vec3& direction, hit& hit_) {
+	return intersect_ray(records, count, origin, direction, hit_);
+}
+
+/**
+	Single ray wrapper of the width 1 shading. See kernels::m_shade.
+*/
+glm::vec3 shade(const shape::material& material_, const surface& surface_,
+	const light& light_, const glm::vec3& eye) {
+	surface_packet<1> surfaces;
+	surfaces.m_position = broadcast<1>(surface_.m_position);
+	surfaces.m_normal = broadcast<1>(surface_.m_normal);
+	surfaces.m_diffuse = broadcast<1>(material_.m_diffuse);
+	surfaces.m_specular = broadcast<1>(material_.m_specular);
+	surfaces.m_shi = material_.m_shi;
+	vvec3<1> color_ = shade(surfaces, light_, eye);
+
+	glm::vec3 color;
+	color.x = color_.x.v;
+	color.y = color_.y.v;
+	color.z = color_.z.v;
+	return color;
+}
+
+/**
+	Ray generation. See trace_function.
+
+	The rays of a packet go through the same pixel, so they stay coherent.
+	The last packet is padded with inactive lanes if count is not a multiple of W.
+	The colors of the samples are summed in the order of the samples, so that the
+	sum does not depend on W.
+*/
+template <int W>
+glm::vec3 trace_pixel(const scene_view& scene_, const screen_view& screen_,
+	float u, float v, const float* offsets, unsigned int count, render_stats& stats) {
+	vvec3<W> eye = broadcast<W>(scene_.m_eye);
+	glm::vec3 sum;
+	sum.x = sum.y = sum.z = 0.f;
+
+	float lane_index[W];
+	for (int i = 0; i < W; i++) lane_index[i] = (float)i;
+
+	for (unsigned int j = 0; j < count; j += W) {
+		unsigned int lanes = count - j < W ? count - j : W;
+		float offset[W] = {};
+		for (unsigned int i = 0; i < lanes; i++) offset[i] = offsets[j + i];
+		vfloat<W> rand = vfloat<W>::load(offset);
+
+		vvec3<W> target = to_world(screen_, vfloat<W>(u) + rand, vfloat<W>(v) + rand);
+
+		packet<W> packet_;
+		vmask<W> active = vfloat<W>::load(lane_index) < (float)lanes;
+		init_packet(packet_, eye, normalize(target - eye), active);
+		vvec3<W> color = trace(scene_, packet_, stats);
+
+		float x[W], y[W], z[W];
+		color.x.store(x);
+		color.y.store(y);
+		color.z.store(z);
+		for (unsigned int i = 0; i < lanes; i++) {
+			sum.x += x[i];
+			sum.y += y[i];
+			sum.z += z[i];
+		}
+	}
+	return sum;
+}
+
+/**
+	Ray generation for one ray per pixel. See trace_row_function.
+
+	The rays of a packet go through neighbouring pixels of a row, so they stay
+	coherent. The last packet is padded with inactive lanes.
+*/
+template <int W>
+void trace_row(const scene_view& scene_, const screen_view& screen_,
+	float u, float v, const float* offsets, unsigned int count, glm::vec3* colors, render_stats& stats) {
+	vvec3<W> eye = broadcast<W>(scene_.m_eye);
+
+	float lane_index[W];
+	for (int i = 0; i < W; i++) lane_index[i] = (float)i;
+
+	for (unsigned int j = 0; j < count; j += W) {
+		unsigned int lanes = count - j < W ? count - j : W;
+		float offset[W] = {};
+		for (unsigned int i = 0; i < lanes; i++) offset[i] = offsets[j + i];
+		vfloat<W> rand = vfloat<W>::load(offset);
+		vfloat<W> column = vfloat<W>::load(lane_index) + vfloat<W>(u + (float)j);
+
+		vvec3<W> target = to_world(screen_, column + rand, vfloat<W>(v) + rand);
+
+		packet<W> packet_;
+		vmask<W> active = vfloat<W>::load(lane_index) < (float)lanes;
+		init_packet(packet_, eye, normalize(target - eye), active);
+		vvec3<W> color = trace(scene_, packet_, stats);
+
+		float x[W], y[W], z[W];
+		color.x.store(x);
+		color.y.store(y);
+		color.z.store(z);
+		for (unsigned int i = 0; i < lanes; i++) {
+			colors[j + i].x = x[i];
+			colors[j + i].y = y[i];
+			colors[j + i].z = z[i];
+		}
+	}
+}
+
+/**
+	The hash of PCG on W lanes. Must give the same bits as pcg_hash() of
+	sampler.h, which cannot be called here.
+*/
+template <int W>
+inline vuint<W> pcg_hash(const vuint<W>& value) {
+	vuint<W> state = value * vuint<W>(747796405u) + vuint<W>(2891336453u);
+	vuint<W> word = ((state >> ((state >> 28u) + vuint<W>(4u))) ^ state) * vuint<W>(277803737u);
+	return (word >> 22u) ^ word;
+}
+
+/**
+	Saves the offsets of W samples, see sample_offset(): the first count lanes of
+	the hashes with the indices of the samples.
+*/
+template <int W>
+inline void store_offsets(const vuint<W>& key, const vuint<W>& index, unsigned int count, float* offsets) {
+	vuint<W> hash = pcg_hash(key ^ (index * vuint<W>(0x9e3779b9u)));
+	vfloat<W> offset = to_float(hash >> 8u) * vfloat<W>(1.f / 16777216.f);
+	if (count >= W) {
+		offset.store(offsets);
+		return;
+	}
+	float lanes[W];
+	offset.store(lanes);
+	for (unsigned int i = 0; i < count; i++) offsets[i] = lanes[i];
+}
+
+/**
+	The offsets of the samples of a pixel, W at a time. See sample_offsets_function.
+*/
+template <int W>
+void sample_offsets(uint32_t key, uint32_t first, unsigned int count, float* offsets) {
+	uint32_t lane_index[W];
+	for (int i = 0; i < W; i++) lane_index[i] = (uint32_t)i;
+	vuint<W> lanes = vuint<W>::load(lane_index);
+	vuint<W> keys(key);
+
+	for (unsigned int j = 0; j < count; j += W) {
+		store_offsets(keys, lanes + vuint<W>(first + j), count - j, offsets + j);
+	}
+}
+
+/**
+	The offsets of a sample of the pixels of a row, W at a time. See
+	row_offsets_function.
+*/
+template <int W>
+void row_offsets(uint32_t seed, uint32_t x, uint32_t y, uint32_t sample, unsigned int count, float* offsets) {
+	uint32_t lane_index[W];
+	for (int i = 0; i < W; i++) lane_index[i] = (uint32_t)i;
+	vuint<W> lanes = vuint<W>::load(lane_index);
+	vuint<W> row = pcg_hash(vuint<W>(y));
+
+	for (unsigned int j = 0; j < count; j += W) {
+		vuint<W> key = pcg_hash(vuint<W>(seed) ^ pcg_hash((lanes + vuint<W>(x + j)) ^ row));
+		store_offsets(key, vuint<W>(sample), count - j, offsets + j);
+	}
+}
+
+}
+
+// the width of the offsets kernels, see vuint.
+#if KERNEL_WIDTH >= 8
+#define OFFSETS_WIDTH KERNEL_WIDTH
+#else
+#define OFFSETS_WIDTH 1
+#endif
+
+/**
+	@return const kernels& the kernels of this instruction set level.
+*/
+const kernels& KERNEL_TABLE() {
+	static const kernels table = {
+		KERNEL_ISA,
+		KERNEL_WIDTH,
+		KERNEL_NAMESPACE::intersect_moller,
+		KERNEL_NAMESPACE::intersect_woop,
+		KERNEL_NAMESPACE::intersect_havel,
+		KERNEL_NAMESPACE::shade,
+		{
+			KERNEL_NAMESPACE::trace_pixel<1>,
+			KERNEL_NAMESPACE::trace_pixel<4>,
+#if KERNEL_WIDTH >= 8
+			KERNEL_NAMESPACE::trace_pixel<8>,
+#else
+			nullptr,
+#endif
+#if KERNEL_WIDTH >= 16
+			KERNEL_NAMESPACE::trace_pixel<16>
+#else
+			nullptr
+#endif
+		},
+		{
+			KERNEL_NAMESPACE::trace_row<1>,
+			KERNEL_NAMESPACE::trace_row<4>,
+#if KERNEL_WIDTH >= 8
+			KERNEL_NAMESPACE::trace_row<8>,
+#else
+			nullptr,
+#endif
+#if KERNEL_WIDTH >= 16
+			KERNEL_NAMESPACE::trace_row<16>
+#else
+			nullptr
+#endif
+		},
+		KERNEL_NAMESPACE::sample_offsets<OFFSETS_WIDTH>,
+		KERNEL_NAMESPACE::row_offsets<OFFSETS_WIDTH>
+	};
+	return table;
+}
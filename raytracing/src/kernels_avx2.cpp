@@ -0,0 +1,16 @@
+/**
+	The kernels compiled for AVX2 and FMA.
+
+	With MSVC, the instruction set is given per file in raytracing.vcxproj.
+*/
+#include "kernels.h"
+
+#if defined(__GNUC__) && !defined(_MSC_VER)
+#pragma GCC target("avx2,fma")
+#endif
+
+#define KERNEL_NAMESPACE avx2_kernels_
+#define KERNEL_ISA isa::avx2
+#define KERNEL_TABLE avx2_kernels
+#define KERNEL_WIDTH 8
+#include "kernels.inl"
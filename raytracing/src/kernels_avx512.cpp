@@ -0,0 +1,16 @@
+/**
+	The kernels compiled for AVX-512 (F, VL, BW, DQ).
+
+	With MSVC, the instruction set is given per file in raytracing.vcxproj.
+*/
+#include "kernels.h"
+
+#if defined(__GNUC__) && !defined(_MSC_VER)
+#pragma GCC target("avx512f,avx512vl,avx512bw,avx512dq,avx2,fma")
+#endif
+
+#define KERNEL_NAMESPACE avx512_kernels_
+#define KERNEL_ISA isa::avx512
+#define KERNEL_TABLE avx512_kernels
+#define KERNEL_WIDTH 16
+#include "kernels.inl"
@@ -0,0 +1,10 @@
+/**
+	The kernels compiled with the baseline flags of the build.
+*/
+#include "kernels.h"
+
+#define KERNEL_NAMESPACE generic_kernels_
+#define KERNEL_ISA isa::generic
+#define KERNEL_TABLE generic_kernels
+#define KERNEL_WIDTH 4
+#include "kernels.inl"
@@ -0,0 +1,17 @@
+/**
+	The kernels compiled for SSE4.2.
+
+	MSVC has no /arch option for SSE4.2, so with MSVC this level is compiled with the
+	baseline flags of the build.
+*/
+#include "kernels.h"
+
+#if defined(__GNUC__) && !defined(_MSC_VER)
+#pragma GCC target("sse4.2")
+#endif
+
+#define KERNEL_NAMESPACE sse42_kernels_
+#define KERNEL_ISA isa::sse42
+#define KERNEL_TABLE sse42_kernels
+#define KERNEL_WIDTH 4
+#include "kernels.inl"
@@ -0,0 +1,226 @@
+/**
+	The SIMD lane types of the kernels.
+
+	vfloat<W> holds W floats and vmask<W> the result of comparing two vfloat<W>.
+	vuint<W> holds W 32 bit integers with wrapping arithmetic, for the hashes of
+	the sample offsets: only widths 1, 8 and 16 have it, as SSE4.2 has no shift
+	by a count per lane. Width 1 is plain scalar code: the mask is a bool, so testing it is a branch and
+	selecting with it costs nothing. Widths 4, 8 and 16 map to SSE, AVX and AVX-512
+	registers, and are only defined when KERNEL_WIDTH allows it.
+
+	The wider types are passed by reference, since 32 bit MSVC cannot pass aligned
+	types by value.
+
+	Included by kernels.inl inside the namespace of the kernels, so that every
+	instruction set level gets its own copy of these functions.
+*/
+
+template <int W> struct vfloat;
+template <int W> struct vmask;
+template <int W> struct vuint;
+
+////////////////////////////////////// width 1 //////////////////////////////////////
+
+template <> struct vmask<1> {
+	vmask() = default;
+	vmask(bool m) : m(m) {}
+	bool m;
+};
+
+template <> struct vfloat<1> {
+	vfloat() = default;
+	vfloat(float v) : v(v) {}
+	static vfloat load(const float* p) { return vfloat(*p); }
+	void store(float* p) const { *p = v; }
+	float v;
+};
+
+inline vfloat<1> operator+(vfloat<1> a, vfloat<1> b) { return a.v + b.v; }
+inline vfloat<1> operator-(vfloat<1> a, vfloat<1> b) { return a.v - b.v; }
+inline vfloat<1> operator*(vfloat<1> a, vfloat<1> b) { return a.v * b.v; }
+inline vfloat<1> operator/(vfloat<1> a, vfloat<1> b) { return a.v / b.v; }
+inline vfloat<1> operator-(vfloat<1> a) { return -a.v; }
+inline vmask<1> operator<(vfloat<1> a, vfloat<1> b) { return a.v < b.v; }
+inline vmask<1> operator<=(vfloat<1> a, vfloat<1> b) { return a.v <= b.v; }
+inline vmask<1> operator>(vfloat<1> a, vfloat<1> b) { return a.v > b.v; }
+inline vmask<1> operator>=(vfloat<1> a, vfloat<1> b) { return a.v >= b.v; }
+inline vmask<1> operator!=(vfloat<1> a, vfloat<1> b) { return a.v != b.v; }
+inline vmask<1> operator&(vmask<1> a, vmask<1> b) { return a.m && b.m; }
+inline vmask<1> operator|(vmask<1> a, vmask<1> b) { return a.m || b.m; }
+inline vmask<1> operator!(vmask<1> a) { return !a.m; }
+inline bool any(vmask<1> m) { return m.m; }
+inline bool none(vmask<1> m) { return !m.m; }
+inline unsigned int bits(vmask<1> m) { return m.m ? 1u : 0u; }
+inline vfloat<1> select(vmask<1> m, vfloat<1> a, vfloat<1> b) { return m.m ? a.v : b.v; }
+inline vfloat<1> min(vfloat<1> a, vfloat<1> b) { return a.v < b.v ? a.v : b.v; }
+inline vfloat<1> max(vfloat<1> a, vfloat<1> b) { return a.v > b.v ? a.v : b.v; }
+inline vfloat<1> sqrt(vfloat<1> a) { return sqrtf(a.v); }
+
+template <> struct vuint<1> {
+	vuint() = default;
+	vuint(uint32_t v) : v(v) {}
+	static vuint load(const uint32_t* p) { return vuint(*p); }
+	uint32_t v;
+};
+
+inline vuint<1> operator+(vuint<1> a, vuint<1> b) { return a.v + b.v; }
+inline vuint<1> operator*(vuint<1> a, vuint<1> b) { return a.v * b.v; }
+inline vuint<1> operator^(vuint<1> a, vuint<1> b) { return a.v ^ b.v; }
+inline vuint<1> operator>>(vuint<1> a, vuint<1> b) { return a.v >> b.v; }
+inline vuint<1> operator>>(vuint<1> a, unsigned int b) { return a.v >> b; }
+inline vfloat<1> to_float(vuint<1> a) { return (float)a.v; }
+
+////////////////////////////////////// width 4 //////////////////////////////////////
+
+template <> struct vmask<4> {
+	vmask() = default;
+	vmask(__m128 m) : m(m) {}
+	vmask(bool b) : m(_mm_castsi128_ps(_mm_set1_epi32(b ? -1 : 0))) {}
+	__m128 m;
+};
+
+template <> struct vfloat<4> {
+	vfloat() = default;
+	vfloat(__m128 v) : v(v) {}
+	vfloat(float f) : v(_mm_set1_ps(f)) {}
+	static vfloat load(const float* p) { return _mm_loadu_ps(p); }
+	void store(float* p) const { _mm_storeu_ps(p, v); }
+	__m128 v;
+};
+
+inline vfloat<4> operator+(const vfloat<4>& a, const vfloat<4>& b) { return _mm_add_ps(a.v, b.v); }
+inline vfloat<4> operator-(const vfloat<4>& a, const vfloat<4>& b) { return _mm_sub_ps(a.v, b.v); }
+inline vfloat<4> operator*(const vfloat<4>& a, const vfloat<4>& b) { return _mm_mul_ps(a.v, b.v); }
+inline vfloat<4> operator/(const vfloat<4>& a, const vfloat<4>& b) { return _mm_div_ps(a.v, b.v); }
+inline vfloat<4> operator-(const vfloat<4>& a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.f)); }
+inline vmask<4> operator<(const vfloat<4>& a, const vfloat<4>& b) { return _mm_cmplt_ps(a.v, b.v); }
+inline vmask<4> operator<=(const vfloat<4>& a, const vfloat<4>& b) { return _mm_cmple_ps(a.v, b.v); }
+inline vmask<4> operator>(const vfloat<4>& a, const vfloat<4>& b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline vmask<4> operator>=(const vfloat<4>& a, const vfloat<4>& b) { return _mm_cmpge_ps(a.v, b.v); }
+inline vmask<4> operator!=(const vfloat<4>& a, const vfloat<4>& b) { return _mm_cmpneq_ps(a.v, b.v); }
+inline vmask<4> operator&(const vmask<4>& a, const vmask<4>& b) { return _mm_and_ps(a.m, b.m); }
+inline vmask<4> operator|(const vmask<4>& a, const vmask<4>& b) { return _mm_or_ps(a.m, b.m); }
+inline vmask<4> operator!(const vmask<4>& a) { return _mm_xor_ps(a.m, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+inline bool any(const vmask<4>& m) { return _mm_movemask_ps(m.m) != 0; }
+inline bool none(const vmask<4>& m) { return _mm_movemask_ps(m.m) == 0; }
+inline unsigned int bits(const vmask<4>& m) { return (unsigned int)_mm_movemask_ps(m.m); }
+inline vfloat<4> select(const vmask<4>& m, const vfloat<4>& a, const vfloat<4>& b) {
+	return _mm_or_ps(_mm_and_ps(m.m, a.v), _mm_andnot_ps(m.m, b.v));
+}
+inline vfloat<4> min(const vfloat<4>& a, const vfloat<4>& b) { return _mm_min_ps(a.v, b.v); }
+inline vfloat<4> max(const vfloat<4>& a, const vfloat<4>& b) { return _mm_max_ps(a.v, b.v); }
+inline vfloat<4> sqrt(const vfloat<4>& a) { return _mm_sqrt_ps(a.v); }
+
+////////////////////////////////////// width 8 //////////////////////////////////////
+
+#if KERNEL_WIDTH >= 8
+template <> struct vmask<8> {
+	vmask() = default;
+	vmask(__m256 m) : m(m) {}
+	vmask(bool b) : m(_mm256_castsi256_ps(_mm256_set1_epi32(b ? -1 : 0))) {}
+	__m256 m;
+};
+
+template <> struct vfloat<8> {
+	vfloat() = default;
+	vfloat(__m256 v) : v(v) {}
+	vfloat(float f) : v(_mm256_set1_ps(f)) {}
+	static vfloat load(const float* p) { return _mm256_loadu_ps(p); }
+	void store(float* p) const { _mm256_storeu_ps(p, v); }
+	__m256 v;
+};
+
+inline vfloat<8> operator+(const vfloat<8>& a, const vfloat<8>& b) { return _mm256_add_ps(a.v, b.v); }
+inline vfloat<8> operator-(const vfloat<8>& a, const vfloat<8>& b) { return _mm256_sub_ps(a.v, b.v); }
+inline vfloat<8> operator*(const vfloat<8>& a, const vfloat<8>& b) { return _mm256_mul_ps(a.v, b.v); }
+inline vfloat<8> operator/(const vfloat<8>& a, const vfloat<8>& b) { return _mm256_div_ps(a.v, b.v); }
+inline vfloat<8> operator-(const vfloat<8>& a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.f)); }
+inline vmask<8> operator<(const vfloat<8>& a, const vfloat<8>& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+inline vmask<8> operator<=(const vfloat<8>& a, const vfloat<8>& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+inline vmask<8> operator>(const vfloat<8>& a, const vfloat<8>& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+inline vmask<8> operator>=(const vfloat<8>& a, const vfloat<8>& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+inline vmask<8> operator!=(const vfloat<8>& a, const vfloat<8>& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ); }
+inline vmask<8> operator&(const vmask<8>& a, const vmask<8>& b) { return _mm256_and_ps(a.m, b.m); }
+inline vmask<8> operator|(const vmask<8>& a, const vmask<8>& b) { return _mm256_or_ps(a.m, b.m); }
+inline vmask<8> operator!(const vmask<8>& a) { return _mm256_xor_ps(a.m, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+inline bool any(const vmask<8>& m) { return _mm256_movemask_ps(m.m) != 0; }
+inline bool none(const vmask<8>& m) { return _mm256_movemask_ps(m.m) == 0; }
+inline unsigned int bits(const vmask<8>& m) { return (unsigned int)_mm256_movemask_ps(m.m); }
+inline vfloat<8> select(const vmask<8>& m, const vfloat<8>& a, const vfloat<8>& b) { return _mm256_blendv_ps(b.v, a.v, m.m); }
+inline vfloat<8> min(const vfloat<8>& a, const vfloat<8>& b) { return _mm256_min_ps(a.v, b.v); }
+inline vfloat<8> max(const vfloat<8>& a, const vfloat<8>& b) { return _mm256_max_ps(a.v, b.v); }
+inline vfloat<8> sqrt(const vfloat<8>& a) { return _mm256_sqrt_ps(a.v); }
+
+template <> struct vuint<8> {
+	vuint() = default;
+	vuint(__m256i v) : v(v) {}
+	vuint(uint32_t u) : v(_mm256_set1_epi32((int)u)) {}
+	static vuint load(const uint32_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+	__m256i v;
+};
+
+inline vuint<8> operator+(const vuint<8>& a, const vuint<8>& b) { return _mm256_add_epi32(a.v, b.v); }
+inline vuint<8> operator*(const vuint<8>& a, const vuint<8>& b) { return _mm256_mullo_epi32(a.v, b.v); }
+inline vuint<8> operator^(const vuint<8>& a, const vuint<8>& b) { return _mm256_xor_si256(a.v, b.v); }
+inline vuint<8> operator>>(const vuint<8>& a, const vuint<8>& b) { return _mm256_srlv_epi32(a.v, b.v); }
+inline vuint<8> operator>>(const vuint<8>& a, unsigned int b) { return _mm256_srl_epi32(a.v, _mm_cvtsi32_si128((int)b)); }
+// exact for values below 2^31.
+inline vfloat<8> to_float(const vuint<8>& a) { return _mm256_cvtepi32_ps(a.v); }
+#endif
+
+////////////////////////////////////// width 16 //////////////////////////////////////
+
+#if KERNEL_WIDTH >= 16
+template <> struct vmask<16> {
+	vmask() = default;
+	vmask(__mmask16 m) : m(m) {}
+	vmask(bool b) : m(b ? (__mmask16)0xffff : (__mmask16)0) {}
+	__mmask16 m;
+};
+
+template <> struct vfloat<16> {
+	vfloat() = default;
+	vfloat(__m512 v) : v(v) {}
+	vfloat(float f) : v(_mm512_set1_ps(f)) {}
+	static vfloat load(const float* p) { return _mm512_loadu_ps(p); }
+	void store(float* p) const { _mm512_storeu_ps(p, v); }
+	__m512 v;
+};
+
+inline vfloat<16> operator+(const vfloat<16>& a, const vfloat<16>& b) { return _mm512_add_ps(a.v, b.v); }
+inline vfloat<16> operator-(const vfloat<16>& a, const vfloat<16>& b) { return _mm512_sub_ps(a.v, b.v); }
+inline vfloat<16> operator*(const vfloat<16>& a, const vfloat<16>& b) { return _mm512_mul_ps(a.v, b.v); }
+inline vfloat<16> operator/(const vfloat<16>& a, const vfloat<16>& b) { return _mm512_div_ps(a.v, b.v); }
+inline vfloat<16> operator-(const vfloat<16>& a) { return _mm512_sub_ps(_mm512_setzero_ps(), a.v); }
+inline vmask<16> operator<(const vfloat<16>& a, const vfloat<16>& b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ); }
+inline vmask<16> operator<=(const vfloat<16>& a, const vfloat<16>& b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ); }
+inline vmask<16> operator>(const vfloat<16>& a, const vfloat<16>& b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ); }
+inline vmask<16> operator>=(const vfloat<16>& a, const vfloat<16>& b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ); }
+inline vmask<16> operator!=(const vfloat<16>& a, const vfloat<16>& b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_NEQ_UQ); }
+inline vmask<16> operator&(const vmask<16>& a, const vmask<16>& b) { return (__mmask16)(a.m & b.m); }
+inline vmask<16> operator|(const vmask<16>& a, const vmask<16>& b) { return (__mmask16)(a.m | b.m); }
+inline vmask<16> operator!(const vmask<16>& a) { return (__mmask16)~a.m; }
+inline bool any(const vmask<16>& m) { return m.m != 0; }
+inline bool none(const vmask<16>& m) { return m.m == 0; }
+inline unsigned int bits(const vmask<16>& m) { return m.m; }
+inline vfloat<16> select(const vmask<16>& m, const vfloat<16>& a, const vfloat<16>& b) { return _mm512_mask_blend_ps(m.m, b.v, a.v); }
+inline vfloat<16> min(const vfloat<16>& a, const vfloat<16>& b) { return _mm512_min_ps(a.v, b.v); }
+inline vfloat<16> max(const vfloat<16>& a, const vfloat<16>& b) { return _mm512_max_ps(a.v, b.v); }
+inline vfloat<16> sqrt(const vfloat<16>& a) { return _mm512_sqrt_ps(a.v); }
+
+template <> struct vuint<16> {
+	vuint() = default;
+	vuint(__m512i v) : v(v) {}
+	vuint(uint32_t u) : v(_mm512_set1_epi32((int)u)) {}
+	static vuint load(const uint32_t* p) { return _mm512_loadu_si512((const void*)p); }
+	__m512i v;
+};
+
+inline vuint<16> operator+(const vuint<16>& a, const vuint<16>& b) { return _mm512_add_epi32(a.v, b.v); }
+inline vuint<16> operator*(const vuint<16>& a, const vuint<16>& b) { return _mm512_mullo_epi32(a.v, b.v); }
+inline vuint<16> operator^(const vuint<16>& a, const vuint<16>& b) { return _mm512_xor_si512(a.v, b.v); }
+inline vuint<16> operator>>(const vuint<16>& a, const vuint<16>& b) { return _mm512_srlv_epi32(a.v, b.v); }
+inline vuint<16> operator>>(const vuint<16>& a, unsigned int b) { return _mm512_srl_epi32(a.v, _mm_cvtsi32_si128((int)b)); }
+// exact for values below 2^31.
+inline vfloat<16> to_float(const vuint<16>& a) { return _mm512_cvtepi32_ps(a.v); }
+#endif
@@ -1,15 +1,134 @@
 #include "scene.h"
 #include "screen.h"
 #include "raytracer.h"
+#include "options.h"
+#include "kernels.h"
+#include "tile_writer.h"
+#include "render_server.h"
+#include "render_worker.h"
+#include "render_coordinator.h"
+#include "sequence_renderer.h"
+#include "event_trace.h"
 #include "CImg-2.5.5/CImg.h"
 
-int main() {
+/**
+	Saves the events of the threads to the file of the options, if one was
+	given. See event_trace.
+
+	@param options_ the command line options.
+*/
+static void save_events(const options& options_) {
+	if (options_.m_events.empty()) return;
+	std::string error;
+	if (event_trace::save(options_.m_events, error)) std::cout << "Saved " << options_.m_events << "." << std::endl;
+	else std::cerr << error << std::endl;
+}
+
+int main(int argc, char** argv) {
+	options options_(argc, argv);
+
+	isa detected = detect_isa();
+	if (options_.m_force_isa && options_.m_isa > detected) {
+		std::cerr << "This CPU does not support " << to_string(options_.m_isa) << "." << std::endl;
+		return EXIT_FAILURE;
+	}
+	const kernels& kernels_ = get_kernels(options_.m_force_isa ? options_.m_isa : detected);
+	if (options_.m_width > kernels_.m_width) {
+		std::cerr << "The " << to_string(kernels_.m_isa) << " kernels trace at most "
+			<< kernels_.m_width << " rays per packet." << std::endl;
+		return EXIT_FAILURE;
+	}
+	select_kernels(kernels_.m_isa, options_.m_width);
+	std::cout << "Using " << to_string(get_kernels().m_isa) << " kernels, " << get_packet_width()
+		<< " rays per packet (detected " << to_string(detected) << ")." << std::endl;
+
+	if (!options_.m_send.empty()) {
+		std::string error;
+		if (!send_request(options_.m_send, options_.m_request, std::cout, error)) {
+			std::cerr << error << std::endl;
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+	if (options_.m_worker_port) {
+		std::string error;
+		render_worker worker(options_);
+		worker.run((uint16_t)options_.m_worker_port, error);
+		std::cerr << error << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (!options_.m_workers.empty() && (options_.m_output.empty() || options_.m_budget || options_.m_samples)) {
+		std::cerr << "--workers renders to the file given by --output, and does not render progressively." << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (options_.m_sequence && (options_.m_output.empty() || !options_.m_workers.empty())) {
+		std::cerr << "--frames renders to the files given by --output, on this machine." << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (!options_.m_checkpoint.empty() && (options_.m_output.empty() || !options_.m_workers.empty() || options_.m_sequence || !options_.m_serve.empty())) {
+		std::cerr << "--checkpoint saves the render of the file given by --output, on this machine." << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (!options_.m_aovs.empty() && (options_.m_budget || options_.m_samples || !options_.m_workers.empty()
+		|| options_.m_sequence || !options_.m_checkpoint.empty() || !options_.m_serve.empty())) {
+		std::cerr << "--aovs saves the cost of the pixels of a tiled render of a single image, on this machine." << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (!options_.m_events.empty()) {
+		if (!options_.m_serve.empty()) {
+			std::cerr << "--trace-events saves the events of a render, not of a server." << std::endl;
+			return EXIT_FAILURE;
+		}
+		event_trace::enable();
+	}
+	if (!options_.m_serve.empty()) {
+		std::string error;
+		render_server server(options_);
+		if (!server.run(options_.m_serve, error)) {
+			std::cerr << error << std::endl;
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
 	while (true) {
-		scene scene_;
-		screen screen_(*scene_.m_camera);
-		cimg_library::CImg<float> image(screen_.m_width, screen_.m_height, 1, 3, 0);
+		scene scene_(options_);
+		screen screen_(*scene_.m_camera, options_.m_height ? (float)options_.m_height : -1.f);
+		raytracer raytracer_(scene_, screen_, options_);
+
+		if (options_.m_output.empty()) {
+			raytracer_.run();
+			save_events(options_);
+			continue;
+		}
+
+		std::string error;
+		if (options_.m_sequence) {
+			sequence_renderer sequence(scene_, raytracer_, options_);
+			if (!sequence.run(error)) {
+				std::cerr << error << std::endl;
+				return EXIT_FAILURE;
+			}
+			save_events(options_);
+			return EXIT_SUCCESS;
+		}
 
-		raytracer raytracer_(scene_, screen_, image);
-		raytracer_.run();
+		// streams the tiles to the file, for images too large to be held in memory.
+		std::unique_ptr<tile_writer> writer = open_tile_writer(options_.m_output,
+			(uint32_t)screen_.m_width, (uint32_t)screen_.m_height, options_.m_tile_size, error);
+		if (writer && !options_.m_workers.empty()) {
+			render_coordinator coordinator(options_);
+			if (!coordinator.run(scene_, screen_, *writer, error)) {
+				std::cerr << error << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if (!writer || !raytracer_.run(*writer)) {
+			std::cerr << (writer ? writer->error() : error) << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::cout << "Saved " << options_.m_output << "." << std::endl;
+		save_events(options_);
+		return EXIT_SUCCESS;
 	}
 }
\ No newline at end of file
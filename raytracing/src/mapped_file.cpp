@@ -0,0 +1,88 @@
+#include "mapped_file.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+	Parameterized constructor.
+
+	Maps file_name in memory. An empty file is open, with no data. See is_open().
+
+	@param file_name the file to map.
+*/
+mapped_file::mapped_file(const char* file_name) {
+#ifdef _WIN32
+	m_file = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (m_file == INVALID_HANDLE_VALUE) {
+		m_file = nullptr;
+		return;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size)) return;
+	m_size = (size_t)size.QuadPart;
+	m_open = true;
+	if (m_size == 0) return;
+
+	m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_mapping) m_data = (const char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!m_data) m_open = false;
+#else
+	int file = open(file_name, O_RDONLY);
+	if (file < 0) return;
+
+	struct stat status;
+	if (fstat(file, &status) == 0) {
+		m_size = (size_t)status.st_size;
+		m_open = true;
+		if (m_size > 0) {
+			void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+			if (data == MAP_FAILED) m_open = false;
+			else {
+				m_data = (const char*)data;
+				madvise(data, m_size, MADV_SEQUENTIAL);
+			}
+		}
+	}
+	close(file); // the mapping keeps the file open.
+#endif
+}
+
+mapped_file::~mapped_file() {
+#ifdef _WIN32
+	if (m_data) UnmapViewOfFile(m_data);
+	if (m_mapping) CloseHandle(m_mapping);
+	if (m_file) CloseHandle(m_file);
+#else
+	if (m_data) munmap((void*)m_data, m_size);
+#endif
+}
+
+/**
+	@return bool true if the file was mapped.
+*/
+bool mapped_file::is_open() const {
+	return m_open;
+}
+
+/**
+	@return const char* the content of the file, nullptr if it is empty.
+*/
+const char* mapped_file::data() const {
+	return m_data;
+}
+
+/**
+	@return size_t the size of the file in bytes.
+*/
+size_t mapped_file::size() const {
+	return m_size;
+}
@@ -0,0 +1,26 @@
+/**
+	The mapped_file class maps a whole file in memory, read only.
+*/
+#pragma once
+#include <cstddef>
+
+class mapped_file {
+public:
+	mapped_file(const char* file_name);
+	~mapped_file();
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	bool is_open() const;
+	const char* data() const;
+	size_t size() const;
+
+private:
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+	bool m_open = false;
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#endif
+};
@@ -0,0 +1,76 @@
+#include "mesh_cache.h"
+
+/**
+	Finds the mesh of a file. A mesh whose file has changed is removed.
+
+	@param path the path of the mesh file.
+	@param algorithm the triangle intersection algorithm of the records.
+	@return std::shared_ptr<const mesh> the mesh, or nullptr if it is not cached.
+*/
+std::shared_ptr<const mesh> mesh_cache::find(const std::string& path, triangle_algorithm algorithm) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto found = m_entries.find(std::make_pair(path, algorithm));
+	if (found == m_entries.end()) return nullptr;
+	if (!is_current(found->second.m_fingerprint)) {
+		m_entries.erase(found);
+		return nullptr;
+	}
+	return found->second.m_mesh;
+}
+
+/**
+	Adds the mesh of a file, replacing the previous one.
+
+	@param fingerprint the fingerprint of the file, taken before it was loaded.
+	@param algorithm the triangle intersection algorithm of the records.
+	@param mesh_ the mesh.
+*/
+void mesh_cache::insert(const file_fingerprint& fingerprint, triangle_algorithm algorithm, const std::shared_ptr<const mesh>& mesh_) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries[std::make_pair(fingerprint.m_path, algorithm)] = { fingerprint, mesh_ };
+}
+
+/**
+	Finds the fingerprint of the file of a mesh, as it was when the mesh was
+	loaded.
+
+	@param path the path of the mesh file.
+	@param algorithm the triangle intersection algorithm of the records.
+	@param fingerprint [out] the fingerprint.
+	@return bool false if the mesh is not cached.
+*/
+bool mesh_cache::find_fingerprint(const std::string& path, triangle_algorithm algorithm, file_fingerprint& fingerprint) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto found = m_entries.find(std::make_pair(path, algorithm));
+	if (found == m_entries.end()) return false;
+	fingerprint = found->second.m_fingerprint;
+	return true;
+}
+
+/**
+	Removes every mesh. Scenes that use them keep them alive.
+*/
+void mesh_cache::clear() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries.clear();
+}
+
+/**
+	@return size_t the number of meshes.
+*/
+size_t mesh_cache::size() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.size();
+}
+
+/**
+	@return size_t the memory used by the meshes in bytes, mapped files included.
+*/
+size_t mesh_cache::memory_usage() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t bytes = 0;
+	for (const auto& entry_ : m_entries) {
+		bytes += entry_.second.m_mesh->memory_usage() + entry_.second.m_mesh->mapped_memory();
+	}
+	return bytes;
+}
@@ -0,0 +1,39 @@
+/**
+	The mesh_cache class keeps the meshes loaded by scenes, so that the scenes
+	that use the same mesh file share its triangles, and a scene that is loaded
+	again does not load its meshes again.
+
+	Meshes are found by path and triangle algorithm, and are only used while
+	their file has the content it had when they were loaded. See
+	file_fingerprint. The cache may be used by several threads.
+*/
+#pragma once
+#include "shapes.h"
+#include "fingerprint.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+class mesh_cache {
+public:
+	std::shared_ptr<const mesh> find(const std::string& path, triangle_algorithm algorithm);
+	void insert(const file_fingerprint& fingerprint, triangle_algorithm algorithm, const std::shared_ptr<const mesh>& mesh_);
+	bool find_fingerprint(const std::string& path, triangle_algorithm algorithm, file_fingerprint& fingerprint) const;
+	void clear();
+	size_t size() const;
+	size_t memory_usage() const;
+
+private:
+	/**
+		The entry struct holds a mesh and the fingerprint of its file.
+	*/
+	struct entry {
+		file_fingerprint m_fingerprint;
+		std::shared_ptr<const mesh> m_mesh;
+	};
+
+	mutable std::mutex m_mutex;
+	std::map<std::pair<std::string, triangle_algorithm>, entry> m_entries;
+};
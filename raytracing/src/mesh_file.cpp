@@ -0,0 +1,243 @@
+#include "mesh_file.h"
+#include <cstring>
+#include <fstream>
+
+static_assert(sizeof(glm::vec3) == 12, "positions and normals are stored as 3 floats");
+static_assert(sizeof(unsigned int) == 4, "indices are stored as 32 bit integers");
+
+/**
+	Parameterized constructor.
+
+	Maps file_name in memory and validates it. See is_valid().
+
+	@param file_name the mesh file.
+*/
+mesh_file::mesh_file(const char* file_name) : m_file(file_name) {
+	validate(file_name);
+}
+
+/**
+	@return bool true if the file was mapped and is a valid mesh file.
+*/
+bool mesh_file::is_valid() const {
+	return m_error.empty();
+}
+
+/**
+	@return const std::string& the reason why the file is not valid.
+*/
+const std::string& mesh_file::error() const {
+	return m_error;
+}
+
+/**
+	@return size_t the size of the file in bytes.
+*/
+size_t mesh_file::size() const {
+	return m_file.size();
+}
+
+/**
+	@return const mesh_file_header& the header. Only if is_valid().
+*/
+const mesh_file_header& mesh_file::header() const {
+	return *(const mesh_file_header*)m_file.data();
+}
+
+/**
+	@return const glm::vec3* the vertex positions.
+*/
+const glm::vec3* mesh_file::positions() const {
+	return (const glm::vec3*)(m_file.data() + header().m_positions);
+}
+
+/**
+	@return const unsigned int* the indices of the vertices of the triangles, 3 per triangle.
+*/
+const unsigned int* mesh_file::indices() const {
+	return (const unsigned int*)(m_file.data() + header().m_indices);
+}
+
+/**
+	@return const glm::vec3* the vertex normals, 3 per triangle.
+*/
+const glm::vec3* mesh_file::normals() const {
+	return (const glm::vec3*)(m_file.data() + header().m_normals);
+}
+
+/**
+	@param algorithm the triangle intersection algorithm.
+	@return const void* the triangle records of algorithm, or nullptr if the file has none.
+*/
+const void* mesh_file::records(triangle_algorithm algorithm) const {
+	uint64_t offset = header().m_records[(int)algorithm];
+	return offset ? m_file.data() + offset : nullptr;
+}
+
+/**
+	Checks that an array is aligned and inside the file.
+
+	@param offset the offset of the array.
+	@param count the number of elements.
+	@param size the size of an element.
+	@return bool true if the array is valid.
+*/
+bool mesh_file::check_array(uint64_t offset, uint64_t count, uint64_t size) {
+	return offset % MESH_FILE_ALIGNMENT == 0 && offset >= sizeof(mesh_file_header) &&
+		offset <= m_file.size() && count <= (m_file.size() - offset) / size;
+}
+
+/**
+	Checks the header and that every array is inside the file. Sets m_error if not.
+
+	@param file_name the mesh file, for the error messages.
+	@return bool true if the file is valid.
+*/
+bool mesh_file::validate(const char* file_name) {
+	const size_t record_sizes[MESH_FILE_ALGORITHM_COUNT] = { sizeof(moller_record), sizeof(woop_record), sizeof(havel_record) };
+	std::string name(file_name);
+
+	if (!m_file.is_open()) m_error = "Cannot open " + name + ".";
+	else if (m_file.size() < sizeof(mesh_file_header) || std::memcmp(header().m_magic, MESH_FILE_MAGIC, 8) != 0) {
+		m_error = name + " is not a mesh file.";
+	}
+	else if (header().m_version != MESH_FILE_VERSION) {
+		m_error = name + " has version " + std::to_string(header().m_version) +
+			", version " + std::to_string(MESH_FILE_VERSION) + " was expected.";
+	}
+	else {
+		const mesh_file_header& h = header();
+		bool valid = h.m_triangle_count <= 0xffffffffu && h.m_vertex_count <= 0xffffffffu &&
+			check_array(h.m_positions, h.m_vertex_count, sizeof(glm::vec3)) &&
+			check_array(h.m_indices, h.m_triangle_count * 3, sizeof(unsigned int)) &&
+			check_array(h.m_normals, h.m_triangle_count * 3, sizeof(glm::vec3));
+
+		for (int i = 0; i < MESH_FILE_ALGORITHM_COUNT; i++) {
+			if (h.m_records[i] == 0) continue;
+			valid = valid && h.m_record_sizes[i] == record_sizes[i] &&
+				check_array(h.m_records[i], h.m_triangle_count, record_sizes[i]);
+		}
+		if (!valid) m_error = name + " is corrupted.";
+	}
+	return m_error.empty();
+}
+
+/**
+	Writes zeros up to the next multiple of MESH_FILE_ALIGNMENT.
+
+	@param offset the end of the file so far.
+	@return uint64_t the aligned offset.
+*/
+static uint64_t align(std::ofstream& file, uint64_t offset) {
+	const char zeros[MESH_FILE_ALIGNMENT] = {};
+	uint64_t padding = (MESH_FILE_ALIGNMENT - offset % MESH_FILE_ALIGNMENT) % MESH_FILE_ALIGNMENT;
+	file.write(zeros, (std::streamsize)padding);
+	return offset + padding;
+}
+
+/**
+	Writes an array at the next aligned offset.
+
+	@param offset [in, out] the end of the file so far.
+	@return uint64_t the offset of the array.
+*/
+static uint64_t write_array(std::ofstream& file, uint64_t& offset, const void* data, uint64_t size) {
+	uint64_t start = align(file, offset);
+	file.write((const char*)data, (std::streamsize)size);
+	offset = start + size;
+	return start;
+}
+
+/**
+	Writes the records of algorithm for every triangle.
+
+	@param offset [in, out] the end of the file so far.
+	@return uint64_t the offset of the records.
+*/
+template <typename record>
+static uint64_t write_records(std::ofstream& file, uint64_t& offset,
+	const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices) {
+	uint64_t start = align(file, offset);
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		record record_(positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]]);
+		file.write((const char*)&record_, sizeof(record_));
+	}
+	offset = start + indices.size() / 3 * sizeof(record);
+	return start;
+}
+
+/**
+	Writes a mesh file.
+
+	The bounds are computed from the positions.
+
+	@param file_name the mesh file to write.
+	@param positions the vertex positions.
+	@param indices the indices in positions of the vertices of the triangles, 3 per triangle.
+	@param normals the vertex normals, 3 per triangle. See mesh::get_smooth_normals().
+	@param algorithms the triangle intersection algorithms to precompute the records of.
+	@param error [out] the reason of the failure.
+	@return bool true if the file was written.
+*/
+bool write_mesh_file(const char* file_name, const std::vector<glm::vec3>& positions,
+	const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& normals,
+	const std::vector<triangle_algorithm>& algorithms, std::string& error) {
+	std::ofstream file(file_name, std::ios::binary);
+	if (!file) {
+		error = std::string("Cannot write ") + file_name + ".";
+		return false;
+	}
+
+	mesh_file_header header = {};
+	std::memcpy(header.m_magic, MESH_FILE_MAGIC, 8);
+	header.m_version = MESH_FILE_VERSION;
+	header.m_vertex_count = positions.size();
+	header.m_triangle_count = indices.size() / 3;
+
+	if (!positions.empty()) {
+		header.m_flags |= MESH_FILE_BOUNDS;
+		glm::vec3 bounds_min = positions[0], bounds_max = positions[0];
+		for (const glm::vec3& position : positions) {
+			bounds_min = glm::min(bounds_min, position);
+			bounds_max = glm::max(bounds_max, position);
+		}
+		for (int i = 0; i < 3; i++) {
+			header.m_bounds_min[i] = bounds_min[i];
+			header.m_bounds_max[i] = bounds_max[i];
+		}
+	}
+
+	// the header is written again once the offsets are known.
+	file.write((const char*)&header, sizeof(header));
+	uint64_t offset = sizeof(header);
+	header.m_positions = write_array(file, offset, positions.data(), positions.size() * sizeof(glm::vec3));
+	header.m_indices = write_array(file, offset, indices.data(), indices.size() * sizeof(unsigned int));
+	header.m_normals = write_array(file, offset, normals.data(), normals.size() * sizeof(glm::vec3));
+
+	for (triangle_algorithm algorithm : algorithms) {
+		int i = (int)algorithm;
+		if (header.m_records[i]) continue;
+		switch (algorithm) {
+		case triangle_algorithm::woop:
+			header.m_records[i] = write_records<woop_record>(file, offset, positions, indices);
+			header.m_record_sizes[i] = sizeof(woop_record);
+			break;
+		case triangle_algorithm::havel_herout:
+			header.m_records[i] = write_records<havel_record>(file, offset, positions, indices);
+			header.m_record_sizes[i] = sizeof(havel_record);
+			break;
+		default:
+			header.m_records[i] = write_records<moller_record>(file, offset, positions, indices);
+			header.m_record_sizes[i] = sizeof(moller_record);
+			break;
+		}
+	}
+
+	file.seekp(0);
+	file.write((const char*)&header, sizeof(header));
+	if (!file) {
+		error = std::string("Cannot write ") + file_name + ".";
+		return false;
+	}
+	return true;
+}
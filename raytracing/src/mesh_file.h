@@ -0,0 +1,78 @@
+/**
+	The native binary mesh format.
+
+	A mesh file holds the arrays of a mesh exactly as the renderer uses them, so
+	that it is mapped in memory and used in place, with no parsing and no copying.
+	The file starts with a mesh_file_header. Every array is at the offset given in
+	the header, aligned to MESH_FILE_ALIGNMENT bytes. Numbers are little endian.
+
+	The triangle records of each intersection algorithm are optional: when they are
+	missing, the mesh builds them from the positions and indices at load time.
+	Mesh files are written from .obj files by the converter. See write_mesh_file().
+*/
+#pragma once
+#include "glm/glm/glm.hpp"
+#include "mapped_file.h"
+#include "triangle_records.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define MESH_FILE_MAGIC "RTMESH\r\n"
+#define MESH_FILE_VERSION 1
+#define MESH_FILE_ALIGNMENT 64
+#define MESH_FILE_ALGORITHM_COUNT 3
+
+// flags of mesh_file_header::m_flags.
+#define MESH_FILE_BOUNDS 1u
+
+/**
+	The mesh_file_header struct is the start of a mesh file.
+*/
+struct mesh_file_header {
+	char m_magic[8];
+	uint32_t m_version;
+	uint32_t m_flags;
+	uint64_t m_vertex_count;
+	uint64_t m_triangle_count;
+
+	uint64_t m_positions; // vertex_count glm::vec3.
+	uint64_t m_indices; // 3 uint32_t per triangle, in m_positions.
+	uint64_t m_normals; // 3 glm::vec3 per triangle, one per vertex of the triangle.
+	uint64_t m_records[MESH_FILE_ALGORITHM_COUNT]; // triangle_count records per triangle_algorithm, 0 if absent.
+	uint32_t m_record_sizes[MESH_FILE_ALGORITHM_COUNT];
+
+	float m_bounds_min[3];
+	float m_bounds_max[3];
+	uint8_t m_padding[12];
+};
+
+static_assert(sizeof(mesh_file_header) % MESH_FILE_ALIGNMENT == 0, "the arrays after the header must stay aligned");
+
+/**
+	The mesh_file class maps a mesh file in memory and checks that it is valid.
+*/
+class mesh_file {
+public:
+	mesh_file(const char* file_name);
+
+	bool is_valid() const;
+	const std::string& error() const;
+	size_t size() const;
+	const mesh_file_header& header() const;
+	const glm::vec3* positions() const;
+	const unsigned int* indices() const;
+	const glm::vec3* normals() const;
+	const void* records(triangle_algorithm algorithm) const;
+
+private:
+	bool validate(const char* file_name);
+	bool check_array(uint64_t offset, uint64_t count, uint64_t size);
+
+	mapped_file m_file;
+	std::string m_error;
+};
+
+bool write_mesh_file(const char* file_name, const std::vector<glm::vec3>& positions,
+	const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& normals,
+	const std::vector<triangle_algorithm>& algorithms, std::string& error);
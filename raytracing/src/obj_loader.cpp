@@ -0,0 +1,212 @@
+#include "obj_loader.h"
+#include "mapped_file.h"
+#include "parse.h"
+#include <algorithm>
+#include <thread>
+
+#define OBJ_MIN_CHUNK_SIZE (1 << 20)
+
+namespace {
+
+/**
+	The chunk struct holds a range of whole lines of the file, and what was found
+	in it.
+*/
+struct chunk {
+	const char* m_begin;
+	const char* m_end;
+	size_t m_line_count = 0;
+	size_t m_vertex_count = 0;
+	size_t m_triangle_count = 0;
+
+	// the totals of the chunks before this one.
+	size_t m_first_line = 0;
+	size_t m_first_vertex = 0;
+	size_t m_first_triangle = 0;
+
+	std::string m_error;
+	size_t m_error_line = 0;
+};
+
+/**
+	@return bool true if the line at p starts with the keyword c followed by a space.
+*/
+bool is_keyword(const char* p, const char* end, char c) {
+	return end - p > 1 && p[0] == c && (p[1] == ' ' || p[1] == '\t');
+}
+
+/**
+	@return bool true if p is at the end of the line or at a comment, which runs to
+	the end of the line.
+*/
+bool is_line_end(const char* p, const char* end) {
+	return p == end || *p == '\r' || *p == '\n' || *p == '#';
+}
+
+/**
+	Skips the token at p, up to the next space or the end of the line.
+*/
+const char* skip_token(const char* p, const char* end) {
+	while (!is_line_end(p, end) && *p != ' ' && *p != '\t') p++;
+	return p;
+}
+
+/**
+	Counts the lines, vertices and triangles of chunk_.
+*/
+void count(chunk& chunk_) {
+	const char* end = chunk_.m_end;
+	for (const char* p = chunk_.m_begin; p < end; p = skip_line(p, end)) {
+		chunk_.m_line_count++;
+		p = skip_spaces(p, end);
+
+		if (is_keyword(p, end, 'v')) chunk_.m_vertex_count++;
+		else if (is_keyword(p, end, 'f')) {
+			size_t vertex_count = 0;
+			for (p = skip_spaces(p + 1, end); !is_line_end(p, end); p = skip_spaces(p, end)) {
+				p = skip_token(p, end);
+				vertex_count++;
+			}
+			if (vertex_count >= 3) chunk_.m_triangle_count += vertex_count - 2;
+		}
+	}
+}
+
+/**
+	Parses chunk_, saving its vertices and triangles at their offsets in positions and
+	indices. Stops at the first error.
+
+	@param vertex_count the number of vertices of the whole file.
+*/
+void parse(chunk& chunk_, glm::vec3* positions, unsigned int* indices, size_t vertex_count) {
+	const char* end = chunk_.m_end;
+	glm::vec3* position = positions + chunk_.m_first_vertex;
+	unsigned int* index = indices + chunk_.m_first_triangle * 3;
+	size_t line = chunk_.m_first_line;
+
+	for (const char* p = chunk_.m_begin; p < end; p = skip_line(p, end)) {
+		line++;
+		p = skip_spaces(p, end);
+
+		if (is_keyword(p, end, 'v')) {
+			glm::vec3& v = *position++;
+			p = parse_float(skip_spaces(p + 1, end), end, v.x);
+			if (p) p = parse_float(skip_spaces(p, end), end, v.y);
+			if (p) p = parse_float(skip_spaces(p, end), end, v.z);
+			if (!p) {
+				chunk_.m_error = "invalid vertex";
+				chunk_.m_error_line = line;
+				return;
+			}
+		}
+		else if (is_keyword(p, end, 'f')) {
+			// vertices before this line, for relative (negative) indices.
+			long long previous_count = position - positions;
+			unsigned int first = 0, last = 0;
+			unsigned int face_vertex_count = 0;
+
+			for (p = skip_spaces(p + 1, end); !is_line_end(p, end); p = skip_spaces(p, end)) {
+				long long i;
+				const char* q = parse_int(p, end, i);
+				if (q) i = i < 0 ? previous_count + i : i - 1;
+				if (!q || i < 0 || i >= (long long)vertex_count) {
+					chunk_.m_error = "invalid vertex index";
+					chunk_.m_error_line = line;
+					return;
+				}
+				p = skip_token(q, end); // texture coordinate and normal indices.
+
+				// triangle fan: (first, last, i) for every vertex after the second.
+				if (face_vertex_count >= 2) {
+					*index++ = first;
+					*index++ = last;
+					*index++ = (unsigned int)i;
+				}
+				if (face_vertex_count == 0) first = (unsigned int)i;
+				last = (unsigned int)i;
+				face_vertex_count++;
+			}
+		}
+	}
+}
+
+/**
+	Runs function on every chunk, each on its own thread.
+*/
+template <typename function_type>
+void for_each_chunk(std::vector<chunk>& chunks, function_type function) {
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < chunks.size(); i++) {
+		threads.push_back(std::thread(function, std::ref(chunks[i])));
+	}
+	function(chunks[0]);
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+}
+
+/**
+	Loads the triangles of an .obj file.
+
+	A first pass counts the vertices and triangles of every chunk, so that the
+	arrays are allocated once and every chunk knows where to write. A second pass
+	parses the chunks in parallel.
+
+	@param file_name the .obj file to load.
+	@param positions [out] the vertex positions.
+	@param indices [out] the indices in positions of the vertices of the triangles, 3 per triangle.
+	@param error [out] the reason of the failure, with its line number.
+	@return bool true if the file was loaded.
+*/
+bool load_obj(const char* file_name, std::vector<glm::vec3>& positions,
+	std::vector<unsigned int>& indices, std::string& error) {
+	mapped_file file(file_name);
+	if (!file.is_open()) {
+		error = std::string("Cannot open ") + file_name + ".";
+		return false;
+	}
+
+	const char* begin = file.data();
+	const char* end = begin + file.size();
+	size_t chunk_count = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+		file.size() / OBJ_MIN_CHUNK_SIZE + 1);
+
+	// chunks end after a new line.
+	std::vector<chunk> chunks(chunk_count);
+	for (size_t i = 0; i < chunk_count; i++) {
+		chunks[i].m_begin = i == 0 ? begin : chunks[i - 1].m_end;
+		chunks[i].m_end = i + 1 == chunk_count ? end :
+			skip_line(std::max(chunks[i].m_begin, begin + file.size() * (i + 1) / chunk_count), end);
+	}
+
+	for_each_chunk(chunks, count);
+
+	for (size_t i = 1; i < chunk_count; i++) {
+		const chunk& previous = chunks[i - 1];
+		chunks[i].m_first_line = previous.m_first_line + previous.m_line_count;
+		chunks[i].m_first_vertex = previous.m_first_vertex + previous.m_vertex_count;
+		chunks[i].m_first_triangle = previous.m_first_triangle + previous.m_triangle_count;
+	}
+	size_t vertex_count = chunks.back().m_first_vertex + chunks.back().m_vertex_count;
+	size_t triangle_count = chunks.back().m_first_triangle + chunks.back().m_triangle_count;
+	if (vertex_count > 0xffffffffu) {
+		error = std::string(file_name) + ": too many vertices.";
+		return false;
+	}
+
+	positions.resize(vertex_count);
+	indices.resize(triangle_count * 3);
+	for_each_chunk(chunks, [&](chunk& chunk_) {
+		parse(chunk_, positions.data(), indices.data(), vertex_count);
+	});
+
+	for (const chunk& chunk_ : chunks) {
+		if (!chunk_.m_error.empty()) {
+			error = std::string(file_name) + ":" + std::to_string(chunk_.m_error_line) + ": " + chunk_.m_error + ".";
+			return false;
+		}
+	}
+	return true;
+}
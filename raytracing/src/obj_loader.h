@@ -0,0 +1,15 @@
+/**
+	A parallel loader for the triangles of .obj files.
+
+	The file is mapped in memory and split into chunks of whole lines, which are
+	parsed by one thread each, straight into the position and index arrays of the
+	mesh. Only vertex positions ("v") and faces ("f") are read. Faces with more than
+	3 vertices are split into triangle fans.
+*/
+#pragma once
+#include "glm/glm/glm.hpp"
+#include <string>
+#include <vector>
+
+bool load_obj(const char* file_name, std::vector<glm::vec3>& positions,
+	std::vector<unsigned int>& indices, std::string& error);
@@ -0,0 +1,142 @@
+#include "options.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+/**
+	Parses a positive decimal number of at most 9 digits.
+
+	@param value the text of the number.
+	@param number [out] the number.
+	@return bool true if value is a valid number.
+*/
+static bool parse_unsigned(const std::string& value, unsigned int& number) {
+	if (value.empty() || value.size() > 9 || value.find_first_not_of("0123456789") != std::string::npos) return false;
+	number = (unsigned int)std::stoul(value);
+	return true;
+}
+
+/**
+	Parses a range of frames, first-last, or a single frame.
+
+	@param value the text of the range.
+	@param first [out] the first frame.
+	@param last [out] the last frame, included.
+	@return bool true if value is a valid range.
+*/
+static bool parse_frames(const std::string& value, unsigned int& first, unsigned int& last) {
+	size_t dash = value.find('-');
+	if (dash == std::string::npos) return parse_unsigned(value, first) && parse_unsigned(value, last);
+	return parse_unsigned(value.substr(0, dash), first) && parse_unsigned(value.substr(dash + 1), last) && first <= last;
+}
+
+/**
+	Parameterized constructor.
+
+	Parses the command line. Exits with the usage message if an option is unknown
+	or has an invalid value.
+
+	@param argc the number of arguments.
+	@param argv the arguments.
+*/
+options::options(int argc, char** argv) {
+	for (int i = 1; i < argc; i++) {
+		std::string option(argv[i]);
+		std::string value = i + 1 < argc ? argv[i + 1] : "";
+
+		if (option == "--triangle" && from_string(value, m_triangle_algorithm)) i++;
+		else if (option == "--isa" && from_string(value, m_isa)) {
+			m_force_isa = true;
+			i++;
+		}
+		else if (option == "--width" && (value == "1" || value == "4" || value == "8" || value == "16")) {
+			m_width = (unsigned int)std::stoi(value);
+			i++;
+		}
+		else if (option == "--threads" && parse_unsigned(value, m_threads)) i++;
+		else if (option == "--height" && parse_unsigned(value, m_height) && m_height > 0) i++;
+		else if (option == "--tile" && parse_unsigned(value, m_tile_size) && m_tile_size > 0 && m_tile_size % 16 == 0) i++;
+		else if (option == "--format" && from_string(value, m_format)) i++;
+		else if (option == "--budget" && parse_unsigned(value, m_budget) && m_budget > 0) i++;
+		else if (option == "--samples" && parse_unsigned(value, m_samples) && m_samples > 0) i++;
+		else if (option == "--output" && !value.empty()) {
+			m_output = value;
+			i++;
+		}
+		else if (option == "--serve" && !value.empty()) {
+			m_serve = value;
+			i++;
+		}
+		else if (option == "--send" && !value.empty() && i + 2 < argc) {
+			m_send = value;
+			m_request = argv[i + 2];
+			i += 2;
+		}
+		else if (option == "--frames" && parse_frames(value, m_first_frame, m_last_frame)) {
+			m_sequence = true;
+			i++;
+		}
+		else if (option == "--checkpoint" && !value.empty()) {
+			m_checkpoint = value;
+			i++;
+		}
+		else if (option == "--checkpoint-interval" && parse_unsigned(value, m_checkpoint_interval) && m_checkpoint_interval > 0) i++;
+		else if (option == "--stats" && !value.empty()) {
+			m_stats = value;
+			i++;
+		}
+		else if (option == "--aovs" && !value.empty()) {
+			m_aovs = value;
+			i++;
+		}
+		else if (option == "--profile-shapes") m_profile_shapes = true;
+		else if (option == "--trace-events" && !value.empty()) {
+			m_events = value;
+			i++;
+		}
+		else if (option == "--seed" && parse_unsigned(value, m_seed) && m_seed > 0) i++;
+		else if (option == "--worker" && parse_unsigned(value, m_worker_port) && m_worker_port > 0 && m_worker_port < 65536) i++;
+		else if (option == "--workers" && !value.empty()) {
+			for (size_t begin = 0; begin <= value.size();) {
+				size_t end = std::min(value.find(',', begin), value.size());
+				if (end > begin) m_workers.push_back(value.substr(begin, end - begin));
+				begin = end + 1;
+			}
+			i++;
+		}
+		else usage(argv[0]);
+	}
+}
+
+/**
+	Prints the usage message and exits.
+
+	@param program the name of the program.
+*/
+void options::usage(const char* program) {
+	std::cerr << "Usage: " << program << " [options]" << std::endl
+		<< "  --triangle moller|woop|havel   triangle intersection algorithm (default: "
+		<< to_string(TRIANGLE_ALGORITHM) << ")" << std::endl
+		<< "  --isa generic|sse4.2|avx2|avx512   forces the kernels of an instruction set level" << std::endl
+		<< "  --width 1|4|8|16   rays per packet (default: the widest one of the kernels)" << std::endl
+		<< "  --threads N   worker threads (default: one per core)" << std::endl
+		<< "  --height N   image height in pixels (default: from the camera)" << std::endl
+		<< "  --tile N   tile size in pixels, a multiple of 16 (default: " << TILE_SIZE << ")" << std::endl
+		<< "  --format srgb8|half|float32   storage format of the pixels (default: half)" << std::endl
+		<< "  --budget MS   renders progressively until the time limit, in ms" << std::endl
+		<< "  --samples N   renders progressively up to N samples per pixel" << std::endl
+		<< "  --output file.tif|file.png   streams the tiles to the file instead of displaying the image" << std::endl
+		<< "  --frames first-last   renders the frames of an animation to numbered files, with --output" << std::endl
+		<< "  --checkpoint file   saves the progress of the render to the file, and resumes from it, with --output" << std::endl
+		<< "  --checkpoint-interval S   seconds between two checkpoints (default: " << CHECKPOINT_INTERVAL << ")" << std::endl
+		<< "  --seed N   seed of the anti-aliasing offsets, for renders that can be reproduced (default: random)" << std::endl
+		<< "  --stats file.json   saves the statistics of the render to the file" << std::endl
+		<< "  --aovs file.tif|file.png   saves the cycles, tests and shadow rays of every pixel of a tiled render" << std::endl
+		<< "  --profile-shapes   reports the rays, tests and cycles of every shape, slower" << std::endl
+		<< "  --trace-events file.json   saves when the tiles, meshes and output ran on every thread, for Perfetto" << std::endl
+		<< "  --serve socket   serves render requests on the socket until it gets \"quit\"" << std::endl
+		<< "  --send socket request   sends a request to a server and prints its responses" << std::endl
+		<< "  --worker port   renders tiles for coordinators that connect to the TCP port" << std::endl
+		<< "  --workers host:port,...   renders the tiles on the workers, with --output" << std::endl;
+	exit(EXIT_FAILURE);
+}
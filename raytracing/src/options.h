@@ -0,0 +1,48 @@
+/**
+	The options struct that holds the settings given on the command line.
+*/
+#pragma once
+#include "triangle_records.h"
+#include "cpu.h"
+#include "framebuffer.h"
+#include <string>
+#include <vector>
+
+// the side of the square tiles the image is rendered in.
+#define TILE_SIZE 64
+// the time between two checkpoints of a render, in seconds.
+#define CHECKPOINT_INTERVAL 60
+
+struct options {
+	options(int argc, char** argv);
+
+	triangle_algorithm m_triangle_algorithm = TRIANGLE_ALGORITHM;
+	bool m_force_isa = false;
+	isa m_isa = isa::generic;
+	unsigned int m_width = 0; // 0 for the widest packet of the kernels.
+	unsigned int m_threads = 0; // 0 for one per core.
+	unsigned int m_height = 0; // 0 for the height given by the camera.
+	unsigned int m_tile_size = TILE_SIZE;
+	std::string m_output; // the file the tiles are streamed to, empty to display the image.
+	std::string m_serve; // the socket render requests are served on, empty not to serve. See render_server.
+	std::string m_send; // the socket m_request is sent to, empty not to send it.
+	std::string m_request;
+	unsigned int m_worker_port = 0; // the TCP port tiles are rendered for a coordinator on, 0 not to. See render_worker.
+	std::vector<std::string> m_workers; // the host:port of the workers the tiles are rendered on, empty to render them here.
+	pixel_format m_format = pixel_format::half; // the storage format of the rendered pixels.
+	unsigned int m_budget = 0; // the time limit of a progressive render in ms, 0 for none.
+	unsigned int m_samples = 0; // the samples per pixel of a progressive render, 0 for the default.
+	bool m_sequence = false; // true to render the frames m_first_frame to m_last_frame of an animation.
+	unsigned int m_first_frame = 0;
+	unsigned int m_last_frame = 0;
+	std::string m_checkpoint; // the file the progress of the render is saved to and resumed from, empty for none.
+	unsigned int m_checkpoint_interval = CHECKPOINT_INTERVAL; // the time between two checkpoints, in seconds.
+	unsigned int m_seed = 0; // the seed of the anti-aliasing offsets, 0 for a random one per render.
+	std::string m_stats; // the JSON file the statistics of the render are saved to, empty for none.
+	std::string m_aovs; // the name of the images of the cost of the pixels, empty for none. See aov_buffers.
+	bool m_profile_shapes = false; // true to report the cost of every shape of the scene.
+	std::string m_events; // the Chrome trace file the events of the threads are saved to, empty for none. See event_trace.
+
+private:
+	void usage(const char* program);
+};
@@ -0,0 +1,122 @@
+#include "parse.h"
+#include <climits>
+
+// 10^i for the exponents that a double holds exactly.
+static const double POWERS_OF_10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+static const int MAX_EXACT_POWER = 22;
+static const int MAX_DIGITS = 19; // the most decimal digits that fit in 64 bits.
+
+static bool is_digit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+/**
+	@return const char* the first character at or after p that is not a space or a tab.
+*/
+const char* skip_spaces(const char* p, const char* end) {
+	while (p < end && (*p == ' ' || *p == '\t')) p++;
+	return p;
+}
+
+/**
+	@return const char* the start of the line after the one of p, or end.
+*/
+const char* skip_line(const char* p, const char* end) {
+	while (p < end && *p != '\n') p++;
+	return p < end ? p + 1 : end;
+}
+
+/**
+	Parses a decimal integer with an optional sign. Integers that do not fit in a
+	long long are not valid.
+
+	@param value [out] the integer.
+*/
+const char* parse_int(const char* p, const char* end, long long& value) {
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+	if (p == end || !is_digit(*p)) return nullptr;
+
+	long long result = 0;
+	while (p < end && is_digit(*p)) {
+		int digit = *p++ - '0';
+		if (result > (LLONG_MAX - digit) / 10) return nullptr;
+		result = result * 10 + digit;
+	}
+	value = negative ? -result : result;
+	return p;
+}
+
+/**
+	Parses a decimal floating point number with an optional sign and exponent.
+
+	The digits are accumulated in a 64 bit integer, which is then scaled once by a
+	power of 10. Up to 19 significant digits and exponents of up to 22, this gives
+	the correctly rounded double, and so a float within half an ulp. Longer numbers
+	lose the digits past the 19th.
+
+	@param value [out] the number.
+*/
+const char* parse_float(const char* p, const char* end, float& value) {
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool any_digit = false;
+
+	for (; p < end && is_digit(*p); p++) {
+		any_digit = true;
+		if (digits < MAX_DIGITS) {
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa) digits++;
+		}
+		else exponent++;
+	}
+	if (p < end && *p == '.') {
+		for (p++; p < end && is_digit(*p); p++) {
+			any_digit = true;
+			if (digits < MAX_DIGITS) {
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa) digits++;
+				exponent--;
+			}
+		}
+	}
+	if (!any_digit) return nullptr;
+
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		const char* q = p + 1;
+		bool negative_exponent = false;
+		if (q < end && (*q == '-' || *q == '+')) negative_exponent = *q++ == '-';
+		if (q < end && is_digit(*q)) {
+			// exponents past 1000 give 0 or infinity anyway.
+			int e = 0;
+			for (; q < end && is_digit(*q); q++) {
+				if (e < 1000) e = e * 10 + (*q - '0');
+			}
+			if (e > 1000) e = 1000;
+			exponent += negative_exponent ? -e : e;
+			p = q;
+		}
+	}
+
+	double result = (double)mantissa;
+	if (mantissa != 0) {
+		while (exponent > MAX_EXACT_POWER) {
+			result *= POWERS_OF_10[MAX_EXACT_POWER];
+			exponent -= MAX_EXACT_POWER;
+		}
+		while (exponent < -MAX_EXACT_POWER) {
+			result /= POWERS_OF_10[MAX_EXACT_POWER];
+			exponent += MAX_EXACT_POWER;
+		}
+		result = exponent < 0 ? result / POWERS_OF_10[-exponent] : result * POWERS_OF_10[exponent];
+	}
+	value = (float)(negative ? -result : result);
+	return p;
+}
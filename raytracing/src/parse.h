@@ -0,0 +1,12 @@
+/**
+	Fast parsers for numbers in text files.
+
+	They read from a range [p, end) that does not need to be null terminated, and
+	return a pointer past the number, or nullptr if there is no valid number at p.
+*/
+#pragma once
+
+const char* skip_spaces(const char* p, const char* end);
+const char* skip_line(const char* p, const char* end);
+const char* parse_int(const char* p, const char* end, long long& value);
+const char* parse_float(const char* p, const char* end, float& value);
@@ -0,0 +1,351 @@
+#include "ply_loader.h"
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#define PLY_BUFFER_SIZE (1 << 20)
+
+namespace {
+
+/**
+	The scalar types of .ply properties.
+*/
+enum class ply_type {
+	int8, uint8, int16, uint16, int32, uint32, float32, float64
+};
+
+/**
+	The property struct holds a property of an element. A list property holds a
+	count followed by count items.
+*/
+struct property {
+	std::string m_name;
+	ply_type m_type;
+	bool m_list = false;
+	ply_type m_count_type;
+};
+
+/**
+	The element struct holds an element of the header, e.g. "vertex" or "face".
+*/
+struct element {
+	std::string m_name;
+	size_t m_count = 0;
+	std::vector<property> m_properties;
+};
+
+/**
+	The reader class reads a file through a buffer.
+*/
+class reader {
+public:
+	reader(const char* file_name) : m_file(std::fopen(file_name, "rb")), m_buffer(PLY_BUFFER_SIZE) {
+#ifdef _WIN32
+		struct _stat64 status;
+		if (m_file && _stat64(file_name, &status) == 0) m_size = (uint64_t)status.st_size;
+#else
+		struct stat status;
+		if (m_file && stat(file_name, &status) == 0) m_size = (uint64_t)status.st_size;
+#endif
+	}
+	~reader() { if (m_file) std::fclose(m_file); }
+	reader(const reader&) = delete;
+	reader& operator=(const reader&) = delete;
+
+	bool is_open() const { return m_file != nullptr; }
+
+	/**
+		@return uint64_t the number of bytes left in the file, to check the counts
+		of the header before allocating anything.
+	*/
+	uint64_t remaining() const { return m_size - m_read + (m_end - m_begin); }
+
+	/**
+		Reads count bytes.
+
+		@return const char* the bytes, valid until the next call, or nullptr at the end of the file.
+	*/
+	const char* next(size_t count) {
+		if (m_end - m_begin < count) {
+			if (count > remaining()) return nullptr;
+			if (count > m_buffer.size()) m_buffer.resize(count);
+			std::memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+			m_end -= m_begin;
+			m_begin = 0;
+			size_t read = std::fread(m_buffer.data() + m_end, 1, m_buffer.size() - m_end, m_file);
+			m_end += read;
+			m_read += read;
+			if (m_end < count) return nullptr;
+		}
+		const char* data = m_buffer.data() + m_begin;
+		m_begin += count;
+		return data;
+	}
+
+	/**
+		Reads a line of the header, without its new line.
+
+		@return bool false at the end of the file.
+	*/
+	bool next_line(std::string& line) {
+		line.clear();
+		for (const char* c = next(1); c; c = next(1)) {
+			if (*c == '\n') return true;
+			if (*c != '\r') line += *c;
+		}
+		return false;
+	}
+
+private:
+	std::FILE* m_file;
+	std::vector<char> m_buffer;
+	size_t m_begin = 0;
+	size_t m_end = 0;
+	uint64_t m_size = 0; // the size of the file.
+	uint64_t m_read = 0; // the bytes read from the file into m_buffer.
+};
+
+/**
+	@param name the name of a type in the header.
+	@param type [out] the type, if found.
+	@return bool true if name is a valid type name.
+*/
+bool from_string(const std::string& name, ply_type& type) {
+	const char* names[][2] = {
+		{ "char", "int8" }, { "uchar", "uint8" }, { "short", "int16" }, { "ushort", "uint16" },
+		{ "int", "int32" }, { "uint", "uint32" }, { "float", "float32" }, { "double", "float64" }
+	};
+	for (int i = 0; i < 8; i++) {
+		if (name == names[i][0] || name == names[i][1]) {
+			type = (ply_type)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+	@return size_t the size of a value of type in bytes.
+*/
+size_t size_of(ply_type type) {
+	const size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+	return sizes[(int)type];
+}
+
+/**
+	Converts a value from the file.
+
+	@param p the bytes of the value.
+	@param type the type of the value.
+	@return T the value.
+*/
+template <typename T>
+T to_value(const char* p, ply_type type) {
+	switch (type) {
+	case ply_type::int8: return (T)*(const int8_t*)p;
+	case ply_type::uint8: return (T)*(const uint8_t*)p;
+	case ply_type::int16: { int16_t v; std::memcpy(&v, p, 2); return (T)v; }
+	case ply_type::uint16: { uint16_t v; std::memcpy(&v, p, 2); return (T)v; }
+	case ply_type::int32: { int32_t v; std::memcpy(&v, p, 4); return (T)v; }
+	case ply_type::uint32: { uint32_t v; std::memcpy(&v, p, 4); return (T)v; }
+	case ply_type::float32: { float v; std::memcpy(&v, p, 4); return (T)v; }
+	default: { double v; std::memcpy(&v, p, 8); return (T)v; }
+	}
+}
+
+/**
+	Reads the header, up to "end_header".
+
+	@param elements [out] the elements, in the order of the file.
+	@return std::string the reason of the failure, empty on success.
+*/
+std::string read_header(reader& reader_, std::vector<element>& elements) {
+	std::string line;
+	if (!reader_.next_line(line) || line != "ply") return "not a .ply file";
+
+	while (reader_.next_line(line)) {
+		std::istringstream tokens(line);
+		std::string keyword;
+		tokens >> keyword;
+
+		if (keyword == "end_header") return "";
+		else if (keyword == "format") {
+			std::string format;
+			tokens >> format;
+			if (format != "binary_little_endian") return "only binary_little_endian .ply files are supported";
+		}
+		else if (keyword == "element") {
+			element element_;
+			if (!(tokens >> element_.m_name >> element_.m_count)) return "invalid element \"" + line + "\"";
+			elements.push_back(element_);
+		}
+		else if (keyword == "property") {
+			property property_;
+			std::string type;
+			tokens >> type;
+			if (type == "list") {
+				std::string count_type;
+				tokens >> count_type >> type;
+				if (!from_string(count_type, property_.m_count_type)) return "invalid property \"" + line + "\"";
+				property_.m_list = true;
+			}
+			if (elements.empty() || !from_string(type, property_.m_type) || !(tokens >> property_.m_name)) {
+				return "invalid property \"" + line + "\"";
+			}
+			elements.back().m_properties.push_back(property_);
+		}
+		else if (keyword != "comment" && keyword != "obj_info" && !keyword.empty()) {
+			return "unknown header line \"" + line + "\"";
+		}
+	}
+	return "no end_header";
+}
+
+/**
+	Reads the x, y and z properties of the vertices of element_.
+
+	@param positions [out] the vertex positions.
+	@return std::string the reason of the failure, empty on success.
+*/
+std::string read_vertices(reader& reader_, const element& element_, std::vector<glm::vec3>& positions) {
+	// the offsets of x, y and z in a vertex, which has no list property.
+	size_t stride = 0;
+	size_t offsets[3];
+	ply_type types[3];
+	int found = 0;
+	for (const property& property_ : element_.m_properties) {
+		if (property_.m_list) return "list property in vertex";
+		for (int i = 0; i < 3; i++) {
+			if (property_.m_name == std::string(1, (char)('x' + i))) {
+				offsets[i] = stride;
+				types[i] = property_.m_type;
+				found |= 1 << i;
+			}
+		}
+		stride += size_of(property_.m_type);
+	}
+	if (found != 7) return "vertex without x, y and z";
+
+	if (element_.m_count > reader_.remaining() / stride) return "more vertices than the file holds";
+
+	bool floats = types[0] == ply_type::float32 && types[1] == ply_type::float32 && types[2] == ply_type::float32;
+	positions.resize(element_.m_count);
+	for (glm::vec3& position : positions) {
+		const char* p = reader_.next(stride);
+		if (!p) return "unexpected end of file in vertices";
+
+		if (floats) {
+			std::memcpy(&position.x, p + offsets[0], 4);
+			std::memcpy(&position.y, p + offsets[1], 4);
+			std::memcpy(&position.z, p + offsets[2], 4);
+		}
+		else {
+			for (int i = 0; i < 3; i++) position[i] = to_value<float>(p + offsets[i], types[i]);
+		}
+	}
+	return "";
+}
+
+/**
+	Reads the vertex index lists of the faces of element_, as triangle fans.
+
+	@param vertex_count the number of vertices, to check the indices.
+	@param indices [out] the indices of the vertices of the triangles, 3 per triangle.
+	@return std::string the reason of the failure, empty on success.
+*/
+std::string read_faces(reader& reader_, const element& element_, size_t vertex_count, std::vector<unsigned int>& indices) {
+	// the smallest size of a face: its scalars and the counts of its lists.
+	size_t face_size = 0;
+	for (const property& property_ : element_.m_properties) {
+		face_size += size_of(property_.m_list ? property_.m_count_type : property_.m_type);
+	}
+	if (element_.m_count > reader_.remaining() / std::max<size_t>(face_size, 1)) return "more faces than the file holds";
+
+	indices.reserve(element_.m_count * 3);
+	std::vector<unsigned int> face;
+	for (size_t f = 0; f < element_.m_count; f++) {
+		for (const property& property_ : element_.m_properties) {
+			const char* p = reader_.next(size_of(property_.m_list ? property_.m_count_type : property_.m_type));
+			if (!p) return "unexpected end of file in faces";
+			if (!property_.m_list) continue;
+
+			long long count = to_value<long long>(p, property_.m_count_type);
+			size_t size = size_of(property_.m_type);
+			if (count < 0 || !(p = reader_.next((size_t)count * size))) return "unexpected end of file in faces";
+			if (property_.m_name != "vertex_indices" && property_.m_name != "vertex_index") continue;
+
+			face.resize((size_t)count);
+			for (long long i = 0; i < count; i++) {
+				long long index = to_value<long long>(p + i * size, property_.m_type);
+				if (index < 0 || (size_t)index >= vertex_count) return "face " + std::to_string(f) + " has an invalid vertex index";
+				face[i] = (unsigned int)index;
+			}
+			for (size_t i = 2; i < face.size(); i++) {
+				indices.push_back(face[0]);
+				indices.push_back(face[i - 1]);
+				indices.push_back(face[i]);
+			}
+		}
+	}
+	return "";
+}
+
+/**
+	Skips the values of element_.
+
+	@return std::string the reason of the failure, empty on success.
+*/
+std::string skip_element(reader& reader_, const element& element_) {
+	for (size_t i = 0; i < element_.m_count; i++) {
+		for (const property& property_ : element_.m_properties) {
+			const char* p = reader_.next(size_of(property_.m_list ? property_.m_count_type : property_.m_type));
+			if (p && property_.m_list) {
+				long long count = to_value<long long>(p, property_.m_count_type);
+				p = count < 0 ? nullptr : reader_.next((size_t)count * size_of(property_.m_type));
+			}
+			if (!p) return "unexpected end of file in " + element_.m_name;
+		}
+	}
+	return "";
+}
+
+}
+
+/**
+	Loads the triangles of a binary little endian .ply file.
+
+	@param file_name the .ply file to load.
+	@param positions [out] the vertex positions.
+	@param indices [out] the indices in positions of the vertices of the triangles, 3 per triangle.
+	@param error [out] the reason of the failure.
+	@return bool true if the file was loaded.
+*/
+bool load_ply(const char* file_name, std::vector<glm::vec3>& positions,
+	std::vector<unsigned int>& indices, std::string& error) {
+	reader reader_(file_name);
+	if (!reader_.is_open()) {
+		error = std::string("Cannot open ") + file_name + ".";
+		return false;
+	}
+
+	std::vector<element> elements;
+	std::string message = read_header(reader_, elements);
+	for (size_t i = 0; i < elements.size() && message.empty(); i++) {
+		const element& element_ = elements[i];
+		if (element_.m_name == "vertex") {
+			if (element_.m_count > 0xffffffffu) message = "too many vertices";
+			else message = read_vertices(reader_, element_, positions);
+		}
+		else if (element_.m_name == "face") message = read_faces(reader_, element_, positions.size(), indices);
+		else message = skip_element(reader_, element_);
+	}
+
+	if (!message.empty()) {
+		error = std::string(file_name) + ": " + message + ".";
+		return false;
+	}
+	return true;
+}
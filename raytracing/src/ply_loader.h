@@ -0,0 +1,16 @@
+/**
+	A streaming loader for the triangles of binary little endian .ply files.
+
+	The file is read front to back through a small buffer, straight into the
+	position and index arrays of the mesh, so it is never held in memory as a
+	whole. Only the x, y and z properties of the "vertex" element and the vertex
+	index list of the "face" element are read. Faces with more than 3 vertices are
+	split into triangle fans. Other elements and properties are skipped.
+*/
+#pragma once
+#include "glm/glm/glm.hpp"
+#include <string>
+#include <vector>
+
+bool load_ply(const char* file_name, std::vector<glm::vec3>& positions,
+	std::vector<unsigned int>& indices, std::string& error);
@@ -0,0 +1,188 @@
+#include "png_writer.h"
+#include <algorithm>
+
+// the largest stored block of a zlib stream.
+#define PNG_MAX_BLOCK 65535
+
+/**
+	Updates the CRC-32 of PNG chunks.
+
+	@param crc the CRC of the previous bytes.
+	@param data the next bytes.
+	@param size the number of bytes.
+	@return uint32_t the CRC with the next bytes.
+*/
+static uint32_t update_crc(uint32_t crc, const unsigned char* data, size_t size) {
+	struct crc_table {
+		crc_table() {
+			for (uint32_t n = 0; n < 256; n++) {
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+				m_values[n] = c;
+			}
+		}
+		uint32_t m_values[256];
+	};
+	static const crc_table table_;
+	const uint32_t* table = table_.m_values;
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+/**
+	Appends a value to a buffer, big endian.
+*/
+static void append_big_endian(std::vector<unsigned char>& buffer, uint32_t value) {
+	for (int i = 3; i >= 0; i--) buffer.push_back((unsigned char)(value >> (8 * i)));
+}
+
+/**
+	Parameterized constructor.
+
+	Writes the signature, the IHDR chunk and the zlib header.
+
+	@param file_name the .png file to write.
+	@param width the width of the image in pixels.
+	@param height the height of the image in pixels.
+	@param tile_size the side of the tiles in pixels.
+*/
+png_writer::png_writer(const std::string& file_name, uint32_t width, uint32_t height, uint32_t tile_size)
+	:
+	tile_writer(width, height, tile_size),
+	m_file_name(file_name),
+	m_file(file_name, std::ios::binary)
+{
+	if (!m_file) {
+		m_error = "Cannot write " + file_name + ".";
+		return;
+	}
+	// a row of tiles is a chunk, whose size is at most 2^31 - 1.
+	uint64_t row_size = ((uint64_t)width * 3 + 1) * tile_size;
+	if (row_size + row_size / PNG_MAX_BLOCK * 5 + 5 > 0x7fffffffu || height > 0x7fffffffu) {
+		m_error = file_name + ": the image is too large for PNG.";
+		return;
+	}
+
+	const unsigned char signature[] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+	m_file.write((const char*)signature, sizeof(signature));
+
+	std::vector<unsigned char> header;
+	append_big_endian(header, width);
+	append_big_endian(header, height);
+	header.insert(header.end(), { 8, 2, 0, 0, 0 }); // 8 bit RGB, no interlacing.
+	write_chunk("IHDR", header.data(), header.size());
+
+	const unsigned char zlib_header[] = { 0x78, 0x01 };
+	write_chunk("IDAT", zlib_header, sizeof(zlib_header));
+}
+
+/**
+	Writes a chunk.
+
+	@param type the 4 letters of the type of the chunk.
+	@param data the data of the chunk.
+	@param size the size of the data.
+*/
+void png_writer::write_chunk(const char* type, const unsigned char* data, size_t size) {
+	std::vector<unsigned char> length;
+	append_big_endian(length, (uint32_t)size);
+	m_file.write((const char*)length.data(), 4);
+	m_file.write(type, 4);
+	m_file.write((const char*)data, size);
+
+	uint32_t crc = update_crc(update_crc(0, (const unsigned char*)type, 4), data, size);
+	std::vector<unsigned char> crc_bytes;
+	append_big_endian(crc_bytes, crc);
+	m_file.write((const char*)crc_bytes.data(), 4);
+}
+
+/**
+	Copies a tile into its row of tiles, and writes the rows that are complete,
+	in order.
+
+	@param tile_ the tile.
+	@return bool false if the file could not be written.
+*/
+bool png_writer::write(const tile& tile_) {
+	uint64_t row_index = tile_.m_y / m_tile_size;
+	uint32_t row_height = std::min(m_tile_size, m_height - (uint32_t)(row_index * m_tile_size));
+	size_t stride = (size_t)m_width * 3 + 1;
+
+	row& row_ = m_rows[row_index];
+	if (row_.m_scanlines.empty()) row_.m_scanlines.assign(stride * row_height, 0);
+	for (uint32_t y = 0; y < tile_.m_height; y++) {
+		unsigned char* pixel = &row_.m_scanlines[y * stride + 1 + (size_t)tile_.m_x * 3];
+		for (uint32_t x = 0; x < tile_.m_width; x++) {
+			glm::vec3 color = tile_.color(x, y);
+			*pixel++ = to_byte(color.x);
+			*pixel++ = to_byte(color.y);
+			*pixel++ = to_byte(color.z);
+		}
+	}
+	row_.m_tile_count++;
+
+	for (auto next = m_rows.find(m_next_row); next != m_rows.end() && next->second.m_tile_count == tiles_across();
+		next = m_rows.find(m_next_row)) {
+		write_row(next->second, m_next_row + 1 == tiles_down());
+		m_rows.erase(next);
+		m_next_row++;
+	}
+
+	if (!m_file) m_error = "Cannot write " + m_file_name + ".";
+	return m_error.empty();
+}
+
+/**
+	Writes the scanlines of a row of tiles as stored blocks in an IDAT chunk.
+
+	@param row_ the row of tiles.
+	@param last true for the last row of the image, which ends the zlib stream.
+*/
+void png_writer::write_row(row& row_, bool last) {
+	const std::vector<unsigned char>& data = row_.m_scanlines;
+
+	m_chunk.clear();
+	for (size_t begin = 0; begin < data.size(); begin += PNG_MAX_BLOCK) {
+		size_t size = std::min<size_t>(PNG_MAX_BLOCK, data.size() - begin);
+		m_chunk.push_back(last && begin + size == data.size() ? 1 : 0);
+		m_chunk.push_back((unsigned char)size);
+		m_chunk.push_back((unsigned char)(size >> 8));
+		m_chunk.push_back((unsigned char)~size);
+		m_chunk.push_back((unsigned char)(~size >> 8));
+		m_chunk.insert(m_chunk.end(), data.begin() + begin, data.begin() + begin + size);
+	}
+
+	// the Adler-32 of the zlib stream, in blocks small enough not to overflow.
+	for (size_t begin = 0; begin < data.size(); begin += 5552) {
+		size_t end = std::min<size_t>(begin + 5552, data.size());
+		for (size_t i = begin; i < end; i++) {
+			m_adler_a += data[i];
+			m_adler_b += m_adler_a;
+		}
+		m_adler_a %= 65521;
+		m_adler_b %= 65521;
+	}
+	if (last) append_big_endian(m_chunk, m_adler_b << 16 | m_adler_a);
+
+	write_chunk("IDAT", m_chunk.data(), m_chunk.size());
+}
+
+/**
+	Writes the IEND chunk.
+
+	@return bool false if rows are missing or the file could not be written.
+*/
+bool png_writer::finish() {
+	if (!m_error.empty()) return false;
+	if (m_next_row != tiles_down()) {
+		m_error = m_file_name + ": missing tiles.";
+		return false;
+	}
+
+	write_chunk("IEND", nullptr, 0);
+	m_file.close();
+	if (!m_file) m_error = "Cannot write " + m_file_name + ".";
+	return m_error.empty();
+}
@@ -0,0 +1,40 @@
+/**
+	The png_writer class streams an image to a PNG file in scanline order.
+
+	PNG stores the image row by row, so the tiles of a row of tiles are kept until
+	the row is complete, then its scanlines are written as one IDAT chunk. The
+	image data is a zlib stream of stored blocks: PNG needs no compression library,
+	and writing costs no more than copying.
+*/
+#pragma once
+#include "tile_writer.h"
+#include <fstream>
+#include <map>
+#include <vector>
+
+class png_writer : public tile_writer {
+public:
+	png_writer(const std::string& file_name, uint32_t width, uint32_t height, uint32_t tile_size);
+	virtual bool write(const tile& tile_);
+	virtual bool finish();
+
+private:
+	/**
+		The row struct holds the scanlines of a row of tiles until they are all done.
+	*/
+	struct row {
+		std::vector<unsigned char> m_scanlines; // every scanline starts with its filter type.
+		uint64_t m_tile_count = 0;
+	};
+
+	void write_chunk(const char* type, const unsigned char* data, size_t size);
+	void write_row(row& row_, bool last);
+
+	std::string m_file_name;
+	std::ofstream m_file;
+	std::map<uint64_t, row> m_rows; // the rows of tiles not written yet.
+	uint64_t m_next_row = 0;
+	uint32_t m_adler_a = 1;
+	uint32_t m_adler_b = 0;
+	std::vector<unsigned char> m_chunk;
+};
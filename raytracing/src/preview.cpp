@@ -0,0 +1,96 @@
+#include "preview.h"
+#include "raytracer.h"
+#include "CImg-2.5.5/CImg.h"
+#include <iostream>
+#include <memory>
+#include <vector>
+
+/**
+	Parameterized constructor.
+
+	Opens the window on the display thread.
+
+	@param raytracer_ the raytracer whose image is displayed.
+*/
+preview::preview(raytracer& raytracer_)
+	:
+	m_raytracer(raytracer_),
+	m_stop(false)
+{
+	m_thread = std::thread(&preview::display, this);
+}
+
+/**
+	Destructor. Closes the window.
+*/
+preview::~preview() {
+	m_stop = true;
+	m_thread.join();
+}
+
+/**
+	Waits for the user to restart the render or to close the window.
+
+	@return bool true to restart the render, false once the window is closed or
+	if there is no display.
+*/
+bool preview::wait() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_requested.wait(lock, [this] { return m_request != request::none; });
+	if (m_request == request::close) return false;
+	m_request = request::none;
+	return true;
+}
+
+/**
+	Sets the request that wait() returns. Closing the window is final.
+
+	@param request_ the request.
+*/
+void preview::set_request(request request_) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_request != request::close) m_request = request_;
+	}
+	m_requested.notify_all();
+}
+
+/**
+	The display thread.
+
+	Every PREVIEW_INTERVAL ms, copies the tiles of the image that changed since
+	the previous refresh, and handles the keys of the window.
+*/
+void preview::display() {
+	cimg_library::CImg<unsigned char> image(m_raytracer.width(), m_raytracer.height(), 1, 3, 0);
+	std::vector<uint32_t> versions;
+	std::unique_ptr<cimg_library::CImgDisplay> display_;
+	try {
+		display_.reset(new cimg_library::CImgDisplay(image, "Raytracer"));
+	}
+	catch (const cimg_library::CImgDisplayException&) {
+		std::cout << "No display, the preview is disabled." << std::endl;
+		set_request(request::close);
+		return;
+	}
+
+	while (!m_stop) {
+		if (m_raytracer.snapshot(image, versions)) display_->display(image);
+		display_->wait(PREVIEW_INTERVAL);
+
+		if (display_->is_closed()) {
+			m_raytracer.cancel();
+			set_request(request::close);
+			return;
+		}
+		if (display_->is_keyR()) {
+			display_->set_key();
+			m_raytracer.cancel();
+			set_request(request::restart);
+		}
+		else if (display_->is_keyESC()) {
+			display_->set_key();
+			m_raytracer.cancel();
+		}
+	}
+}
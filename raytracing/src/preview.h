@@ -0,0 +1,45 @@
+/**
+	The preview class displays the image of a raytracer while it renders.
+
+	The display runs on its own thread, and refreshes the window from snapshots
+	of the framebuffer at a fixed rate: the render threads never wait for it. See
+	raytracer::snapshot(). In the window, R restarts the render and Escape
+	cancels it. Closing the window cancels the render too.
+*/
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// the time between two refreshes of the preview, in ms.
+#define PREVIEW_INTERVAL 100
+
+class raytracer;
+
+class preview {
+public:
+	preview(raytracer& raytracer_);
+	~preview();
+	preview(const preview&) = delete;
+	preview& operator=(const preview&) = delete;
+
+	bool wait();
+
+private:
+	enum class request {
+		none,
+		restart,
+		close
+	};
+
+	void display();
+	void set_request(request request_);
+
+	raytracer& m_raytracer;
+	std::atomic<bool> m_stop;
+	request m_request = request::none;
+	std::mutex m_mutex;
+	std::condition_variable m_requested;
+	std::thread m_thread;
+};
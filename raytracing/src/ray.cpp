@@ -11,27 +11,34 @@
 ray::ray(glm::vec3 origin, glm::vec3 target) : m_origin(origin) {
 	m_direction = glm::normalize(target - origin);
 	m_hit.m_t = FLT_MAX;
-	m_hit.m_hit = false;
+	m_hit.m_u = 0.f;
+	m_hit.m_v = 0.f;
+	m_hit.m_primitive = 0;
+	m_hit.m_shape = nullptr;
 }
 
 /**
-	Saves the relevant information of the intersection of the ray and a shape.
+	Saves the intersection of the ray and a shape if it is the closest one so far.
+
+	Only the minimum needed to later reconstruct the intersection is saved.
+	See shape::get_surface().
 
 	@param t time of intersection.
-	@param position the intersection position in world space.
-	@param normal the normal at the intersection position.
-	@param mat the material of the shape at that hit point.
+	@param shape the shape that was hit.
+	@param primitive [optional] the index of the primitive of the shape that was hit.
+	@param u [optional] the first barycentric coordinate of the hit on the primitive.
+	@param v [optional] the second barycentric coordinate of the hit on the primitive.
 */
-void ray::set_hit(float t, glm::vec3 position, glm::vec3 normal, shape::material mat) {
+void ray::set_hit(float t, const shape* shape, unsigned int primitive, float u, float v) {
 	// if true, intersection is either behind the camera or behind a previous intersection.
 	// disregard this intersection.
 	if (t <= 0 || t > m_hit.m_t) return; 
 
 	m_hit.m_t = t;
-	m_hit.m_position = position;
-	m_hit.m_normal = glm::normalize(normal);
-	m_hit.m_material = mat;
-	m_hit.m_hit = true;
+	m_hit.m_u = u;
+	m_hit.m_v = v;
+	m_hit.m_primitive = primitive;
+	m_hit.m_shape = shape;
 }
 
 /**
@@ -40,10 +47,10 @@ void ray::set_hit(float t, glm::vec3 position, glm::vec3 normal, shape::material
 	@param t time parameter.
 	@return glm::vec3 the position at time t.
 */
-glm::vec3 ray::point_at(float t) {
+glm::vec3 ray::point_at(float t) const {
 	return glm::vec3(m_origin + m_direction * t);
 }
 
-hit::operator bool() {
-	return m_hit;
-}
\ No newline at end of file
+hit::operator bool() const {
+	return m_shape != nullptr;
+}
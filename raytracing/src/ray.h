@@ -5,27 +5,32 @@
 
 /**
 	The hit struct holds the intersection information of a ray and a shape.
+
+	Only what is needed to find the closest intersection is saved while the ray
+	is traced: the time of intersection, the shape and primitive that were hit and
+	the barycentric coordinates (u, v) of the hit on that primitive. The position,
+	normal and material are computed once the closest hit is known.
+	See shape::get_surface().
 */
 struct hit {
-	operator bool();
+	operator bool() const;
 	float m_t;
-	glm::vec3 m_position;
-	glm::vec3 m_normal;
-	shape::material m_material;
-
-private:
-	bool m_hit;
-	friend ray;
+	float m_u;
+	float m_v;
+	unsigned int m_primitive;
+	const shape* m_shape;
 };
 
+static_assert(sizeof(hit) <= 64, "hit must fit in a cache line");
+
 /**
 	The ray class.
 */
 class ray {
 public:
 	ray(glm::vec3 origin, glm::vec3 target);
-	void set_hit(float t, glm::vec3 position, glm::vec3 normal, shape::material mat);
-	glm::vec3 point_at(float t);
+	void set_hit(float t, const shape* shape, unsigned int primitive = 0, float u = 0.f, float v = 0.f);
+	glm::vec3 point_at(float t) const;
 
 	glm::vec3 m_origin;
 	glm::vec3 m_direction;
@@ -1,128 +1,870 @@
 #include "raytracer.h"
-#include "ray.h"
+#include "cycles.h"
+#include "thread_pool.h"
+#include "preview.h"
+#include "sampler.h"
+#include "fingerprint.h"
+#include "event_trace.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <mutex>
 #include <random>
+#include <sstream>
 
 /**
 	Parameterized constructor.
 
-	@param scene a reference to the scene to render.
+	Also describes the scene and the screen for the kernels. See scene_view.
+
+	@param scene a reference to the scene to render. It is only read, so several
+	raytracers can render it at once.
 	@param screen a reference to screen through which rays will be traced.
-	@param image a reference to the window where the render should be displayed.
+	@param options_ the command line options, for the tiles, the pixel format, the
+	progressive render, the threads, the seed, the checkpoint, the statistics, the
+	images of the cost of the pixels and the profile of the shapes.
+	@param pool [optional] the thread pool the tiles are rendered on, shared with
+	other raytracers. The raytracer has its own pool if none is given.
+	@param priority [optional] the priority of the tiles in pool.
 */
-raytracer::raytracer(scene& scene, screen& screen, cimg_library::CImg<float>& image) 
+raytracer::raytracer(scene& scene, screen& screen, const options& options_, thread_pool* pool, int priority)
 	: 
 	m_scene(scene), 
-	m_screen(screen), 
-	m_image(image) 
-{}
+	m_screen(screen),
+	m_width((uint32_t)screen.m_width),
+	m_height((uint32_t)screen.m_height),
+	m_tile_size(options_.m_tile_size),
+	m_format(options_.m_format),
+	m_budget(options_.m_budget),
+	m_samples(options_.m_samples),
+	m_thread_count(options_.m_threads),
+	m_seed(options_.m_seed),
+	m_checkpoint(options_.m_checkpoint),
+	m_checkpoint_interval(options_.m_checkpoint_interval),
+	m_checkpoint_key(0),
+	m_stats_file(options_.m_stats),
+	m_aov_file(options_.m_aovs),
+	m_profile_shapes(options_.m_profile_shapes),
+	m_pool(pool),
+	m_priority(priority),
+	m_ray_cycles(0),
+	m_ray_count(0),
+	m_cancelled(false)
+{
+	m_tile_count = (((uint64_t)m_width + m_tile_size - 1) / m_tile_size) * (((uint64_t)m_height + m_tile_size - 1) / m_tile_size);
+	m_tile_versions.reset(new std::atomic<uint32_t>[(size_t)m_tile_count]());
+	if (!m_checkpoint.empty()) m_checkpoint_key = get_checkpoint_key(options_);
+	if (!m_pool) {
+		m_own_pool.reset(new thread_pool(m_thread_count));
+		m_pool = m_own_pool.get();
+	}
+
+	for (const shape* shape_ : m_scene.m_shapes) {
+		m_views.push_back(shape_->get_view());
+	}
+	m_shape_costs.resize(m_views.size());
+	m_view.m_shapes = m_views.data();
+	m_view.m_shape_count = (unsigned int)m_views.size();
+	set_lights(m_scene.m_lights);
+	m_view.m_materials = m_scene.m_materials.data();
+	m_view.m_eye = m_scene.m_camera->m_position;
+	m_screen_view = m_screen.get_view();
+}
+
+/**
+	Moves the eye of the rays, for a camera other than the one of the scene. The
+	screen must be the one of that camera.
+
+	@param eye the position of the camera.
+*/
+void raytracer::set_eye(const glm::vec3& eye) {
+	m_view.m_eye = eye;
+}
+
+/**
+	Moves the camera, for the next frame of an animation. The size of the image
+	does not change.
+
+	@param camera_ the camera.
+*/
+void raytracer::set_camera(const camera& camera_) {
+	m_screen_view = screen(camera_, (float)m_height).get_view();
+	m_view.m_eye = camera_.m_position;
+}
+
+/**
+	Updates a shape of the scene that moved, for the next frame of an animation.
+	See scene::set_frame().
+
+	@param index the index of the shape in the scene.
+*/
+void raytracer::update_shape(size_t index) {
+	m_views[index] = m_scene.m_shapes[index]->get_view();
+}
+
+/**
+	Sets the lights of the render, instead of the ones of the scene.
+
+	@param lights the lights.
+*/
+void raytracer::set_lights(const std::vector<light>& lights) {
+	m_lights = lights;
+	m_view.m_lights = m_lights.data();
+	m_view.m_light_count = (unsigned int)m_lights.size();
+}
 
 /**
 	The starting point of the raytracer class.
 
-	This method traces multiple rays (anti-aliasing) for every pixel of m_screen. It then
-	computes compute the color at the point of intersection (if any) and saves that color
-	in m_image. Once done, it renders the result.
+	Renders the image into m_image while a preview displays it, see preview.
+	Once a render is done or cancelled, the image is saved, with the images of the
+	cost of its pixels if the options asked for them, and the render can be
+	restarted from the preview, without loading the scene again.
 */
 void raytracer::run() {
-	glm::vec3 COP(m_scene.m_camera->m_position);
-	unsigned int height = (unsigned int)m_screen.m_height;
-	unsigned int width = (unsigned int)m_screen.m_width;
-	unsigned int pixel_count = width * height;
-
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_real_distribution<float> dist(0.f, 1.f);
-	for (unsigned int i = 0; i < pixel_count; i++) {
-		glm::vec3 color(0.f);
-		unsigned int u = i % width;
-		unsigned int v = i / width;
-		for (unsigned int j = 0; j < ANTI_ALIASING_SAMPLE; j++) {
-			float rand = dist(gen);
-			glm::vec3 target = m_screen.to_world(u + rand, v + rand);
-			color += trace(ray(COP, target));
+	m_image = framebuffer(m_width, m_height, m_format);
+	std::cout << "Framebuffer: " << to_string(m_format) << ", " << m_image.memory_usage() / 1024 << " KB." << std::endl;
+
+	preview preview_(*this);
+	do {
+		m_cancelled = false;
+		m_ray_cycles = 0;
+		m_ray_count = 0;
+		m_counters.reset();
+		m_shape_costs.assign(m_views.size(), shape_cost());
+		if (!m_aov_file.empty()) m_aovs.reset(new aov_buffers(m_width, m_height));
+		auto start = std::chrono::steady_clock::now();
+		render();
+		report(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), 0.);
+		save("test.bmp");
+		save_aovs();
+	} while (preview_.wait());
+}
+
+/**
+	Renders the image in tiles, see render_tiles(), and streams every tile to
+	writer as soon as it is done. The image is never held in memory as a whole.
+
+	A progressive render needs the whole image, see render_progressive(): its
+	tiles are written once the render stops. So does a render with a checkpoint,
+	see run_checkpointed(). The checkpoint is removed once the file is written.
+	The images of the cost of the pixels of a tiled render are saved after it,
+	see aov_buffers.
+
+	@param writer the writer of the image file.
+	@return bool false if the file could not be written, see tile_writer::error(),
+	or if the render was cancelled.
+*/
+bool raytracer::run(tile_writer& writer) {
+	auto start = std::chrono::steady_clock::now();
+	m_write_ms = 0.;
+	if (!m_checkpoint.empty()) {
+		if (!run_checkpointed(writer)) return false;
+	}
+	else if (m_budget || m_samples) {
+		m_image = framebuffer(m_width, m_height, m_format);
+		render_progressive([](unsigned int) {}, get_seed());
+		if (m_cancelled || !write_image(writer)) return false;
+	}
+	else {
+		if (!m_aov_file.empty()) m_aovs.reset(new aov_buffers(m_width, m_height));
+		// output is called by one thread at a time.
+		render_tiles([this, &writer](const tile& tile_) {
+			scoped_event event("write tile", "output", (int64_t)tile_.m_index);
+			auto write_start = std::chrono::steady_clock::now();
+			bool written = writer.write(tile_);
+			m_write_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - write_start).count();
+			return written;
+		}, get_seed());
+	}
+	if (m_cancelled) return false;
+	auto finish_start = std::chrono::steady_clock::now();
+	scoped_event finish_event("finish", "output");
+	if (!writer.finish()) return false;
+	m_write_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - finish_start).count();
+	if (!m_checkpoint.empty()) std::remove(m_checkpoint.c_str());
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	report(elapsed.count() * 1e3 - m_write_ms, m_write_ms);
+	std::cout << "Rendered " << m_width << "x" << m_height << " pixels in " << elapsed.count() << " s." << std::endl;
+	save_aovs();
+	return true;
+}
+
+/**
+	Writes the tiles of m_image, and adds the time it took to m_write_ms.
+
+	@param writer the writer of the image file.
+	@return bool false if a tile could not be written.
+*/
+bool raytracer::write_image(tile_writer& writer) {
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t i = 0; i < m_tile_count; i++) {
+		tile tile_ = get_tile(i);
+		tile_.m_pixels = framebuffer(tile_.m_width, tile_.m_height, m_format);
+		size_t row_size = tile_.m_width * m_image.pixel_size();
+		for (uint32_t y = 0; y < tile_.m_height; y++) {
+			const unsigned char* row = m_image.row(tile_.m_y + y) + tile_.m_x * m_image.pixel_size();
+			std::copy(row, row + row_size, tile_.m_pixels.row(y));
+		}
+		scoped_event event("write tile", "output", (int64_t)i);
+		if (!writer.write(tile_)) return false;
+	}
+	m_write_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+/**
+	Renders the image into m_image, and saves the progress of the render to the
+	checkpoint file every m_checkpoint_interval seconds, see checkpoint_writer.
+	The render threads only wait while the done tiles are copied.
+
+	A checkpoint of the same scene files and options is resumed: the tiles of a
+	tiled render that are done are not rendered again, and a progressive render
+	continues after the last complete pass. The render keeps the seed of the
+	checkpoint, so the image is identical to the one of a render that was not
+	stopped, even on another CPU. The time limit of a progressive render starts
+	again with the resumed render.
+
+	@param writer the writer of the image file.
+	@return bool false if the file could not be written, or if the render was
+	cancelled.
+*/
+bool raytracer::run_checkpointed(tile_writer& writer) {
+	bool progressive = m_budget || m_samples;
+	unsigned int seed = get_seed();
+	unsigned int first_pass = 0;
+	m_image = framebuffer(m_width, m_height, m_format);
+	if (progressive) m_accumulation = framebuffer(m_width, m_height, pixel_format::float32);
+	m_tile_samples.assign((size_t)m_tile_count, 0);
+
+	if (std::ifstream(m_checkpoint)) {
+		checkpoint saved;
+		std::string error;
+		if (!load_checkpoint(m_checkpoint, saved, error)) {
+			std::cout << error << " Starting over." << std::endl;
+		}
+		else if (saved.m_key != m_checkpoint_key || !restore_checkpoint(saved)) {
+			std::cout << m_checkpoint << " is the checkpoint of another render. Starting over." << std::endl;
+		}
+		else {
+			seed = saved.m_seed;
+			first_pass = saved.m_passes;
+			uint64_t done = std::count_if(m_tile_samples.begin(), m_tile_samples.end(), [](unsigned int samples) { return samples > 0; });
+			std::cout << "Resuming from " << m_checkpoint << ": " << done << " of " << m_tile_count << " tiles done";
+			if (progressive) std::cout << ", " << first_pass << " passes";
+			std::cout << "." << std::endl;
+		}
+	}
+
+	checkpoint_writer checkpoints(m_checkpoint, m_checkpoint_interval);
+	auto save = [&](unsigned int passes) {
+		auto copy_start = std::chrono::steady_clock::now();
+		std::unique_ptr<checkpoint> checkpoint_ = make_checkpoint(seed, passes);
+		checkpoints.write(std::move(checkpoint_), std::chrono::steady_clock::now() - copy_start);
+	};
+	if (progressive) {
+		render_progressive([&](unsigned int passes) {
+			if (checkpoints.is_due()) save(passes);
+		}, seed, first_pass);
+	}
+	else {
+		// called under the lock of render_tiles(): the tiles that are marked done are not written anymore.
+		render_tiles([&](const tile& tile_) {
+			m_tile_samples[(size_t)tile_.m_index] = ANTI_ALIASING_SAMPLE;
+			if (checkpoints.is_due()) save(0);
+			return true;
+		}, seed, &m_image);
+	}
+	checkpoints.finish();
+	checkpoints.report(std::cout);
+	m_tile_samples.clear();
+	return !m_cancelled && write_image(writer);
+}
+
+/**
+	Identifies the scene files, by their content, and the options that change the
+	image, so that a checkpoint is only resumed by the same render.
+
+	@param options_ the command line options.
+	@return uint64_t the key of the checkpoints of the render.
+*/
+uint64_t raytracer::get_checkpoint_key(const options& options_) const {
+	std::ostringstream content;
+	for (const std::string& path : m_scene.files()) {
+		file_fingerprint fingerprint;
+		get_fingerprint(path, fingerprint);
+		content << path << " " << fingerprint.m_size << " " << fingerprint.m_hash << "\n";
+	}
+	content << m_width << " " << m_height << " " << m_tile_size << " " << to_string(m_format) << " "
+		<< to_string(options_.m_triangle_algorithm) << " " << (m_budget || m_samples ? "progressive " : "tiled ") << m_samples;
+	std::string text = content.str();
+	return hash_bytes(text.data(), text.size());
+}
+
+/**
+	Copies the progress of the render: the tiles of m_image that are done, or the
+	sums of the samples of a progressive render. No tile of the copy may be
+	written meanwhile.
+
+	@param seed the seed of the render.
+	@param passes the complete passes of a progressive render.
+	@return std::unique_ptr<checkpoint> the checkpoint.
+*/
+std::unique_ptr<checkpoint> raytracer::make_checkpoint(unsigned int seed, unsigned int passes) const {
+	const framebuffer& source = m_budget || m_samples ? m_accumulation : m_image;
+	std::unique_ptr<checkpoint> checkpoint_(new checkpoint());
+	checkpoint_->m_key = m_checkpoint_key;
+	checkpoint_->m_seed = seed;
+	checkpoint_->m_passes = passes;
+	checkpoint_->m_width = m_width;
+	checkpoint_->m_height = m_height;
+	checkpoint_->m_tile_size = m_tile_size;
+	checkpoint_->m_format = source.format();
+	checkpoint_->m_tile_samples = m_tile_samples;
+
+	size_t size = 0;
+	for (uint64_t i = 0; i < m_tile_count; i++) {
+		tile tile_ = get_tile(i);
+		if (m_tile_samples[(size_t)i]) size += (size_t)tile_.m_width * tile_.m_height * source.pixel_size();
+	}
+	checkpoint_->m_pixels.reserve(size);
+	for (uint64_t i = 0; i < m_tile_count; i++) {
+		if (!m_tile_samples[(size_t)i]) continue;
+		tile tile_ = get_tile(i);
+		size_t row_size = tile_.m_width * source.pixel_size();
+		for (uint32_t y = tile_.m_y; y < tile_.m_y + tile_.m_height; y++) {
+			const unsigned char* row = source.row(y) + tile_.m_x * source.pixel_size();
+			checkpoint_->m_pixels.insert(checkpoint_->m_pixels.end(), row, row + row_size);
+		}
+	}
+	return checkpoint_;
+}
+
+/**
+	Restores the progress of a render from a checkpoint, see make_checkpoint(). The
+	tiles of a progressive render are also averaged into m_image.
+
+	@param checkpoint_ the checkpoint.
+	@return bool false if the checkpoint does not fit the image.
+*/
+bool raytracer::restore_checkpoint(const checkpoint& checkpoint_) {
+	bool progressive = m_budget || m_samples;
+	framebuffer& target = progressive ? m_accumulation : m_image;
+	if (checkpoint_.m_width != m_width || checkpoint_.m_height != m_height || checkpoint_.m_tile_size != m_tile_size
+		|| checkpoint_.m_format != target.format() || checkpoint_.m_tile_samples.size() != m_tile_count) {
+		return false;
+	}
+	size_t size = 0;
+	for (uint64_t i = 0; i < m_tile_count; i++) {
+		tile tile_ = get_tile(i);
+		if (checkpoint_.m_tile_samples[(size_t)i]) size += (size_t)tile_.m_width * tile_.m_height * target.pixel_size();
+	}
+	if (size != checkpoint_.m_pixels.size()) return false;
+
+	const unsigned char* pixels = checkpoint_.m_pixels.data();
+	for (uint64_t i = 0; i < m_tile_count; i++) {
+		unsigned int samples = checkpoint_.m_tile_samples[(size_t)i];
+		if (!samples) continue;
+		tile tile_ = get_tile(i);
+		size_t row_size = tile_.m_width * target.pixel_size();
+		for (uint32_t y = tile_.m_y; y < tile_.m_y + tile_.m_height; y++, pixels += row_size) {
+			std::copy(pixels, pixels + row_size, target.row(y) + tile_.m_x * target.pixel_size());
+			if (!progressive) continue;
+			for (uint32_t x = tile_.m_x; x < tile_.m_x + tile_.m_width; x++) {
+				m_image.set(x, y, m_accumulation.get(x, y) / (float)samples);
+			}
+		}
+	}
+	m_tile_samples = checkpoint_.m_tile_samples;
+	return true;
+}
+
+/**
+	Cancels the render. Tiles that are not started yet are skipped, and run()
+	returns once the tiles being rendered are done.
+
+	May be called from any thread.
+*/
+void raytracer::cancel() {
+	m_cancelled = true;
+}
+
+/**
+	@return bool true if the render was cancelled. A cancelled run() does not
+	finish the file of its writer.
+*/
+bool raytracer::is_cancelled() const {
+	return m_cancelled;
+}
+
+/**
+	Copies the tiles of m_image that changed since the previous snapshot.
+
+	Tiles are copied without locking, so the render threads never wait: every
+	tile has a version that is odd while the tile is written, and a tile is only
+	kept if its version was even and did not change while it was copied, like a
+	seqlock. Tiles being written are copied by a later snapshot.
+
+	May be called from any thread, while rendering.
+
+	@param image [in, out] the 8 bit image, of the size of m_image.
+	@param versions [in, out] the versions of the tiles in image, empty at first.
+	@return bool true if a tile of image changed.
+*/
+bool raytracer::snapshot(cimg_library::CImg<unsigned char>& image, std::vector<uint32_t>& versions) const {
+	versions.resize((size_t)m_tile_count, 0);
+	std::vector<unsigned char> copy((size_t)m_tile_size * m_tile_size * 3);
+	bool changed = false;
+	for (uint64_t i = 0; i < m_tile_count; i++) {
+		uint32_t version = m_tile_versions[i].load(std::memory_order_acquire);
+		if (version == versions[(size_t)i] || (version & 1)) continue;
+
+		tile tile_ = get_tile(i);
+		unsigned char* pixel = copy.data();
+		for (uint32_t y = tile_.m_y; y < tile_.m_y + tile_.m_height; y++) {
+			for (uint32_t x = tile_.m_x; x < tile_.m_x + tile_.m_width; x++) {
+				glm::vec3 color = m_image.get(x, y);
+				*pixel++ = to_byte(color.x);
+				*pixel++ = to_byte(color.y);
+				*pixel++ = to_byte(color.z);
+			}
 		}
-		color /= ANTI_ALIASING_SAMPLE;
-		write_pixel(u, v, color);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (m_tile_versions[i].load(std::memory_order_relaxed) != version) continue;
+
+		pixel = copy.data();
+		for (uint32_t y = tile_.m_y; y < tile_.m_y + tile_.m_height; y++) {
+			for (uint32_t x = tile_.m_x; x < tile_.m_x + tile_.m_width; x++) {
+				image(x, y, 0) = *pixel++;
+				image(x, y, 1) = *pixel++;
+				image(x, y, 2) = *pixel++;
+			}
+		}
+		versions[(size_t)i] = version;
+		changed = true;
 	}
+	return changed;
+}
 
-	render();
+/**
+	Marks a tile of m_image as being written. See snapshot().
+
+	@param index the index of the tile.
+*/
+void raytracer::begin_write(uint64_t index) {
+	m_tile_versions[index].fetch_add(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
 }
 
 /**
-	This method traces rays in the scene.
+	Marks a tile of m_image as written. See snapshot().
 
-	This is done by checking for an intersection between ray_ and every shape in m_scene.
-	If there is a hit, sends a shadow ray to every light in the scene to determine if the
-	hit is in shadows or not. Computes the color accordingly.
+	@param index the index of the tile.
+*/
+void raytracer::end_write(uint64_t index) {
+	m_tile_versions[index].fetch_add(1, std::memory_order_release);
+}
 
-	@param ray_ the ray to trace.
-	@return glm::vec3 the color of the pixel.
+/**
+	@return uint32_t the width of the image in pixels.
 */
-glm::vec3 raytracer::trace(ray ray_) {
-	glm::vec3 color(0.f);
+uint32_t raytracer::width() const {
+	return m_width;
+}
+
+/**
+	@return uint32_t the height of the image in pixels.
+*/
+uint32_t raytracer::height() const {
+	return m_height;
+}
+
+/**
+	@return uint64_t the number of tiles of the image.
+*/
+uint64_t raytracer::tile_count() const {
+	return m_tile_count;
+}
 
-	for (unsigned int i = 0; i < m_scene.m_shapes.size(); i++) {
-		m_scene.m_shapes[i]->intersection(&ray_);
+/**
+	Reports the number of rays traced and their average cost in CPU cycles, then
+	the statistics of the render, see render_stats, also saved as JSON to the
+	file of the options if one was given, and the costs of the shapes when they
+	are profiled.
+
+	@param trace_ms the time of the render, less the time of writing the image.
+	@param write_ms the time of writing the image.
+*/
+void raytracer::report(double trace_ms, double write_ms) const {
+	unsigned long long ray_count = m_ray_count;
+	std::cout << "Traced " << ray_count << " rays, " << ray_count / glm::max((unsigned long long)m_width * m_height, 1ull)
+		<< " per pixel." << std::endl;
+	std::cout << "Average cycles per ray: " << m_ray_cycles / glm::max(ray_count, 1ull) << std::endl;
+
+	render_stats stats = m_counters.get();
+	const timeline& load = m_scene.m_load_timeline;
+	stats.m_phase_ms[(size_t)render_phase::parse] = load.total(" parse");
+	stats.m_phase_ms[(size_t)render_phase::mesh_load] = load.total(" read") + load.total(" map") + load.total(" cached") + load.total(" assemble");
+	stats.m_phase_ms[(size_t)render_phase::normals] = load.total(" normals");
+	stats.m_phase_ms[(size_t)render_phase::acceleration] = load.total(" records");
+	stats.m_phase_ms[(size_t)render_phase::trace] = trace_ms;
+	stats.m_phase_ms[(size_t)render_phase::write] = write_ms;
+	uint64_t pixels = (uint64_t)m_width * m_height;
+	stats.print(std::cout, pixels);
+	if (m_profile_shapes && RENDER_STATS) {
+		std::vector<std::string> names;
+		for (size_t i = 0; i < m_shape_costs.size(); i++) {
+			names.push_back(m_scene.shape_name(i));
+		}
+		print_shape_costs(std::cout, m_shape_costs, names);
+	}
+
+	std::string error;
+	if (!m_stats_file.empty() && !stats.save_json(m_stats_file, pixels, error)) std::cerr << error << std::endl;
+}
+
+/**
+	Saves the images of the cost of the pixels of the last tiled render to the
+	file of the options, see aov_buffers::save(). Does nothing without them.
+*/
+void raytracer::save_aovs() const {
+	std::string error;
+	if (m_aovs && !m_aovs->save(m_aov_file, m_tile_size, error)) std::cerr << error << std::endl;
+}
+
+/**
+	Adds the costs of the shapes of a tile to m_shape_costs. Called by any thread,
+	once per tile.
+
+	@param costs the costs, by index of shape.
+*/
+void raytracer::add_shape_costs(const std::vector<shape_cost>& costs) {
+	std::lock_guard<std::mutex> lock(m_shape_mutex);
+	for (size_t i = 0; i < costs.size(); i++) {
+		m_shape_costs[i].add(costs[i]);
 	}
-	// if true, there is a hit, so cast shadow rays to determine if the intersection
-	// point is obstructed by another shape or not.
-	if (ray_.m_hit) {
-		for (light light_ : m_scene.m_lights) {
-			ray shadow_ray(ray_.m_hit.m_position + ray_.m_hit.m_normal * SHADOW_BIAS, light_.m_position);
-			unsigned int i = 0;
+}
+
+/**
+	@param index the index of a tile, in row order.
+	@return tile the tile, without pixels.
+*/
+tile raytracer::get_tile(uint64_t index) const {
+	uint64_t tiles_across = ((uint64_t)m_width + m_tile_size - 1) / m_tile_size;
+	tile tile_;
+	tile_.m_index = index;
+	tile_.m_x = (uint32_t)(index % tiles_across * m_tile_size);
+	tile_.m_y = (uint32_t)(index / tiles_across * m_tile_size);
+	tile_.m_width = std::min(m_tile_size, m_width - tile_.m_x);
+	tile_.m_height = std::min(m_tile_size, m_height - tile_.m_y);
+	return tile_;
+}
+
+/**
+	@return unsigned int the seed of the options, or a random one if none was
+	given.
+*/
+unsigned int raytracer::get_seed() const {
+	return m_seed ? m_seed : std::random_device()();
+}
+
+/**
+	Renders the tiles of the image on a thread pool, in row order, and passes
+	every tile to output once it is done.
 
-			while (!shadow_ray.m_hit && i < m_scene.m_shapes.size()) {
-				m_scene.m_shapes[i]->intersection(&shadow_ray);
-				i++;
+	At most a row of tiles and two tiles per thread are in flight, rendering or
+	waiting for output, so the memory used does not depend on the height of the
+	image. Without image, tiles are not started more than one row of tiles past
+	the first row that is not complete: a writer that keeps the tiles of a row
+	until the row is complete, see png_writer, holds at most two rows of tiles,
+	even when a tile is slow. output is called by one thread at a time. Rendering
+	stops when output fails or when the render is cancelled.
+
+	When image is given, the tiles are rendered straight into it instead of into
+	their own pixels. Tiles start on a multiple of 16 pixels, so the threads never
+	write to the same cache line. See framebuffer.
+
+	Tiles that have samples in m_tile_samples, restored from a checkpoint, are
+	skipped. See run_checkpointed().
+
+	@param output the function that consumes a tile, false on failure.
+	@param seed the seed of the render, see render_tile().
+	@param image the framebuffer of the whole image, or nullptr.
+*/
+void raytracer::render_tiles(const std::function<bool(const tile&)>& output, unsigned int seed, framebuffer* image) {
+	uint64_t tiles_across = ((uint64_t)m_width + m_tile_size - 1) / m_tile_size;
+	uint64_t tiles_down = ((uint64_t)m_height + m_tile_size - 1) / m_tile_size;
+	uint64_t tile_count = tiles_across * tiles_down;
+
+	task_group tasks(*m_pool, m_priority);
+	uint64_t max_in_flight = tiles_across + 2 * m_pool->thread_count();
+	uint64_t in_flight = 0;
+	bool failed = false;
+	std::vector<uint64_t> row_tiles_done((size_t)tiles_down, 0);
+	uint64_t next_row = 0; // the first row of tiles that is not complete.
+	std::mutex mutex;
+	std::condition_variable tile_done;
+
+	// called under the lock once a tile is output or skipped.
+	auto count_done = [&](uint64_t i) {
+		row_tiles_done[(size_t)(i / tiles_across)]++;
+		while (next_row < tiles_down && row_tiles_done[(size_t)next_row] == tiles_across) next_row++;
+	};
+
+	for (uint64_t i = 0; i < tile_count; i++) {
+		if (i < m_tile_samples.size() && m_tile_samples[(size_t)i]) {
+			std::lock_guard<std::mutex> lock(mutex);
+			count_done(i);
+			continue;
+		}
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			tile_done.wait(lock, [&] {
+				return failed || (in_flight < max_in_flight && (image || i / tiles_across <= next_row + 1));
+			});
+			if (failed || m_cancelled) break;
+			in_flight++;
+		}
+		tasks.submit([&, i] {
+			tile tile_ = get_tile(i);
+			if (image) {
+				begin_write(i);
+				render_tile(tile_, *image, tile_.m_x, tile_.m_y, seed);
+				end_write(i);
+			}
+			else {
+				tile_.m_pixels = framebuffer(tile_.m_width, tile_.m_height, m_format);
+				render_tile(tile_, tile_.m_pixels, 0, 0, seed);
 			}
 
-			if (!shadow_ray.m_hit) {
-				color += get_color(ray_.m_hit, light_);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!failed && !output(tile_)) failed = true;
+				in_flight--;
+				count_done(i);
 			}
+			tile_done.notify_one();
+		});
+	}
+	tasks.wait();
+}
+
+/**
+	Renders a tile on the calling thread, into its own framebuffer. The tiles of
+	a render split across processes, see render_worker, must be rendered with the
+	same seed.
+
+	@param index the index of the tile, in row order.
+	@param seed the seed of the render.
+	@return tile the tile.
+*/
+tile raytracer::render_tile(uint64_t index, unsigned int seed) {
+	tile tile_ = get_tile(index);
+	tile_.m_pixels = framebuffer(tile_.m_width, tile_.m_height, m_format);
+	render_tile(tile_, tile_.m_pixels, 0, 0, seed);
+	return tile_;
+}
+
+/**
+	Renders a tile.
+
+	This method traces multiple rays (anti-aliasing) for every pixel of the tile.
+	The rays of a pixel are traced by the trace kernel, in packets of the width
+	selected for the CPU: every packet is intersected with every shape of m_scene,
+	and a shadow packet is sent from the hits to every light to determine if they
+	are in shadows or not. The phong colors are averaged and saved in target.
+	With m_aovs, the cycles, tests and shadow rays of every pixel are saved too.
+
+	@param tile_ the tile.
+	@param target the framebuffer the colors are saved in.
+	@param x the column of target the tile starts at.
+	@param y the row of target the tile starts at.
+	@param seed the seed of the render. The anti-aliasing offsets of a pixel only
+	depend on the seed and on the pixel, see sample_offset().
+*/
+void raytracer::render_tile(const tile& tile_, framebuffer& target, uint32_t x, uint32_t y, unsigned int seed) {
+	scoped_event event("tile", "render", (int64_t)tile_.m_index);
+	trace_function trace = get_trace();
+	sample_offsets_function sample_offsets = get_kernels().m_sample_offsets;
+	float offsets[ANTI_ALIASING_SAMPLE];
+	unsigned long long ray_cycles = 0;
+	render_stats stats;
+	std::vector<shape_cost> shape_costs(m_profile_shapes ? m_views.size() : 0);
+	if (m_profile_shapes) stats.m_shape_costs = shape_costs.data();
+	render_stats pixel_stats = stats; // the counters of a pixel, with m_aovs.
+	aov_buffers* aovs = m_aovs.get();
+
+	for (uint32_t j = 0; j < tile_.m_height; j++) {
+		for (uint32_t i = 0; i < tile_.m_width; i++) {
+			sample_offsets(pixel_key(seed, tile_.m_x + i, tile_.m_y + j), 0, ANTI_ALIASING_SAMPLE, offsets);
+			float u = (float)(tile_.m_x + i);
+			float v = (float)(tile_.m_y + j);
+			unsigned long long start = read_cycles();
+			glm::vec3 color = trace(m_view, m_screen_view, u, v, offsets, ANTI_ALIASING_SAMPLE, aovs ? pixel_stats : stats);
+			unsigned long long cycles = read_cycles() - start;
+			ray_cycles += cycles;
+			if (aovs) {
+				aovs->set(tile_.m_x + i, tile_.m_y + j, cycles, pixel_stats);
+				stats.add(pixel_stats);
+				pixel_stats.clear();
+			}
+
+			target.set(x + i, y + j, color / (float)ANTI_ALIASING_SAMPLE);
 		}
-		color += ray_.m_hit.m_material.m_ambient;
 	}
-	return color;
+	m_ray_cycles += ray_cycles;
+	m_ray_count += (unsigned long long)tile_.m_width * tile_.m_height * ANTI_ALIASING_SAMPLE;
+	m_counters.add(stats);
+	if (m_profile_shapes) add_shape_costs(shape_costs);
 }
 
 /**
-	Computes the color at the intersection point hit_.
+	Renders m_image progressively, in passes of one sample per pixel over the
+	whole image, so that a first image is ready after one pass rather than after
+	the whole render.
 
-	Uses phong shading to determine the color.
-	
-	@param hit_ the information of the ray intersection point.
-	@param light_ the light.
-	@return glm::vec3 the color at hit_ point.
+	The samples are summed in m_accumulation, and every tile of m_image is updated
+	with the average of its samples as soon as the tile is done. Rendering stops
+	after m_samples passes, at the time limit of m_budget ms, or when the render
+	is cancelled: tiles are not started past it, so the tiles of the last pass
+	may have one sample more than the others. m_image must be allocated.
+
+	@param publish the function called after every complete pass, with the
+	number of passes done.
+	@param seed the seed of the render, see accumulate_tile().
+	@param first_pass [optional] the pass to start at. The passes before it must
+	be in m_accumulation, m_tile_samples and m_image, see restore_checkpoint().
+	@return unsigned int the number of complete passes.
 */
-glm::vec3 raytracer::get_color(hit hit_, light light_) {
-	glm::vec3 light_dir = glm::normalize(light_.m_position - hit_.m_position);
-	float dot_diff = glm::max(glm::dot(light_dir, hit_.m_normal), 0.f);
-	glm::vec3 diffuse = hit_.m_material.m_diffuse * light_.m_diffuse * dot_diff;
+unsigned int raytracer::render_progressive(const std::function<void(unsigned int)>& publish, unsigned int seed, unsigned int first_pass) {
+	uint64_t tiles_across = ((uint64_t)m_width + m_tile_size - 1) / m_tile_size;
+	uint64_t tiles_down = ((uint64_t)m_height + m_tile_size - 1) / m_tile_size;
+	uint64_t tile_count = tiles_across * tiles_down;
+	unsigned int pass_count = m_samples ? m_samples : std::numeric_limits<unsigned int>::max();
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_budget);
 
-	glm::vec3 view_dir = glm::normalize(m_scene.m_camera->m_position - hit_.m_position);
-	glm::vec3 reflection = glm::reflect(-light_dir, hit_.m_normal);
-	float dot_spec = glm::pow(glm::max(glm::dot(view_dir, reflection), 0.f), hit_.m_material.m_shi);
-	glm::vec3 specular = hit_.m_material.m_specular * light_.m_specular * dot_spec;
+	if (first_pass == 0) {
+		m_accumulation = framebuffer(m_width, m_height, pixel_format::float32);
+		m_tile_samples.assign((size_t)tile_count, 0);
+	}
 
-	return diffuse + specular;
+	task_group tasks(*m_pool, m_priority);
+	std::atomic<bool> expired(false);
+	unsigned int pass = first_pass;
+	for (; pass < pass_count; pass++) {
+		for (uint64_t i = 0; i < tile_count; i++) {
+			tasks.submit([&, i, pass] {
+				if (expired || m_cancelled) return;
+				if (m_budget && std::chrono::steady_clock::now() >= deadline) {
+					expired = true;
+					return;
+				}
+				begin_write(i);
+				accumulate_tile(get_tile(i), pass, seed);
+				end_write(i);
+			});
+		}
+		tasks.wait();
+		if (expired || m_cancelled) break;
+		publish(pass + 1);
+	}
+	return pass;
 }
 
 /**
-	Writes the color at pixel (u, v).
+	Traces one more sample for every pixel of a tile of a progressive render.
+
+	The samples of a row of the tile are traced by the trace row kernel, in
+	packets of neighbouring pixels, as a packet per pixel would only hold one
+	active ray. They are added to m_accumulation, and the new averages are saved
+	in m_image.
+
+	@param tile_ the tile.
+	@param pass the index of the pass, which is the index of the sample of every pixel.
+	@param seed the seed of the render.
 */
-void raytracer::write_pixel(unsigned int u, unsigned int v, glm::vec3 color) {
-	m_image(u, v, 0) = glm::clamp(color.x * 255.f, 0.f, 255.f);
-	m_image(u, v, 1) = glm::clamp(color.y * 255.f, 0.f, 255.f);
-	m_image(u, v, 2) = glm::clamp(color.z * 255.f, 0.f, 255.f);
+void raytracer::accumulate_tile(const tile& tile_, unsigned int pass, unsigned int seed) {
+	scoped_event event("tile", "render", (int64_t)tile_.m_index);
+	trace_row_function trace_row = get_trace_row();
+	row_offsets_function row_offsets = get_kernels().m_row_offsets;
+	std::vector<float> offsets(tile_.m_width);
+	std::vector<glm::vec3> colors(tile_.m_width);
+	unsigned long long ray_cycles = 0;
+	render_stats stats;
+	std::vector<shape_cost> shape_costs(m_profile_shapes ? m_views.size() : 0);
+	if (m_profile_shapes) stats.m_shape_costs = shape_costs.data();
+
+	// a tile is rendered by one thread per pass, and passes do not overlap.
+	float samples = (float)++m_tile_samples[(size_t)tile_.m_index];
+	for (uint32_t y = tile_.m_y; y < tile_.m_y + tile_.m_height; y++) {
+		row_offsets(seed, tile_.m_x, y, pass, tile_.m_width, offsets.data());
+		unsigned long long start = read_cycles();
+		trace_row(m_view, m_screen_view, (float)tile_.m_x, (float)y, offsets.data(), tile_.m_width, colors.data(), stats);
+		ray_cycles += read_cycles() - start;
+
+		for (uint32_t i = 0; i < tile_.m_width; i++) {
+			glm::vec3 sum = m_accumulation.get(tile_.m_x + i, y) + colors[i];
+			m_accumulation.set(tile_.m_x + i, y, sum);
+			m_image.set(tile_.m_x + i, y, sum / samples);
+		}
+	}
+	m_ray_cycles += ray_cycles;
+	m_ray_count += (unsigned long long)tile_.m_width * tile_.m_height;
+	m_counters.add(stats);
+	if (m_profile_shapes) add_shape_costs(shape_costs);
 }
 
 /**
-	Renders the scene.
+	Renders the image once into m_image, in tiles, see render_tiles(), or
+	progressively if a time limit or a sample count was given, see
+	render_progressive().
 */
 void raytracer::render() {
-	m_image.save("test.bmp");
-	cimg_library::CImgDisplay main_disp(m_image, "Raytracer");
-	while (!main_disp.is_closed()) {
-		main_disp.wait();
+	if (m_budget || m_samples) {
+		auto start = std::chrono::steady_clock::now();
+		render_progressive([start](unsigned int passes) {
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			std::cout << "Pass " << passes << " done in " << (long long)elapsed.count() << " ms." << std::endl;
+		}, get_seed());
+	}
+	else render_tiles([](const tile&) { return true; }, get_seed(), &m_image);
+	if (m_cancelled) std::cout << "Render cancelled." << std::endl;
+}
+
+/**
+	Renders a frame of an animation into image, see render(). The image is not
+	displayed, so that it can be written while the next frame renders.
+
+	@param image the framebuffer of the frame, width() x height() pixels in the
+	pixel format of the options.
+*/
+void raytracer::render_frame(framebuffer& image) {
+	if (m_budget || m_samples) {
+		std::swap(m_image, image);
+		render_progressive([](unsigned int) {}, get_seed());
+		std::swap(m_image, image);
+	}
+	else render_tiles([](const tile&) { return true; }, get_seed(), &image);
+}
+
+/**
+	Saves m_image as an 8 bit image.
+
+	@param file_name the name of the image file.
+*/
+void raytracer::save(const char* file_name) const {
+	cimg_library::CImg<unsigned char> image(m_width, m_height, 1, 3, 0);
+	for (uint32_t y = 0; y < m_height; y++) {
+		for (uint32_t x = 0; x < m_width; x++) {
+			glm::vec3 color = m_image.get(x, y);
+			image(x, y, 0) = to_byte(color.x);
+			image(x, y, 1) = to_byte(color.y);
+			image(x, y, 2) = to_byte(color.z);
+		}
 	}
-}
\ No newline at end of file
+	image.save(file_name);
+}
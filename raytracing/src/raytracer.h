@@ -4,23 +4,95 @@
 #pragma once
 #include "scene.h"
 #include "screen.h"
-#include "ray.h"
+#include "kernels.h"
+#include "options.h"
+#include "tile.h"
+#include "tile_writer.h"
+#include "thread_pool.h"
+#include "checkpoint.h"
+#include "aov_buffers.h"
 #include "CImg-2.5.5/CImg.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
 #define ANTI_ALIASING_SAMPLE 32
-#define SHADOW_BIAS 0.01f
 
 class raytracer {
 public:
-	raytracer(scene& scene, screen& screen, cimg_library::CImg<float>& image);
+	raytracer(scene& scene, screen& screen, const options& options_, thread_pool* pool = nullptr, int priority = 0);
+	void set_eye(const glm::vec3& eye);
+	void set_lights(const std::vector<light>& lights);
+	void set_camera(const camera& camera_);
+	void update_shape(size_t index);
 	void run();
+	bool run(tile_writer& writer);
+	void cancel();
+	bool is_cancelled() const;
+	tile render_tile(uint64_t index, unsigned int seed);
+	uint64_t tile_count() const;
+	void render_frame(framebuffer& image);
+	bool snapshot(cimg_library::CImg<unsigned char>& image, std::vector<uint32_t>& versions) const;
+	uint32_t width() const;
+	uint32_t height() const;
 
 private:
+	tile get_tile(uint64_t index) const;
+	unsigned int get_seed() const;
+	void render_tiles(const std::function<bool(const tile&)>& output, unsigned int seed, framebuffer* image = nullptr);
+	void render_tile(const tile& tile_, framebuffer& target, uint32_t x, uint32_t y, unsigned int seed);
+	unsigned int render_progressive(const std::function<void(unsigned int)>& publish, unsigned int seed, unsigned int first_pass = 0);
+	void accumulate_tile(const tile& tile_, unsigned int pass, unsigned int seed);
+	bool write_image(tile_writer& writer);
+	bool run_checkpointed(tile_writer& writer);
+	uint64_t get_checkpoint_key(const options& options_) const;
+	std::unique_ptr<checkpoint> make_checkpoint(unsigned int seed, unsigned int passes) const;
+	bool restore_checkpoint(const checkpoint& checkpoint_);
+	void report(double trace_ms, double write_ms) const;
+	void save_aovs() const;
+	void add_shape_costs(const std::vector<shape_cost>& costs);
+	void begin_write(uint64_t index);
+	void end_write(uint64_t index);
 	void render();
-	void write_pixel(unsigned int u, unsigned int v, glm::vec3 color);
-	glm::vec3 trace(ray ray_);
-	glm::vec3 get_color(hit hit_, light light_);
+	void save(const char* file_name) const;
 
 	scene& m_scene;
 	screen& m_screen;
-	cimg_library::CImg<float>& m_image;
+	framebuffer m_image;
+	framebuffer m_accumulation; // the sums of the samples of a progressive render.
+	// the samples per pixel of every tile of a progressive render, or of a render resumed from a checkpoint.
+	std::vector<unsigned int> m_tile_samples;
+	std::vector<shape_view> m_views;
+	std::vector<light> m_lights;
+	scene_view m_view;
+	screen_view m_screen_view;
+	uint32_t m_width;
+	uint32_t m_height;
+	uint32_t m_tile_size;
+	pixel_format m_format;
+	unsigned int m_budget; // the time limit of a progressive render in ms, 0 for none.
+	unsigned int m_samples; // the samples per pixel of a progressive render, 0 for none.
+	unsigned int m_thread_count;
+	unsigned int m_seed; // the seed of the renders, 0 for a random one per render.
+	std::string m_checkpoint; // the checkpoint file of run(), empty for none.
+	unsigned int m_checkpoint_interval;
+	uint64_t m_checkpoint_key; // identifies the scene files and the options a checkpoint is valid for.
+	std::string m_stats_file; // the JSON file the statistics are saved to, empty for none.
+	std::string m_aov_file; // the name of the images of the cost of the pixels, empty for none.
+	std::unique_ptr<aov_buffers> m_aovs; // the cost of the pixels of a tiled render, see render_tile().
+	bool m_profile_shapes; // true to count the cost of every shape.
+	std::unique_ptr<thread_pool> m_own_pool; // the pool of the raytracer, if none was given.
+	thread_pool* m_pool;
+	int m_priority; // the priority of the tiles in m_pool.
+	std::atomic<unsigned long long> m_ray_cycles;
+	std::atomic<unsigned long long> m_ray_count;
+	render_counters m_counters; // the counters of the kernels, see render_stats.
+	std::mutex m_shape_mutex;
+	std::vector<shape_cost> m_shape_costs; // the cost of every shape, by index in m_scene.m_shapes.
+	double m_write_ms = 0.; // the time run() spent writing the image.
+	uint64_t m_tile_count;
+	std::atomic<bool> m_cancelled;
+	// the version of every tile of m_image, odd while the tile is written. See snapshot().
+	std::unique_ptr<std::atomic<uint32_t>[]> m_tile_versions;
 };
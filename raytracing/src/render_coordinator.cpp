@@ -0,0 +1,347 @@
+#include "render_coordinator.h"
+#include "fingerprint.h"
+#include "tokenizer.h"
+#include "event_trace.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+/**
+	Splits the address of a worker.
+
+	@param address the address, host:port.
+	@param host [out] the host.
+	@param port [out] the port.
+	@return bool false if the address is invalid.
+*/
+bool parse_address(const std::string& address, std::string& host, uint16_t& port) {
+	size_t colon = address.rfind(':');
+	if (colon == std::string::npos || colon == 0 || colon + 1 == address.size() || address.size() - colon > 6
+		|| address.find_first_not_of("0123456789", colon + 1) != std::string::npos) {
+		return false;
+	}
+	unsigned long number = std::stoul(address.substr(colon + 1));
+	if (number == 0 || number > 65535) return false;
+	host = address.substr(0, colon);
+	port = (uint16_t)number;
+	return true;
+}
+
+}
+
+/**
+	Parameterized constructor.
+
+	@param options_ the options of the render: the workers, the triangle
+	algorithm, the tile size and the pixel format.
+*/
+render_coordinator::render_coordinator(const options& options_) : m_options(options_), m_tile_time(0) {}
+
+/**
+	Renders the image on the workers, see render_coordinator, and streams the
+	tiles to writer.
+
+	@param scene_ the scene, loaded from its file.
+	@param screen_ the screen of the camera of the scene.
+	@param writer the writer of the image file.
+	@param error [out] the reason the image could not be rendered.
+	@return bool false if no worker was left to render the image, or if the file
+	could not be written.
+*/
+bool render_coordinator::run(const scene& scene_, const screen& screen_, tile_writer& writer, std::string& error) {
+	auto start = std::chrono::steady_clock::now();
+	if (!prepare(scene_, error)) return false;
+	m_width = (uint32_t)screen_.m_width;
+	m_height = (uint32_t)screen_.m_height;
+	m_screen_height = screen_.m_height;
+	m_tiles_across = writer.tiles_across();
+	m_tile_count = m_tiles_across * writer.tiles_down();
+	m_seed = m_options.m_seed ? m_options.m_seed : std::random_device()();
+	m_writer = &writer;
+	m_states.assign((size_t)m_tile_count, tile_state::pending);
+	m_issued.assign((size_t)m_tile_count, std::chrono::steady_clock::time_point());
+	for (uint64_t i = 0; i < m_tile_count; i++) {
+		m_pending.push_back(i);
+	}
+
+	std::vector<std::thread> threads;
+	for (const std::string& address : m_options.m_workers) {
+		m_workers.emplace_back(new worker());
+		m_workers.back()->m_address = address;
+	}
+	m_live_workers = (unsigned int)m_workers.size();
+	for (std::unique_ptr<worker>& worker_ : m_workers) {
+		threads.push_back(std::thread(&render_coordinator::drive, this, std::ref(*worker_)));
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_changed.wait(lock, [this] { return m_done == m_tile_count || m_live_workers == 0 || !m_error.empty(); });
+		if (m_error.empty() && m_done < m_tile_count) m_error = "No worker is left to render the image.";
+	}
+	// wakes up the workers that wait for tiles that were done by others.
+	for (std::unique_ptr<worker>& worker_ : m_workers) {
+		worker_->m_socket.shutdown();
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	for (const std::unique_ptr<worker>& worker_ : m_workers) {
+		std::cout << worker_->m_address << ": " << worker_->m_tiles << " tiles, " << worker_->m_duplicates << " duplicates";
+		if (!worker_->m_error.empty()) std::cout << ", dropped (" << worker_->m_error << ")";
+		std::cout << "." << std::endl;
+	}
+	if (!m_error.empty() || !writer.finish()) {
+		error = m_error.empty() ? writer.error() : m_error;
+		return false;
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "Rendered " << m_width << "x" << m_height << " pixels on " << m_workers.size() << " workers in "
+		<< elapsed.count() << " s, " << m_width * (double)m_height / elapsed.count() * 1e-6 << " Mpixels/s, "
+		<< m_reissued << " slow tiles handed out again." << std::endl;
+	return true;
+}
+
+/**
+	Lists the files of the scene, and hashes their content.
+
+	@param scene_ the scene.
+	@param error [out] the reason the files cannot be sent.
+	@return bool false on failure.
+*/
+bool render_coordinator::prepare(const scene& scene_, std::string& error) {
+	std::vector<std::string> paths = scene_.files();
+	size_t directory_size = paths[0].find_last_of("/\\") + 1;
+	std::ostringstream content;
+	for (const std::string& path : paths) {
+		file_fingerprint fingerprint;
+		if (!get_fingerprint(path, fingerprint)) {
+			error = "Cannot read " + path + ".";
+			return false;
+		}
+		file file_ = { path.substr(directory_size), path, fingerprint.m_size };
+		if (file_.m_name.find_first_of(" \t\r\n") != std::string::npos) {
+			error = "Cannot send " + path + " to the workers: its name has blanks.";
+			return false;
+		}
+		m_files.push_back(file_);
+		content << file_.m_name << " " << fingerprint.m_size << " " << fingerprint.m_hash << "\n";
+	}
+	std::string text = content.str();
+	std::ostringstream hash;
+	hash << std::hex << std::setw(16) << std::setfill('0') << hash_bytes(text.data(), text.size());
+	m_hash = hash.str();
+	return true;
+}
+
+/**
+	Renders tiles on a worker until the image is done, or the worker fails. Runs
+	on a thread of its own.
+
+	@param worker_ the worker.
+*/
+void render_coordinator::drive(worker& worker_) {
+	std::set<uint64_t> held; // the tiles handed out to the worker and not received yet.
+	if (!connect(worker_)) {
+		drop(worker_, held, worker_.m_error);
+		return;
+	}
+
+	unsigned int credits = 2 * std::max(1u, worker_.m_thread_count);
+	std::string line;
+	std::vector<unsigned char> pixels;
+	while (true) {
+		uint64_t index;
+		bool sent = true;
+		while (sent && held.size() < credits && next_tile(held, held.empty(), index)) {
+			held.insert(index);
+			sent = worker_.m_socket.write("tile " + std::to_string(index) + "\n");
+		}
+		if (!sent) break;
+		if (held.empty()) return;
+
+		long long number, size;
+		if (!worker_.m_socket.read_line(line)) break;
+		tokenizer tokenizer_(line.data(), line.data() + line.size());
+		if (!tokenizer_.read_keyword("tile") || !tokenizer_.read_int(number) || !held.count((uint64_t)number)
+			|| !tokenizer_.read_int(size) || size < 0 || size > 1LL << 32) {
+			drop(worker_, held, line.empty() ? "invalid response" : line);
+			return;
+		}
+		pixels.resize((size_t)size);
+		if (!worker_.m_socket.read(pixels.data(), pixels.size())) break;
+		held.erase((uint64_t)number);
+		deliver(worker_, (uint64_t)number, pixels);
+	}
+	drop(worker_, held, "no response");
+}
+
+/**
+	Connects to a worker, and sends it the scene and the frame.
+
+	@param worker_ the worker.
+	@return bool false on failure, see worker::m_error.
+*/
+bool render_coordinator::connect(worker& worker_) {
+	std::string host, line;
+	uint16_t port;
+	if (!parse_address(worker_.m_address, host, port)) {
+		worker_.m_error = "invalid address";
+		return false;
+	}
+	if (!worker_.m_socket.connect_tcp(host, port, worker_.m_error)) return false;
+	worker_.m_socket.set_timeout(WORKER_TIMEOUT);
+
+	worker_.m_socket.write("scene " + m_hash + " " + to_string(m_options.m_triangle_algorithm) + " " + m_files[0].m_name + "\n");
+	if (!worker_.m_socket.read_line(line)) line.clear();
+	if (line == "need" && (!send_files(worker_) || !worker_.m_socket.read_line(line))) line.clear();
+	long long number, width, height;
+	tokenizer ready(line.data(), line.data() + line.size());
+	if (!ready.read_keyword("ready") || !ready.read_int(number) || number < 1) {
+		worker_.m_error = line.empty() ? "no response" : line;
+		return false;
+	}
+	worker_.m_thread_count = (unsigned int)std::min(number, 1024LL);
+
+	// 9 digits give the same float back.
+	std::ostringstream screen_height;
+	screen_height << std::setprecision(9) << m_screen_height;
+	worker_.m_socket.write("frame " + screen_height.str() + " " + std::to_string(m_options.m_tile_size) + " "
+		+ to_string(m_options.m_format) + " " + std::to_string(m_seed) + "\n");
+	if (!worker_.m_socket.read_line(line)) line.clear();
+	tokenizer ok(line.data(), line.data() + line.size());
+	if (!ok.read_keyword("ok") || !ok.read_int(width) || !ok.read_int(height) || width != m_width || height != m_height) {
+		worker_.m_error = line.empty() ? "no response" : "invalid frame: " + line;
+		return false;
+	}
+	return true;
+}
+
+/**
+	Sends the files of the scene to a worker, see render_worker.
+
+	@param worker_ the worker.
+	@return bool false on failure.
+*/
+bool render_coordinator::send_files(worker& worker_) {
+	std::vector<char> buffer(1 << 20);
+	for (const file& file_ : m_files) {
+		std::ifstream in(file_.m_path, std::ios::binary);
+		if (!worker_.m_socket.write("file " + file_.m_name + " " + std::to_string(file_.m_size) + "\n")) return false;
+		for (uint64_t sent = 0; sent < file_.m_size;) {
+			size_t count = (size_t)std::min<uint64_t>(file_.m_size - sent, buffer.size());
+			// a file that shrank since it was hashed is sent padded, and fails to load.
+			if (!in.read(buffer.data(), count)) std::memset(buffer.data(), 0, count);
+			if (!worker_.m_socket.write(buffer.data(), count)) return false;
+			sent += count;
+		}
+	}
+	return worker_.m_socket.write("end\n");
+}
+
+/**
+	Hands out a tile: the first pending one, or once there is none, a tile that
+	is much slower than the average, see STRAGGLER_FACTOR.
+
+	@param held the tiles handed out to the worker, that are not handed out to it again.
+	@param wait true to wait for a tile while the image is not done.
+	@param index [out] the index of the tile.
+	@return bool false if there is no tile to hand out.
+*/
+bool render_coordinator::next_tile(const std::set<uint64_t>& held, bool wait, uint64_t& index) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_done < m_tile_count && m_error.empty()) {
+		auto now = std::chrono::steady_clock::now();
+		while (!m_pending.empty()) {
+			index = m_pending.front();
+			m_pending.pop_front();
+			if (m_states[(size_t)index] == tile_state::done) continue;
+			m_states[(size_t)index] = tile_state::issued;
+			m_issued[(size_t)index] = now;
+			return true;
+		}
+
+		if (m_done > 0) {
+			std::chrono::steady_clock::duration slow = m_tile_time / m_done * STRAGGLER_FACTOR;
+			for (uint64_t i = 0; i < m_tile_count; i++) {
+				if (m_states[(size_t)i] == tile_state::issued && now - m_issued[(size_t)i] > slow && !held.count(i)) {
+					m_issued[(size_t)i] = now;
+					m_reissued++;
+					index = i;
+					return true;
+				}
+			}
+		}
+		if (!wait) return false;
+		m_changed.wait_for(lock, std::chrono::milliseconds(50));
+	}
+	return false;
+}
+
+/**
+	Writes a tile received from a worker, unless another worker sent it first.
+
+	@param worker_ the worker.
+	@param index the index of the tile.
+	@param pixels the rows of the tile, in the pixel format of the image.
+*/
+void render_coordinator::deliver(worker& worker_, uint64_t index, const std::vector<unsigned char>& pixels) {
+	tile tile_;
+	tile_.m_index = index;
+	tile_.m_x = (uint32_t)(index % m_tiles_across) * m_options.m_tile_size;
+	tile_.m_y = (uint32_t)(index / m_tiles_across) * m_options.m_tile_size;
+	tile_.m_width = std::min(m_options.m_tile_size, m_width - tile_.m_x);
+	tile_.m_height = std::min(m_options.m_tile_size, m_height - tile_.m_y);
+	tile_.m_pixels = framebuffer(tile_.m_width, tile_.m_height, m_options.m_format);
+	size_t row_size = tile_.m_width * tile_.m_pixels.pixel_size();
+	if (pixels.size() != row_size * tile_.m_height) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_error = "Invalid tile from " + worker_.m_address + ".";
+		m_changed.notify_all();
+		return;
+	}
+	for (uint32_t y = 0; y < tile_.m_height; y++) {
+		std::memcpy(tile_.m_pixels.row(y), &pixels[y * row_size], row_size);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_states[(size_t)index] == tile_state::done) {
+		worker_.m_duplicates++;
+		return;
+	}
+	m_states[(size_t)index] = tile_state::done;
+	m_done++;
+	m_tile_time += std::chrono::steady_clock::now() - m_issued[(size_t)index];
+	worker_.m_tiles++;
+	scoped_event event("write tile", "output", (int64_t)index);
+	if (!m_writer->write(tile_) && m_error.empty()) m_error = m_writer->error();
+	m_changed.notify_all();
+}
+
+/**
+	Stops using a worker, and hands out its tiles again.
+
+	@param worker_ the worker.
+	@param held the tiles handed out to the worker and not received.
+	@param reason the reason the worker is dropped.
+*/
+void render_coordinator::drop(worker& worker_, const std::set<uint64_t>& held, const std::string& reason) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_done < m_tile_count && m_error.empty()) {
+		worker_.m_error = reason;
+		std::cout << "Dropped the worker " << worker_.m_address << " (" << reason << ")." << std::endl;
+	}
+	for (auto i = held.rbegin(); i != held.rend(); ++i) {
+		if (m_states[(size_t)*i] != tile_state::done) m_pending.push_front(*i);
+	}
+	m_live_workers--;
+	m_changed.notify_all();
+}
@@ -0,0 +1,94 @@
+/**
+	The render_coordinator class renders an image on workers, processes that may
+	run on other machines, and writes their tiles to the image file. See
+	render_worker for the protocol.
+
+	The scene is identified by the hash of the content of its scene and mesh
+	files: a worker that loaded it before renders at once, otherwise the files are
+	sent to it. Tiles are handed out as the workers ask for them, a few per
+	thread of the worker so that they never wait for the network. The tiles of a
+	worker that fails or stops responding are handed out again, and once every
+	tile is handed out, the tiles that take much longer than the others are
+	handed out to an idle worker too: the first result is kept.
+*/
+#pragma once
+#include "options.h"
+#include "scene.h"
+#include "screen.h"
+#include "stream_socket.h"
+#include "tile_writer.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+// the time a worker has to respond, in ms, before its tiles are handed out to the other workers.
+#define WORKER_TIMEOUT 60000
+// the times the average time of a tile, after which the tile is handed out again.
+#define STRAGGLER_FACTOR 4
+
+class render_coordinator {
+public:
+	render_coordinator(const options& options_);
+	bool run(const scene& scene_, const screen& screen_, tile_writer& writer, std::string& error);
+
+private:
+	/**
+		The worker struct holds the connection to a worker and its statistics.
+	*/
+	struct worker {
+		std::string m_address; // host:port.
+		stream_socket m_socket;
+		unsigned int m_thread_count = 0;
+		uint64_t m_tiles = 0; // the tiles that were written from this worker.
+		uint64_t m_duplicates = 0; // the tiles it rendered that another worker rendered first.
+		std::string m_error; // the reason the worker was dropped, empty if it was not.
+	};
+
+	/**
+		The file struct holds a file of the scene to send to the workers.
+	*/
+	struct file {
+		std::string m_name; // the path relative to the directory of the scene file.
+		std::string m_path;
+		uint64_t m_size;
+	};
+
+	enum class tile_state : uint8_t { pending, issued, done };
+
+	bool prepare(const scene& scene_, std::string& error);
+	void drive(worker& worker_);
+	bool connect(worker& worker_);
+	bool send_files(worker& worker_);
+	bool next_tile(const std::set<uint64_t>& held, bool wait, uint64_t& index);
+	void deliver(worker& worker_, uint64_t index, const std::vector<unsigned char>& pixels);
+	void drop(worker& worker_, const std::set<uint64_t>& held, const std::string& reason);
+
+	options m_options;
+	std::string m_hash; // the content hash of m_files.
+	std::vector<file> m_files; // the scene file, then the mesh files.
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	float m_screen_height = 0.f; // the height of the screen, sent to the workers.
+	uint64_t m_tiles_across = 0;
+	uint64_t m_tile_count = 0;
+	unsigned int m_seed = 0;
+	tile_writer* m_writer = nullptr;
+
+	std::mutex m_mutex;
+	std::condition_variable m_changed; // notified when a tile is done or a worker is dropped.
+	std::vector<tile_state> m_states;
+	std::vector<std::chrono::steady_clock::time_point> m_issued; // the time every tile was last handed out.
+	std::deque<uint64_t> m_pending; // the tiles to hand out, in order.
+	uint64_t m_done = 0;
+	uint64_t m_reissued = 0; // the tiles handed out again because they were slow.
+	std::chrono::steady_clock::duration m_tile_time; // the sum of the times of the done tiles.
+	unsigned int m_live_workers = 0;
+	std::string m_error; // the reason the render failed, empty while it did not.
+	std::vector<std::unique_ptr<worker>> m_workers;
+};
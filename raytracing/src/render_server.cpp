@@ -0,0 +1,414 @@
+#include "render_server.h"
+#include "raytracer.h"
+#include "screen.h"
+#include "tile_writer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+/**
+	Parameterized constructor.
+
+	@param options_ the options of the renders, see options. The options of a
+	request override them.
+*/
+render_server::render_server(const options& options_)
+	:
+	m_options(options_),
+	m_pool(options_.m_threads),
+	m_stop(false),
+	m_scene_hits(0),
+	m_scene_misses(0)
+{}
+
+/**
+	Serves the requests until a quit request.
+
+	@param path the path of the socket.
+	@param error [out] the reason the server could not start.
+	@return bool false if the server could not start.
+*/
+bool render_server::run(const std::string& path, std::string& error) {
+	stream_socket listener;
+	if (!listener.listen(path, error)) return false;
+	m_path = path;
+	std::cout << "Serving on " << path << " with " << m_pool.thread_count() << " threads." << std::endl;
+
+	while (!m_stop) {
+		stream_socket client = listener.accept();
+		if (m_stop) break;
+		if (!client.is_open()) continue;
+		{
+			std::lock_guard<std::mutex> lock(m_jobs_mutex);
+			m_connections++;
+		}
+		std::thread(&render_server::serve, this, std::move(client)).detach();
+	}
+
+	std::unique_lock<std::mutex> lock(m_jobs_mutex);
+	m_connection_closed.wait(lock, [this] { return m_connections == 0; });
+	std::cout << "Stopped serving on " << path << "." << std::endl;
+	return true;
+}
+
+/**
+	Serves the requests of a connection, one after the other, until the client
+	closes it.
+
+	@param client the connection.
+*/
+void render_server::serve(stream_socket client) {
+	std::string request;
+	while (client.read_line(request) && handle(request, client)) {}
+	client.close();
+
+	// notified under the lock, as the server may be destroyed once run() returns.
+	std::lock_guard<std::mutex> lock(m_jobs_mutex);
+	if (--m_connections == 0) m_connection_closed.notify_all();
+}
+
+/**
+	Serves a request.
+
+	@param request the line of the request.
+	@param client the connection the responses are written to.
+	@return bool false once the connection must be closed.
+*/
+bool render_server::handle(const std::string& request, stream_socket& client) {
+	tokenizer tokenizer_(request.data(), request.data() + request.size());
+	std::string response;
+	if (tokenizer_.at_end()) return true;
+	if (tokenizer_.read_keyword("render")) {
+		render(tokenizer_, client);
+		return true;
+	}
+	if (tokenizer_.read_keyword("cancel")) {
+		long long id;
+		if (!tokenizer_.read_int(id) || id <= 0) response = "error expected a job id";
+		else if (!cancel((uint64_t)id)) response = "error unknown job " + std::to_string(id);
+		else response = "ok";
+	}
+	else if (tokenizer_.read_keyword("stats")) response = stats();
+	else if (tokenizer_.read_keyword("quit")) {
+		m_stop = true;
+		client.write("ok\n");
+		// wakes up run(), which waits for a connection.
+		stream_socket wake;
+		std::string ignored;
+		wake.connect(m_path, ignored);
+		return false;
+	}
+	else response = "error unknown request \"" + tokenizer_.peek_word() + "\"";
+	return client.write(response + "\n");
+}
+
+/**
+	Serves a render request, see render_server.
+
+	@param tokenizer_ the tokenizer of the request, after "render".
+	@param client the connection the responses are written to.
+*/
+void render_server::render(tokenizer& tokenizer_, stream_socket& client) {
+	auto start = std::chrono::steady_clock::now();
+	options options_ = m_options;
+	std::string scene_file, output, error;
+	int priority = 0;
+	bool has_eye = false;
+	glm::vec3 eye;
+	float fov = 0.f;
+	std::vector<std::pair<long long, glm::vec3>> lights;
+
+	while (error.empty() && !tokenizer_.at_end()) {
+		long long number;
+		glm::vec3 position;
+		if (tokenizer_.read_keyword("scene:")) {
+			if (!tokenizer_.read_word(scene_file)) error = "expected a scene file after \"scene:\"";
+		}
+		else if (tokenizer_.read_keyword("output:")) {
+			if (!tokenizer_.read_word(output)) error = "expected a file after \"output:\"";
+		}
+		else if (tokenizer_.read_keyword("height:")) {
+			if (!tokenizer_.read_int(number) || number < 1 || number > 1 << 20) error = "expected a height after \"height:\"";
+			else options_.m_height = (unsigned int)number;
+		}
+		else if (tokenizer_.read_keyword("samples:")) {
+			if (!tokenizer_.read_int(number) || number < 0 || number > 1 << 20) error = "expected a number after \"samples:\"";
+			else options_.m_samples = (unsigned int)number;
+		}
+		else if (tokenizer_.read_keyword("budget:")) {
+			if (!tokenizer_.read_int(number) || number < 0 || number > std::numeric_limits<int>::max()) error = "expected a time after \"budget:\"";
+			else options_.m_budget = (unsigned int)number;
+		}
+		else if (tokenizer_.read_keyword("priority:")) {
+			if (!tokenizer_.read_int(number) || number < std::numeric_limits<int>::min() || number > std::numeric_limits<int>::max()) {
+				error = "expected a number after \"priority:\"";
+			}
+			else priority = (int)number;
+		}
+		else if (tokenizer_.read_keyword("camera:")) {
+			if (!tokenizer_.read_vec3(eye)) error = "expected a position after \"camera:\"";
+			has_eye = true;
+		}
+		else if (tokenizer_.read_keyword("fov:")) {
+			if (!tokenizer_.read_float(fov) || !(fov > 0.f && fov < 180.f)) error = "expected an angle after \"fov:\"";
+		}
+		else if (tokenizer_.read_keyword("light:")) {
+			if (!tokenizer_.read_int(number) || !tokenizer_.read_vec3(position)) error = "expected an index and a position after \"light:\"";
+			else lights.push_back(std::make_pair(number, position));
+		}
+		else error = "unknown attribute \"" + tokenizer_.peek_word() + "\"";
+	}
+	if (error.empty() && scene_file.empty()) error = "expected \"scene:\"";
+	if (error.empty() && output.empty()) error = "expected \"output:\"";
+
+	std::shared_ptr<job> job_ = std::make_shared<job>();
+	uint64_t id;
+	{
+		std::lock_guard<std::mutex> lock(m_jobs_mutex);
+		id = m_next_job++;
+		m_jobs[id] = job_;
+	}
+	client.write("job " + std::to_string(id) + "\n");
+
+	bool cancelled = false;
+	std::shared_ptr<scene> scene_;
+	if (error.empty()) scene_ = get_scene(scene_file, error);
+	if (scene_) {
+		camera camera_ = *scene_->m_camera;
+		if (has_eye) camera_.m_position = eye;
+		if (fov > 0.f) camera_.m_fov = fov;
+		std::vector<light> lights_ = scene_->m_lights;
+		for (const std::pair<long long, glm::vec3>& light_ : lights) {
+			if (light_.first < 0 || light_.first >= (long long)lights_.size()) {
+				error = "the scene has no light " + std::to_string(light_.first);
+				break;
+			}
+			lights_[(size_t)light_.first].m_position = light_.second;
+		}
+
+		// a render too large for the memory is an error, not the end of the server.
+		if (error.empty()) {
+			try {
+				screen screen_(camera_, options_.m_height ? (float)options_.m_height : -1.f);
+				raytracer raytracer_(*scene_, screen_, options_, &m_pool, priority);
+				raytracer_.set_eye(camera_.m_position);
+				raytracer_.set_lights(lights_);
+
+				std::unique_ptr<tile_writer> writer = open_tile_writer(output,
+					(uint32_t)screen_.m_width, (uint32_t)screen_.m_height, options_.m_tile_size, error);
+				if (writer) {
+					{
+						std::lock_guard<std::mutex> lock(m_jobs_mutex);
+						if (job_->m_cancelled) raytracer_.cancel();
+						job_->m_raytracer = &raytracer_;
+					}
+					bool rendered = false;
+					try {
+						rendered = raytracer_.run(*writer);
+					}
+					catch (const std::bad_alloc&) {
+						error = "not enough memory to render " + scene_file;
+					}
+					catch (const std::length_error&) {
+						error = "not enough memory to render " + scene_file;
+					}
+					{
+						std::lock_guard<std::mutex> lock(m_jobs_mutex);
+						job_->m_raytracer = nullptr;
+					}
+					cancelled = raytracer_.is_cancelled();
+					if (!rendered && !cancelled && error.empty()) error = writer->error();
+					writer.reset();
+					if (!rendered) std::remove(output.c_str());
+				}
+			}
+			catch (const std::bad_alloc&) {
+				error = "not enough memory to render " + scene_file;
+			}
+			catch (const std::length_error&) {
+				error = "not enough memory to render " + scene_file;
+			}
+		}
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	{
+		std::lock_guard<std::mutex> lock(m_jobs_mutex);
+		m_jobs.erase(id);
+		if (!cancelled && error.empty()) {
+			m_render_count++;
+			m_latencies.push_back(elapsed.count());
+			if (m_latencies.size() > LATENCY_WINDOW) m_latencies.pop_front();
+		}
+	}
+
+	std::ostringstream response;
+	if (cancelled) response << "cancelled " << id;
+	else if (!error.empty()) response << "error " << id << " " << error;
+	else response << "done " << id << " " << elapsed.count() << " ms";
+	client.write(response.str() + "\n");
+}
+
+/**
+	Finds a scene in the cache, or loads it. A cached scene is used while its
+	scene file and mesh files have the same content, see is_current().
+
+	m_scenes_mutex is only held to find the entry of the path. A scene is checked
+	and loaded under the lock of its entry, so that requests for a scene that is
+	not loaded yet load it once, and the requests for other scenes do not wait.
+
+	@param path the path of the scene file.
+	@param error [out] the reason the scene could not be loaded.
+	@return std::shared_ptr<scene> the scene, or nullptr if it could not be loaded.
+*/
+std::shared_ptr<scene> render_server::get_scene(const std::string& path, std::string& error) {
+	std::shared_ptr<cached_scene> cached;
+	{
+		std::lock_guard<std::mutex> lock(m_scenes_mutex);
+		std::shared_ptr<cached_scene>& entry = m_scenes[path];
+		if (!entry) entry = std::make_shared<cached_scene>();
+		cached = entry;
+	}
+
+	std::lock_guard<std::mutex> lock(cached->m_mutex);
+	if (cached->m_scene) {
+		bool current = true;
+		for (file_fingerprint& fingerprint : cached->m_files) {
+			current = current && is_current(fingerprint);
+		}
+		if (current) {
+			m_scene_hits++;
+			return cached->m_scene;
+		}
+		cached->m_scene.reset();
+		cached->m_files.clear();
+	}
+	m_scene_misses++;
+
+	if (!load_scene(path, *cached, error)) {
+		// the entry of a scene that cannot be loaded is not kept.
+		std::lock_guard<std::mutex> scenes_lock(m_scenes_mutex);
+		auto found = m_scenes.find(path);
+		if (found != m_scenes.end() && found->second == cached) m_scenes.erase(found);
+		return nullptr;
+	}
+	return cached->m_scene;
+}
+
+/**
+	Loads a scene and the fingerprints of its files into an entry of the cache.
+	A scene too large for the memory is an error, not the end of the server.
+
+	@param path the path of the scene file.
+	@param cached [out] the entry, locked and empty.
+	@param error [out] the reason the scene could not be loaded.
+	@return bool false if the scene could not be loaded.
+*/
+bool render_server::load_scene(const std::string& path, cached_scene& cached, std::string& error) {
+	std::vector<file_fingerprint> files(1);
+	if (!get_fingerprint(path, files[0])) {
+		error = "cannot open " + path;
+		return false;
+	}
+	std::shared_ptr<scene> scene_;
+	try {
+		scene_ = std::make_shared<scene>(path, m_options, &m_meshes);
+	}
+	catch (const std::bad_alloc&) {
+		error = "not enough memory to load " + path;
+		return false;
+	}
+	catch (const std::length_error&) {
+		error = "not enough memory to load " + path;
+		return false;
+	}
+	if (!scene_->is_loaded()) {
+		error = scene_->load_error();
+		return false;
+	}
+
+	// the fingerprints of the meshes, as they were loaded.
+	std::vector<std::string> paths = scene_->files();
+	for (size_t i = 1; i < paths.size(); i++) {
+		file_fingerprint fingerprint;
+		if (!m_meshes.find_fingerprint(paths[i], m_options.m_triangle_algorithm, fingerprint)) continue;
+		files.push_back(fingerprint);
+	}
+	cached.m_files = files;
+	cached.m_scene = scene_;
+	return true;
+}
+
+/**
+	Cancels a render. See raytracer::cancel().
+
+	@param id the id of the job of the render.
+	@return bool false if no render has that id.
+*/
+bool render_server::cancel(uint64_t id) {
+	std::lock_guard<std::mutex> lock(m_jobs_mutex);
+	auto found = m_jobs.find(id);
+	if (found == m_jobs.end()) return false;
+	found->second->m_cancelled = true;
+	if (found->second->m_raytracer) found->second->m_raytracer->cancel();
+	return true;
+}
+
+/**
+	@return std::string the number of renders, the percentiles of the latency of
+	the latest LATENCY_WINDOW renders, and the size of the caches.
+*/
+std::string render_server::stats() {
+	std::vector<double> latencies;
+	std::ostringstream stats_;
+	{
+		std::lock_guard<std::mutex> lock(m_jobs_mutex);
+		latencies.assign(m_latencies.begin(), m_latencies.end());
+		stats_ << "renders " << m_render_count << " running " << m_jobs.size();
+	}
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [&latencies](double p) {
+		if (latencies.empty()) return 0.;
+		size_t rank = (size_t)std::ceil(p * latencies.size());
+		return latencies[std::max<size_t>(rank, 1) - 1];
+	};
+	stats_ << " latency p50 " << percentile(.5) << " p90 " << percentile(.9) << " p99 " << percentile(.99)
+		<< " max " << percentile(1.) << " ms";
+	{
+		std::lock_guard<std::mutex> lock(m_scenes_mutex);
+		stats_ << " scenes " << m_scenes.size() << " hits " << m_scene_hits << " misses " << m_scene_misses;
+	}
+	stats_ << " meshes " << m_meshes.size() << " " << m_meshes.memory_usage() / 1024 << " KB";
+	return stats_.str();
+}
+
+/**
+	Sends a request to a render server, and writes its responses until it closes
+	the connection. See render_server.
+
+	@param path the path of the socket of the server.
+	@param request the request.
+	@param out the stream the responses are written to.
+	@param error [out] the reason the request could not be sent.
+	@return bool false if the request could not be sent.
+*/
+bool send_request(const std::string& path, const std::string& request, std::ostream& out, std::string& error) {
+	stream_socket socket_;
+	if (!socket_.connect(path, error)) return false;
+	if (!socket_.write(request + "\n")) {
+		error = "Cannot send the request to " + path + ".";
+		return false;
+	}
+	socket_.shutdown_write();
+	std::string line;
+	while (socket_.read_line(line)) out << line << std::endl;
+	return true;
+}
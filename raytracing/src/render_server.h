@@ -0,0 +1,104 @@
+/**
+	The render_server class serves render requests on a local socket, for the
+	clients that render many small images of the same assets.
+
+	Scenes stay loaded between requests: they are cached by path, and used while
+	their file and their mesh files have the same content. Meshes are cached on
+	their own, so a scene file that changed only loads the meshes that changed
+	too. See mesh_cache. Every connection is served on its own thread, and the
+	tiles of all the renders run on one thread pool, by priority.
+
+	Requests and responses are lines of words:
+		render scene: <path> output: <file.tif|file.png> [height: <pixels>]
+			[samples: <n>] [budget: <ms>] [priority: <n>] [camera: <x y z>]
+			[fov: <degrees>] [light: <index> <x y z>]...
+			responds "job <id>" once the request is read, then "done <id> <ms> ms",
+			"cancelled <id>" or "error <id> <reason>". camera: moves the camera, and
+			light: moves a light of the scene, for this render only.
+		cancel <id>
+			responds "ok", or "error <reason>" if no render has that id.
+		stats
+			responds with the number of renders, the percentiles of their latency,
+			and the size of the caches.
+		quit
+			responds "ok", and stops the server once the connections are closed.
+	A connection can send several requests, one after the other.
+*/
+#pragma once
+#include "options.h"
+#include "scene.h"
+#include "mesh_cache.h"
+#include "fingerprint.h"
+#include "stream_socket.h"
+#include "thread_pool.h"
+#include "tokenizer.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// the number of latest renders the latency percentiles are computed on.
+#define LATENCY_WINDOW 10000
+
+class raytracer;
+
+class render_server {
+public:
+	render_server(const options& options_);
+	bool run(const std::string& path, std::string& error);
+
+private:
+	/**
+		The job struct holds a render request while it is served.
+	*/
+	struct job {
+		raytracer* m_raytracer = nullptr; // set while the job renders.
+		bool m_cancelled = false;
+	};
+
+	/**
+		The cached_scene struct holds a loaded scene and the fingerprints of its
+		scene file and mesh files. m_mutex is held while the scene is checked or
+		loaded, so that the requests for other scenes do not wait.
+	*/
+	struct cached_scene {
+		std::mutex m_mutex;
+		std::vector<file_fingerprint> m_files;
+		std::shared_ptr<scene> m_scene; // nullptr until the scene is loaded.
+	};
+
+	void serve(stream_socket client);
+	bool handle(const std::string& request, stream_socket& client);
+	void render(tokenizer& tokenizer_, stream_socket& client);
+	std::shared_ptr<scene> get_scene(const std::string& path, std::string& error);
+	bool load_scene(const std::string& path, cached_scene& cached, std::string& error);
+	bool cancel(uint64_t id);
+	std::string stats();
+
+	options m_options;
+	thread_pool m_pool;
+	mesh_cache m_meshes;
+	std::string m_path;
+	std::atomic<bool> m_stop;
+
+	std::mutex m_scenes_mutex;
+	std::map<std::string, std::shared_ptr<cached_scene>> m_scenes; // the scenes by path, loaded or loading.
+	std::atomic<unsigned long long> m_scene_hits;
+	std::atomic<unsigned long long> m_scene_misses;
+
+	std::mutex m_jobs_mutex;
+	std::map<uint64_t, std::shared_ptr<job>> m_jobs; // the jobs being served by id.
+	uint64_t m_next_job = 1;
+	unsigned long long m_render_count = 0;
+	std::deque<double> m_latencies; // the latency of the latest renders in ms.
+	unsigned int m_connections = 0;
+	std::condition_variable m_connection_closed;
+};
+
+bool send_request(const std::string& path, const std::string& request, std::ostream& out, std::string& error);
@@ -0,0 +1,217 @@
+#include "render_stats.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+namespace {
+
+const char* const SHAPE_TYPE_NAMES[SHAPE_TYPE_COUNT] = { "plane", "sphere", "triangle", "mesh" };
+const char* const PHASE_NAMES[RENDER_PHASE_COUNT] = { "parse", "mesh_load", "normals", "acceleration", "trace", "write" };
+
+/**
+	@param part the part.
+	@param whole the whole.
+	@return double the percentage of whole that part is, 0 if whole is 0.
+*/
+double percent(uint64_t part, uint64_t whole) {
+	return whole ? part * 100. / whole : 0.;
+}
+
+}
+
+/**
+	Adds the counters of stats. The phases are ignored.
+
+	@param stats the statistics, usually of a pixel.
+*/
+void render_stats::add(const render_stats& stats) {
+	m_primary_rays += stats.m_primary_rays;
+	m_shadow_rays += stats.m_shadow_rays;
+	m_hits += stats.m_hits;
+	for (size_t i = 0; i < SHAPE_TYPE_COUNT; i++) {
+		m_tests[i] += stats.m_tests[i];
+	}
+	m_intersect_cycles += stats.m_intersect_cycles;
+	m_shade_cycles += stats.m_shade_cycles;
+}
+
+/**
+	Sets the counters to 0. The phases and the shape costs are kept.
+*/
+void render_stats::clear() {
+	shape_cost* shape_costs = m_shape_costs;
+	*this = render_stats();
+	m_shape_costs = shape_costs;
+}
+
+/**
+	Adds the counts of another cost of the same shape.
+
+	@param cost the cost, usually of a tile.
+*/
+void shape_cost::add(const shape_cost& cost) {
+	m_rays += cost.m_rays;
+	m_tests += cost.m_tests;
+	m_cycles += cost.m_cycles;
+}
+
+/**
+	Prints the costs of the shapes, the most expensive first.
+
+	@param out the stream.
+	@param costs the costs, by index of shape.
+	@param names the names of the shapes, by index.
+*/
+void print_shape_costs(std::ostream& out, const std::vector<shape_cost>& costs, const std::vector<std::string>& names) {
+	std::vector<size_t> ranks(costs.size());
+	uint64_t total_cycles = 0;
+	for (size_t i = 0; i < costs.size(); i++) {
+		ranks[i] = i;
+		total_cycles += costs[i].m_cycles;
+	}
+	std::stable_sort(ranks.begin(), ranks.end(), [&costs](size_t a, size_t b) { return costs[a].m_cycles > costs[b].m_cycles; });
+
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(1);
+	out << "Shape costs, by intersection cycles:" << std::endl;
+	out << std::setw(6) << "rank" << std::setw(7) << "shape" << std::setw(9) << "cycles" << std::setw(16) << "tests"
+		<< std::setw(12) << "tests/ray" << "  name" << std::endl;
+	for (size_t rank = 0; rank < ranks.size(); rank++) {
+		const shape_cost& cost = costs[ranks[rank]];
+		out << std::setw(6) << rank + 1 << std::setw(7) << ranks[rank] << std::setw(8) << percent(cost.m_cycles, total_cycles) << "%"
+			<< std::setw(16) << cost.m_tests << std::setw(12) << cost.m_tests / (double)(cost.m_rays ? cost.m_rays : 1)
+			<< "  " << names[ranks[rank]] << std::endl;
+	}
+	out.flags(flags);
+	out.precision(precision);
+}
+
+/**
+	Prints a summary of the statistics.
+
+	@param out the stream.
+	@param pixels the number of pixels of the image.
+*/
+void render_stats::print(std::ostream& out, uint64_t pixels) const {
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(1);
+
+	out << "Render statistics:" << std::endl;
+#if RENDER_STATS
+	double trace_ms = m_phase_ms[(size_t)render_phase::trace];
+	out << "  rays: " << m_primary_rays << " primary, " << m_shadow_rays << " shadow, "
+		<< m_primary_rays / (double)(pixels ? pixels : 1) << " primary per pixel, "
+		<< percent(m_hits, m_primary_rays) << "% of the primary rays hit a shape";
+	if (trace_ms > 0.) out << ", " << (m_primary_rays + m_shadow_rays) / trace_ms * 1e-3 << " Mrays/s";
+	out << std::endl << "  intersection tests:";
+	for (size_t i = 0; i < SHAPE_TYPE_COUNT; i++) {
+		out << (i ? ", " : " ") << m_tests[i] << " " << SHAPE_TYPE_NAMES[i];
+	}
+	out << " triangles" << std::endl;
+#if RENDER_STATS >= 2
+	out << "  kernel cycles: " << percent(m_intersect_cycles, m_intersect_cycles + m_shade_cycles) << "% intersecting, "
+		<< percent(m_shade_cycles, m_intersect_cycles + m_shade_cycles) << "% shading" << std::endl;
+#endif
+#else
+	(void)pixels;
+	out << "  no counters: built with RENDER_STATS 0" << std::endl;
+#endif
+	out << "  phases:";
+	for (size_t i = 0; i < RENDER_PHASE_COUNT; i++) {
+		out << (i ? ", " : " ") << PHASE_NAMES[i] << " " << m_phase_ms[i] << " ms";
+	}
+	out << std::endl;
+
+	out.flags(flags);
+	out.precision(precision);
+}
+
+/**
+	Saves the statistics as a JSON object.
+
+	@param path the path of the JSON file.
+	@param pixels the number of pixels of the image.
+	@param error [out] the reason the file could not be written.
+	@return bool false on failure.
+*/
+bool render_stats::save_json(const std::string& path, uint64_t pixels, std::string& error) const {
+	std::ofstream file(path);
+	file << "{" << std::endl;
+	file << "  \"counters\": " << (RENDER_STATS ? "true" : "false") << "," << std::endl;
+	file << "  \"pixels\": " << pixels << "," << std::endl;
+	file << "  \"primary_rays\": " << m_primary_rays << "," << std::endl;
+	file << "  \"shadow_rays\": " << m_shadow_rays << "," << std::endl;
+	file << "  \"hits\": " << m_hits << "," << std::endl;
+	file << "  \"tests\": {";
+	for (size_t i = 0; i < SHAPE_TYPE_COUNT; i++) {
+		file << (i ? ", " : " ") << "\"" << SHAPE_TYPE_NAMES[i] << "\": " << m_tests[i];
+	}
+	file << " }," << std::endl;
+	file << "  \"intersect_cycles\": " << m_intersect_cycles << "," << std::endl;
+	file << "  \"shade_cycles\": " << m_shade_cycles << "," << std::endl;
+	file << "  \"phases_ms\": {" << std::fixed << std::setprecision(3);
+	for (size_t i = 0; i < RENDER_PHASE_COUNT; i++) {
+		file << (i ? ", " : " ") << "\"" << PHASE_NAMES[i] << "\": " << m_phase_ms[i];
+	}
+	file << " }" << std::endl << "}" << std::endl;
+	if (!file.flush()) {
+		error = "Cannot write " + path + ".";
+		return false;
+	}
+	return true;
+}
+
+/**
+	Default constructor. The counters start at 0.
+*/
+render_counters::render_counters() {
+	reset();
+}
+
+/**
+	Adds the counters of stats. The phases are ignored.
+
+	@param stats the statistics, usually of a tile.
+*/
+void render_counters::add(const render_stats& stats) {
+	m_primary_rays.fetch_add(stats.m_primary_rays, std::memory_order_relaxed);
+	m_shadow_rays.fetch_add(stats.m_shadow_rays, std::memory_order_relaxed);
+	m_hits.fetch_add(stats.m_hits, std::memory_order_relaxed);
+	for (size_t i = 0; i < SHAPE_TYPE_COUNT; i++) {
+		m_tests[i].fetch_add(stats.m_tests[i], std::memory_order_relaxed);
+	}
+	m_intersect_cycles.fetch_add(stats.m_intersect_cycles, std::memory_order_relaxed);
+	m_shade_cycles.fetch_add(stats.m_shade_cycles, std::memory_order_relaxed);
+}
+
+/**
+	Sets the counters to 0.
+*/
+void render_counters::reset() {
+	m_primary_rays = 0;
+	m_shadow_rays = 0;
+	m_hits = 0;
+	for (std::atomic<uint64_t>& tests : m_tests) {
+		tests = 0;
+	}
+	m_intersect_cycles = 0;
+	m_shade_cycles = 0;
+}
+
+/**
+	@return render_stats the sums of the counters, without phases.
+*/
+render_stats render_counters::get() const {
+	render_stats stats;
+	stats.m_primary_rays = m_primary_rays;
+	stats.m_shadow_rays = m_shadow_rays;
+	stats.m_hits = m_hits;
+	for (size_t i = 0; i < SHAPE_TYPE_COUNT; i++) {
+		stats.m_tests[i] = m_tests[i];
+	}
+	stats.m_intersect_cycles = m_intersect_cycles;
+	stats.m_shade_cycles = m_shade_cycles;
+	return stats;
+}
@@ -0,0 +1,96 @@
+/**
+	The render_stats struct counts the work of a render: the primary and shadow
+	rays, the intersection tests by shape type, the hits, and the cycles the
+	kernels spent intersecting and shading. It also holds the time of the phases
+	of the render, from loading the scene to writing the image.
+
+	The kernels count into a render_stats of the tile they trace, so the threads
+	share nothing, and the raytracer adds it to its render_counters once the tile
+	is done, without locks. See raytracer::report().
+
+	When profiling the shapes, the kernels also count the rays, the tests and the
+	cycles of every shape, in the shape_cost array of the tile.
+
+	Building with RENDER_STATS 0 removes the counting from the kernels: only the
+	phases are timed. The cycles are only read with RENDER_STATS 2, as rdtsc in
+	every packet slows down a render by a fourth on some virtual machines.
+*/
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 1 to count the work of the kernels, 2 to also count their cycles, 0 to remove the counters.
+#ifndef RENDER_STATS
+#define RENDER_STATS 1
+#endif
+
+// the number of values of shape_type.
+#define SHAPE_TYPE_COUNT 4
+
+/**
+	The phases of a render. The phases of loading the scene are summed over the
+	threads that ran them.
+*/
+enum class render_phase {
+	parse,
+	mesh_load,
+	normals,
+	acceleration, // the triangle records of the meshes.
+	trace,
+	write,
+	count
+};
+
+#define RENDER_PHASE_COUNT ((size_t)render_phase::count)
+
+/**
+	The cost of a shape of the scene, see raytracer::report().
+*/
+struct shape_cost {
+	uint64_t m_rays = 0; // the primary and shadow rays tested against the shape.
+	uint64_t m_tests = 0; // the ray-shape tests, one per triangle of a mesh.
+	uint64_t m_cycles = 0; // the cycles spent intersecting the shape.
+
+	void add(const shape_cost& cost);
+};
+
+struct render_stats {
+	uint64_t m_primary_rays = 0;
+	uint64_t m_shadow_rays = 0;
+	uint64_t m_hits = 0; // the primary rays that hit a shape.
+	uint64_t m_tests[SHAPE_TYPE_COUNT] = {}; // the ray-shape tests by shape_type, one per triangle of a mesh.
+	uint64_t m_intersect_cycles = 0;
+	uint64_t m_shade_cycles = 0;
+	double m_phase_ms[RENDER_PHASE_COUNT] = {};
+	// the costs of the shapes, by index in scene::m_shapes, nullptr not to count them. Not owned.
+	shape_cost* m_shape_costs = nullptr;
+
+	void add(const render_stats& stats);
+	void clear();
+	void print(std::ostream& out, uint64_t pixels) const;
+	bool save_json(const std::string& path, uint64_t pixels, std::string& error) const;
+};
+
+void print_shape_costs(std::ostream& out, const std::vector<shape_cost>& costs, const std::vector<std::string>& names);
+
+/**
+	The render_counters class sums the counters of render_stats from any thread.
+*/
+class render_counters {
+public:
+	render_counters();
+	void add(const render_stats& stats);
+	void reset();
+	render_stats get() const;
+
+private:
+	std::atomic<uint64_t> m_primary_rays;
+	std::atomic<uint64_t> m_shadow_rays;
+	std::atomic<uint64_t> m_hits;
+	std::atomic<uint64_t> m_tests[SHAPE_TYPE_COUNT];
+	std::atomic<uint64_t> m_intersect_cycles;
+	std::atomic<uint64_t> m_shade_cycles;
+};
@@ -0,0 +1,289 @@
+#include "render_worker.h"
+#include "raytracer.h"
+#include "screen.h"
+#include "tokenizer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+/**
+	Creates a directory, if it does not exist.
+
+	@param path the path of the directory.
+*/
+void make_directory(const std::string& path) {
+#ifdef _WIN32
+	_mkdir(path.c_str());
+#else
+	mkdir(path.c_str(), 0755);
+#endif
+}
+
+/**
+	@return std::string the temporary directory, with a separator at the end.
+*/
+std::string get_temporary_directory() {
+#ifdef _WIN32
+	const char* directory = std::getenv("TEMP");
+	return std::string(directory ? directory : ".") + "\\";
+#else
+	const char* directory = std::getenv("TMPDIR");
+	return std::string(directory && *directory ? directory : "/tmp") + "/";
+#endif
+}
+
+/**
+	Tells if a file name sent by a coordinator stays in the directory of the
+	scene: relative, and without "..".
+
+	@param name the name of the file.
+	@return bool true if the name is safe to write.
+*/
+bool is_relative_name(const std::string& name) {
+	if (name.empty() || name[0] == '/' || name[0] == '\\' || name.find(':') != std::string::npos) return false;
+	for (size_t begin = 0; begin <= name.size();) {
+		size_t end = std::min(name.find_first_of("/\\", begin), name.size());
+		if (name.compare(begin, end - begin, "..") == 0) return false;
+		begin = end + 1;
+	}
+	return true;
+}
+
+}
+
+/**
+	Parameterized constructor.
+
+	@param options_ the options of the renders. The coordinator gives the
+	triangle algorithm, the image height, the tile size and the pixel format.
+*/
+render_worker::render_worker(const options& options_) : m_options(options_), m_pool(options_.m_threads) {}
+
+/**
+	Serves the coordinators that connect to the port, each on its own thread.
+	Only returns if the port cannot be listened on.
+
+	@param port the TCP port.
+	@param error [out] the reason the worker could not start.
+	@return bool false if the worker could not start.
+*/
+bool render_worker::run(uint16_t port, std::string& error) {
+	stream_socket listener;
+	if (!listener.listen_tcp(port, error)) return false;
+	m_directory = get_temporary_directory() + "raytracing-worker-" + std::to_string(port);
+	make_directory(m_directory);
+	std::cout << "Rendering tiles on port " << port << " with " << m_pool.thread_count() << " threads." << std::endl;
+
+	while (true) {
+		stream_socket coordinator = listener.accept();
+		coordinator.set_timeout(COORDINATOR_TIMEOUT);
+		if (coordinator.is_open()) std::thread(&render_worker::serve, this, std::move(coordinator)).detach();
+	}
+}
+
+/**
+	Serves the requests of a coordinator until it closes the connection.
+
+	@param coordinator the connection.
+*/
+void render_worker::serve(stream_socket coordinator) {
+	std::shared_ptr<scene> scene_;
+	std::unique_ptr<screen> screen_;
+	std::unique_ptr<raytracer> raytracer_;
+	unsigned int seed = 0;
+	std::mutex write_mutex;
+	std::atomic<bool> closed(false);
+	task_group tasks(m_pool); // destroyed first, so the tiles are done before the raytracer is.
+	std::string line, error;
+
+	while (error.empty() && coordinator.read_line(line)) {
+		tokenizer tokenizer_(line.data(), line.data() + line.size());
+		std::string hash, algorithm_name, scene_file, format_name;
+		triangle_algorithm algorithm;
+		float height;
+		long long tile_size, number;
+		options options_ = m_options;
+
+		if (tokenizer_.read_keyword("tile")) {
+			if (!raytracer_) error = "no frame";
+			else if (!tokenizer_.read_int(number) || number < 0 || (uint64_t)number >= raytracer_->tile_count()) error = "invalid tile";
+			else tasks.submit([&, number] {
+				if (closed) return;
+				tile tile_ = raytracer_->render_tile((uint64_t)number, seed);
+				size_t row_size = tile_.m_width * tile_.m_pixels.pixel_size();
+				std::string response = "tile " + std::to_string(number) + " " + std::to_string(row_size * tile_.m_height) + "\n";
+				size_t header_size = response.size();
+				response.resize(header_size + row_size * tile_.m_height);
+				for (uint32_t y = 0; y < tile_.m_height; y++) {
+					std::memcpy(&response[header_size + y * row_size], tile_.m_pixels.row(y), row_size);
+				}
+				std::lock_guard<std::mutex> lock(write_mutex);
+				if (!closed && !coordinator.write(response)) closed = true;
+			});
+			continue;
+		}
+
+		// the scene and the frame change once the tiles of the previous frame are done.
+		tasks.wait();
+		std::string response;
+		if (tokenizer_.read_keyword("scene")) {
+			if (!tokenizer_.read_word(hash) || !tokenizer_.read_word(algorithm_name) || !from_string(algorithm_name, algorithm)
+				|| !tokenizer_.read_word(scene_file)) {
+				error = "invalid scene";
+			}
+			else {
+				raytracer_.reset();
+				screen_.reset();
+				scene_ = get_scene(coordinator, hash, algorithm, scene_file, error);
+				if (scene_) response = "ready " + std::to_string(m_pool.thread_count());
+			}
+		}
+		else if (tokenizer_.read_keyword("frame")) {
+			if (!scene_) error = "no scene";
+			else if (!tokenizer_.read_float(height) || !(height >= 1.f && height <= (float)(1 << 20)) || !tokenizer_.read_int(tile_size) || tile_size < 16
+				|| tile_size % 16 != 0 || tile_size > 1 << 16 || !tokenizer_.read_word(format_name) || !from_string(format_name, options_.m_format)
+				|| !tokenizer_.read_int(number) || number < 0) {
+				error = "invalid frame";
+			}
+			else {
+				options_.m_height = (unsigned int)height;
+				options_.m_tile_size = (unsigned int)tile_size;
+				seed = (unsigned int)number;
+				raytracer_.reset();
+				screen_.reset(new screen(*scene_->m_camera, height));
+				raytracer_.reset(new raytracer(*scene_, *screen_, options_, &m_pool));
+				response = "ok " + std::to_string(raytracer_->width()) + " " + std::to_string(raytracer_->height());
+			}
+		}
+		else error = "unknown request \"" + tokenizer_.peek_word() + "\"";
+
+		std::lock_guard<std::mutex> lock(write_mutex);
+		if (error.empty() && !coordinator.write(response + "\n")) break;
+	}
+
+	if (!error.empty()) {
+		std::cout << "Coordinator request failed: " << error << "." << std::endl;
+		std::lock_guard<std::mutex> lock(write_mutex);
+		coordinator.write("error " + error + "\n");
+	}
+	closed = true;
+	tasks.wait();
+}
+
+/**
+	Finds a scene by the hash of its content, or receives its files from the
+	coordinator and loads it.
+
+	m_mutex is only held to find the entries of the scene and of its files. The
+	scene is loaded under the lock of its entry, and its files are received under
+	the lock of theirs, so that coordinators that send the same scene load it once,
+	and a coordinator that stalls while it sends its files only holds up the
+	coordinators of the same scene, until COORDINATOR_TIMEOUT.
+
+	@param coordinator the connection.
+	@param hash the content hash of the scene and mesh files.
+	@param algorithm the triangle intersection algorithm of the meshes.
+	@param scene_file the name of the scene file.
+	@param error [out] the reason the scene could not be loaded.
+	@return std::shared_ptr<scene> the scene, or nullptr on failure.
+*/
+std::shared_ptr<scene> render_worker::get_scene(stream_socket& coordinator, const std::string& hash,
+	triangle_algorithm algorithm, const std::string& scene_file, std::string& error) {
+	if (!is_relative_name(hash) || !is_relative_name(scene_file)) {
+		error = "invalid scene";
+		return nullptr;
+	}
+	std::shared_ptr<cached_scene> cached;
+	std::shared_ptr<scene_files> files;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::shared_ptr<cached_scene>& scene_entry = m_scenes[std::make_pair(hash, algorithm)];
+		if (!scene_entry) scene_entry = std::make_shared<cached_scene>();
+		cached = scene_entry;
+		std::shared_ptr<scene_files>& files_entry = m_files[hash];
+		if (!files_entry) files_entry = std::make_shared<scene_files>();
+		files = files_entry;
+	}
+
+	std::lock_guard<std::mutex> lock(cached->m_mutex);
+	if (cached->m_scene) return cached->m_scene;
+
+	std::string directory = m_directory + "/" + hash;
+	{
+		std::lock_guard<std::mutex> files_lock(files->m_mutex);
+		if (!files->m_received) {
+			if (!coordinator.write("need\n") || !receive_files(coordinator, directory, error)) {
+				if (error.empty()) error = "the coordinator is gone";
+				return nullptr;
+			}
+			files->m_received = true;
+		}
+	}
+
+	options options_ = m_options;
+	options_.m_triangle_algorithm = algorithm;
+	std::shared_ptr<scene> scene_ = std::make_shared<scene>(directory + "/" + scene_file, options_, &m_meshes);
+	if (!scene_->is_loaded()) {
+		error = scene_->load_error();
+		return nullptr;
+	}
+	cached->m_scene = scene_;
+	return scene_;
+}
+
+/**
+	Receives the files of a scene, see render_worker, and writes them to a
+	directory.
+
+	@param coordinator the connection.
+	@param directory the directory of the scene.
+	@param error [out] the reason the files could not be received.
+	@return bool false on failure.
+*/
+bool render_worker::receive_files(stream_socket& coordinator, const std::string& directory, std::string& error) {
+	make_directory(directory);
+	std::string line;
+	std::vector<char> buffer(1 << 20);
+	while (coordinator.read_line(line)) {
+		tokenizer tokenizer_(line.data(), line.data() + line.size());
+		std::string name;
+		long long size;
+		if (tokenizer_.read_keyword("end")) return true;
+		if (!tokenizer_.read_keyword("file") || !tokenizer_.read_word(name) || !is_relative_name(name)
+			|| !tokenizer_.read_int(size) || size < 0) {
+			error = "invalid file";
+			return false;
+		}
+
+		// creates the directories of the name.
+		for (size_t separator = name.find_first_of("/\\"); separator != std::string::npos;
+			separator = name.find_first_of("/\\", separator + 1)) {
+			make_directory(directory + "/" + name.substr(0, separator));
+		}
+		std::string path = directory + "/" + name;
+		std::ofstream file(path, std::ios::binary);
+		for (long long written = 0; written < size;) {
+			size_t count = (size_t)std::min<long long>(size - written, (long long)buffer.size());
+			if (!coordinator.read(buffer.data(), count)) return false;
+			file.write(buffer.data(), count);
+			written += count;
+		}
+		if (!file) {
+			error = "cannot write " + path;
+			return false;
+		}
+	}
+	return false;
+}
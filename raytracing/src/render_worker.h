@@ -0,0 +1,82 @@
+/**
+	The render_worker class renders tiles for coordinators, to split the render of
+	an image across processes and machines. See render_coordinator.
+
+	A coordinator connects to the TCP port of the worker, and sends the scene and
+	the frame, then the tiles to render. Requests and responses are lines:
+		scene <hash> <triangle algorithm> <scene file>
+			responds "ready <threads>" if the scene with that content hash is loaded,
+			or "need". After "need", the coordinator sends the scene file and its mesh
+			files, each as "file <name> <size>" and the bytes of the file, then "end".
+			The names are relative to the directory of the scene file. The worker
+			responds "ready <threads>" once the scene is loaded.
+		frame <height> <tile size> <format> <seed>
+			responds "ok <width> <height>", the size of the image. The height is the
+			one of the screen of the coordinator, which may have a fraction when it
+			is given by the camera, so that the rays are the same. See screen.
+		tile <index>
+			responds "tile <index> <size>" and the pixels of the tile, row after row
+			in the format of the frame. Tiles are rendered concurrently, and their
+			responses come in the order they are done.
+	Errors are responded as "error <reason>", and close the connection, and so
+	does a coordinator that sends nothing for COORDINATOR_TIMEOUT ms.
+
+	The files of the scenes are written to a directory of the temporary
+	directory, and the scenes stay loaded while the worker runs. A scene is
+	received and loaded under a lock of its own, so the coordinators of other
+	scenes do not wait.
+*/
+#pragma once
+#include "options.h"
+#include "scene.h"
+#include "mesh_cache.h"
+#include "stream_socket.h"
+#include "thread_pool.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// the time a coordinator has to send a request or the bytes of a file, in ms, see WORKER_TIMEOUT.
+#define COORDINATOR_TIMEOUT 60000
+
+class render_worker {
+public:
+	render_worker(const options& options_);
+	bool run(uint16_t port, std::string& error);
+
+private:
+	/**
+		The cached_scene struct holds a scene loaded for a content hash and a
+		triangle algorithm. m_mutex is held while the scene is loaded.
+	*/
+	struct cached_scene {
+		std::mutex m_mutex;
+		std::shared_ptr<scene> m_scene; // nullptr until the scene is loaded.
+	};
+
+	/**
+		The scene_files struct tells if the files of a content hash were received.
+		m_mutex is held while they are received.
+	*/
+	struct scene_files {
+		std::mutex m_mutex;
+		bool m_received = false;
+	};
+
+	void serve(stream_socket coordinator);
+	std::shared_ptr<scene> get_scene(stream_socket& coordinator, const std::string& hash,
+		triangle_algorithm algorithm, const std::string& scene_file, std::string& error);
+	bool receive_files(stream_socket& coordinator, const std::string& directory, std::string& error);
+
+	options m_options;
+	thread_pool m_pool;
+	mesh_cache m_meshes;
+	std::string m_directory; // the directory the files of the scenes are written to.
+
+	std::mutex m_mutex; // only held to find the entries of m_scenes and m_files.
+	std::map<std::pair<std::string, triangle_algorithm>, std::shared_ptr<cached_scene>> m_scenes; // the scenes by content hash.
+	std::map<std::string, std::shared_ptr<scene_files>> m_files; // the files of the scenes by content hash.
+};
@@ -0,0 +1,46 @@
+/**
+	The anti-aliasing offsets of the samples, as counter-based random numbers:
+	the offset of a sample is a hash of the seed of the render, of the pixel and
+	of the index of the sample. It does not depend on the tile size, on the
+	thread that traces the sample, or on the order of the samples. The kernels
+	sum the colors of the samples in their order at every packet width and
+	instruction set level, so a render with a given seed is the same image with
+	any number of threads, on any number of machines and CPUs, and when it is
+	resumed. See raytracer::render_tile().
+*/
+#pragma once
+#include <cstdint>
+
+/**
+	Mixes the bits of a value: the output permutation of PCG, used as a hash
+	("Hash Functions for GPU Rendering", Jarzynski and Olano, 2020).
+
+	@param value the value.
+	@return uint32_t the hash of the value.
+*/
+inline uint32_t pcg_hash(uint32_t value) {
+	uint32_t state = value * 747796405u + 2891336453u;
+	uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+/**
+	@param seed the seed of the render.
+	@param x the column of the pixel.
+	@param y the row of the pixel.
+	@return uint32_t the key of the samples of the pixel, see sample_offset().
+*/
+inline uint32_t pixel_key(uint32_t seed, uint32_t x, uint32_t y) {
+	return pcg_hash(seed ^ pcg_hash(x ^ pcg_hash(y)));
+}
+
+/**
+	@param key the key of the pixel, see pixel_key().
+	@param sample the index of the sample of the pixel.
+	@return float the offset of the sample in [0, 1), with 24 random bits.
+*/
+inline float sample_offset(uint32_t key, uint32_t sample) {
+	// the multiplication by an odd constant spreads the indices of the samples over all bits.
+	uint32_t hash = pcg_hash(key ^ (sample * 0x9e3779b9u));
+	return (float)(hash >> 8) * (1.f / 16777216.f);
+}
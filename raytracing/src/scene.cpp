@@ -1,41 +1,327 @@
 #include "scene.h"
 #include "glm/glm/glm.hpp"
-#include <fstream>
+#include "thread_pool.h"
+#include "mapped_file.h"
+#include "fingerprint.h"
+#include "event_trace.h"
+#include <algorithm>
+#include <atomic>
 #include <string>
+#include <iomanip>
 #include <iostream>
 
+// the fewest characters of an object, e.g. "sphere" and its attributes, and of
+// a sphere of a block, "0 0 0 1" and its separator.
+#define SCENE_MIN_OBJECT_SIZE 8
+#define SCENE_MIN_BLOCK_SPHERE_SIZE 8
+
 /**
-	Default constructor.
+	Parameterized constructor.
+
+	Asks for the scene file path and loads the scene from the file. See load().
+	Exits at the end of the input.
 
-	Asks for the scene file path and saved the information parsed from the file.
+	@param options_ the command line options.
 */
-scene::scene() {
+scene::scene(const options& options_) : m_triangle_algorithm(options_.m_triangle_algorithm), m_thread_count(options_.m_threads) {
 	std::cout << std::endl << "Scene file path (absolute path only): ";
 	std::string scene_file;
-	std::getline(std::cin, scene_file);
-
-	std::ifstream file(scene_file);
+	if (!std::getline(std::cin, scene_file)) exit(EXIT_SUCCESS);
 
-	while (!file) {
+	while (!mapped_file(scene_file.c_str()).is_open()) {
 		std::cout << "Incorrect path. Try again." << std::endl;
 		std::cout << std::endl << "Scene file path (absolute path only): ";
-		std::getline(std::cin, scene_file);
-		file.open(scene_file);
+		if (!std::getline(std::cin, scene_file)) exit(EXIT_SUCCESS);
 	}
-	
+	load(scene_file);
+	if (!is_loaded()) {
+		std::cerr << m_error << std::endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+/**
+	Parameterized constructor.
+
+	Loads the scene from scene_file. See load(). The scene may not be loaded, see
+	is_loaded().
+
+	@param scene_file the path of the scene file.
+	@param options_ the command line options.
+	@param cache [optional] the cache the meshes are shared through.
+*/
+scene::scene(const std::string& scene_file, const options& options_, mesh_cache* cache)
+	:
+	m_triangle_algorithm(options_.m_triangle_algorithm),
+	m_thread_count(options_.m_threads),
+	m_mesh_cache(cache)
+{
+	load(scene_file);
+}
+
+/**
+	Maps the scene file in memory and saves the information parsed from it. The
+	meshes are loaded once the whole file is parsed, see load_meshes(), and the
+	time every loading task took is logged and kept in m_load_timeline. On failure,
+	the reason is saved in m_error.
+
+	@param scene_file the path of the scene file.
+*/
+void scene::load(const std::string& scene_file) {
 	set_directory(scene_file);
+	m_file_name = scene_file.substr(m_directory.size());
+	timeline& timeline_ = m_load_timeline;
+	timeline_.restart();
+
+	mapped_file file(scene_file.c_str());
+	if (!file.is_open()) {
+		m_error = "Cannot open " + scene_file + ".";
+		return;
+	}
+	tokenizer tokenizer_(file.data(), file.data() + file.size());
+	try {
+		scoped_event event("parse", "load", -1, &m_file_name);
+		parse(tokenizer_);
+	}
+	catch (const load_failure&) {
+		return;
+	}
+	timeline_.add(m_file_name + " parse", 0., timeline_.now());
+
+	load_meshes(timeline_);
+	if (!is_loaded()) return;
+
+	std::ios::fmtflags flags = std::cout.flags();
+	std::streamsize precision = std::cout.precision();
+	std::cout << "Scene loaded in " << std::fixed << std::setprecision(1) << timeline_.now() << " ms:" << std::endl;
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+	timeline_.print(std::cout);
+}
+
+/**
+	Parses the objects of the scene file.
+
+	The file starts with the number of objects, which is used to reserve the
+	shapes, and is an error if the rest of the file cannot hold that many. Every
+	object starts with its type: camera, light, plane, sphere, mesh, or spheres
+	for a block of spheres. See init_spheres(). The keys of an animation follow
+	the object they move, see init_keys().
+
+	@param tokenizer_ the tokenizer over the scene file.
+*/
+void scene::parse(tokenizer& tokenizer_) {
+	long long count;
+	if (!tokenizer_.read_int(count) || count < 0) error(tokenizer_, "expected the number of objects");
+	if ((unsigned long long)count > tokenizer_.remaining() / SCENE_MIN_OBJECT_SIZE) error(tokenizer_, "more objects than the file holds");
+	m_shapes.reserve((size_t)count);
+
+	track previous; // the object the next keys move.
+	while (!tokenizer_.at_end()) {
+		track::target target = track::target::none;
+		if (tokenizer_.read_keyword("keys")) {
+			init_keys(tokenizer_, previous);
+			target = previous.m_target;
+		}
+		else if (tokenizer_.read_keyword("camera")) {
+			init_camera(tokenizer_);
+			target = track::target::camera;
+		}
+		else if (tokenizer_.read_keyword("light")) {
+			init_light(tokenizer_);
+			target = track::target::light;
+		}
+		else if (tokenizer_.read_keyword("plane")) {
+			init_plane(tokenizer_);
+			target = track::target::shape;
+		}
+		else if (tokenizer_.read_keyword("sphere")) {
+			init_sphere(tokenizer_);
+			target = track::target::shape;
+		}
+		else if (tokenizer_.read_keyword("spheres")) init_spheres(tokenizer_);
+		else if (tokenizer_.read_keyword("mesh")) init_mesh(tokenizer_);
+		else error(tokenizer_, "unknown object \"" + tokenizer_.peek_word() + "\"");
+
+		previous.m_target = target;
+		if (target == track::target::light) previous.m_index = m_lights.size() - 1;
+		if (target == track::target::shape) previous.m_index = m_shapes.size() - 1;
+	}
+	if (!m_camera) error(tokenizer_, "no camera");
+}
+
+/**
+	Saves a parsing error with its line in m_error, and stops parsing.
+
+	@param tokenizer_ the tokenizer, at the line of the error.
+	@param message the error.
+*/
+void scene::error(const tokenizer& tokenizer_, const std::string& message) {
+	m_error = m_file_name + ":" + std::to_string(tokenizer_.line()) + ": " + message + ".";
+	throw load_failure();
+}
+
+/**
+	Reads an attribute that is a vector, e.g. "pos: 0 1 2".
+
+	@param tokenizer_ the tokenizer over the scene file.
+	@param attribute the name of the attribute, with its colon.
+	@return glm::vec3 the vector.
+*/
+glm::vec3 scene::read_vec3(tokenizer& tokenizer_, const char* attribute) {
+	glm::vec3 value;
+	if (!tokenizer_.read_keyword(attribute) || !tokenizer_.read_vec3(value)) {
+		error(tokenizer_, std::string("expected \"") + attribute + "\" followed by 3 numbers");
+	}
+	return value;
+}
+
+/**
+	Reads an attribute that is a number, e.g. "rad: 10".
+
+	@param tokenizer_ the tokenizer over the scene file.
+	@param attribute the name of the attribute, with its colon.
+	@return float the number.
+*/
+float scene::read_float(tokenizer& tokenizer_, const char* attribute) {
+	float value;
+	if (!tokenizer_.read_keyword(attribute) || !tokenizer_.read_float(value)) {
+		error(tokenizer_, std::string("expected \"") + attribute + "\" followed by a number");
+	}
+	return value;
+}
+
+/**
+	Reads the amb:, dif:, spe: and shi: attributes of a shape.
+
+	@param tokenizer_ the tokenizer over the scene file.
+	@return shape::material the material.
+*/
+shape::material scene::read_material(tokenizer& tokenizer_) {
+	glm::vec3 ambient = read_vec3(tokenizer_, "amb:");
+	glm::vec3 diffuse = read_vec3(tokenizer_, "dif:");
+	glm::vec3 specular = read_vec3(tokenizer_, "spe:");
+	float shi = read_float(tokenizer_, "shi:");
+	return shape::material(ambient, diffuse, specular, shi);
+}
+
+/**
+	@return bool true if the scene was loaded. See load_error().
+*/
+bool scene::is_loaded() const {
+	return m_error.empty();
+}
+
+/**
+	@return const std::string& the reason the scene could not be loaded, empty if
+	it was.
+*/
+const std::string& scene::load_error() const {
+	return m_error;
+}
+
+/**
+	@return bool true if the scene file has keys, see init_keys().
+*/
+bool scene::is_animated() const {
+	return !m_tracks.empty();
+}
+
+/**
+	@return float the frame of the last key of the scene, 0 if it has none.
+*/
+float scene::last_key() const {
+	float last = 0.f;
+	for (const track& track_ : m_tracks) {
+		last = std::max(last, track_.m_frames.back());
+	}
+	return last;
+}
 
-	int count;
-	file >> count;
+/**
+	Moves the objects that have keys to their position at a frame. Objects
+	without keys do not move.
 
-	std::string object_type;
-	while (file >> object_type) {
-		if (object_type == "camera") init_camera(file);
-		else if (object_type == "plane") init_plane(file);
-		else if (object_type == "sphere") init_sphere(file);
-		else if (object_type == "mesh") init_mesh(file);
-		else init_light(file);
+	@param frame the frame, which can be between two frames for motion blur or
+	slow motion.
+	@return std::vector<size_t> the indices of the shapes that moved, in
+	m_shapes. The camera and the lights may have moved too.
+*/
+std::vector<size_t> scene::set_frame(float frame) {
+	std::vector<size_t> moved;
+	for (const track& track_ : m_tracks) {
+		glm::vec3 position = track_.position_at(frame);
+		switch (track_.m_target) {
+		case track::target::camera:
+			m_camera->m_position = position;
+			break;
+		case track::target::light:
+			m_lights[track_.m_index].m_position = position;
+			break;
+		case track::target::shape:
+			if (m_shapes[track_.m_index]->move_to(position)) moved.push_back(track_.m_index);
+			break;
+		default:
+			break;
+		}
 	}
+	return moved;
+}
+
+/**
+	Interpolates the keys of the track, see init_keys().
+
+	Smooth keys are a cubic Hermite spline whose tangent at a key is the slope
+	between its neighbors (Catmull-Rom), scaled to the frames between the keys so
+	that the speed is continuous when the keys are not evenly spaced.
+
+	@param frame the frame.
+	@return glm::vec3 the position at the frame.
+*/
+glm::vec3 scene::track::position_at(float frame) const {
+	if (frame <= m_frames.front()) return m_positions.front();
+	if (frame >= m_frames.back()) return m_positions.back();
+	size_t i = std::upper_bound(m_frames.begin(), m_frames.end(), frame) - m_frames.begin() - 1;
+	float length = m_frames[i + 1] - m_frames[i];
+	float t = (frame - m_frames[i]) / length;
+	const glm::vec3& p0 = m_positions[i];
+	const glm::vec3& p1 = m_positions[i + 1];
+	if (!m_smooth) return glm::mix(p0, p1, t);
+
+	auto slope = [this](size_t key) {
+		size_t before = key > 0 ? key - 1 : key;
+		size_t after = key + 1 < m_frames.size() ? key + 1 : key;
+		return (m_positions[after] - m_positions[before]) / (m_frames[after] - m_frames[before]);
+	};
+	glm::vec3 m0 = slope(i) * length;
+	glm::vec3 m1 = slope(i + 1) * length;
+	float t2 = t * t;
+	float t3 = t2 * t;
+	return (2.f * t3 - 3.f * t2 + 1.f) * p0 + (t3 - 2.f * t2 + t) * m0 + (-2.f * t3 + 3.f * t2) * p1 + (t3 - t2) * m1;
+}
+
+/**
+	@return std::vector<std::string> the paths of the scene file and of the mesh
+	files it uses.
+*/
+std::vector<std::string> scene::files() const {
+	std::vector<std::string> files_ = { m_directory + m_file_name };
+	for (const mesh_task& task : m_mesh_tasks) {
+		files_.push_back(m_directory + task.m_file_name);
+	}
+	return files_;
+}
+
+/**
+	@param index the index of a shape in m_shapes.
+	@return std::string the kind of the shape, followed by its file for a mesh.
+*/
+std::string scene::shape_name(size_t index) const {
+	std::string name = to_string(m_shapes[index]->get_view().m_type);
+	for (const mesh_task& task : m_mesh_tasks) {
+		if (task.m_shape == index) name += " " + task.m_file_name;
+	}
+	return name;
 }
 
 scene::~scene() {
@@ -69,174 +355,279 @@ void scene::set_directory(const std::string& abs_path) {
 }
 
 /**
-	Initializes m_camera.
+	Adds mat to m_materials.
 
-	@param ifstream the reference to the input file stream.
+	@param mat the material to add.
+	@return unsigned int the index of the material in m_materials.
 */
-void scene::init_camera(std::ifstream& ifstream) {
-	std::string attribute;
-	ifstream >> attribute;
-	
-	glm::vec3 position;
-	ifstream >> position.x >> position.y >> position.z;
-
-	ifstream >> attribute;
-
-	float fov;
-	ifstream >> fov;
-
-	ifstream >> attribute;
-
-	float focal_length;
-	ifstream >> focal_length;
+unsigned int scene::add_material(const shape::material& mat) {
+	m_materials.push_back(mat);
+	return (unsigned int)(m_materials.size() - 1);
+}
 
-	ifstream >> attribute;
+/**
+	Initializes m_camera.
 
-	float aspect_ratio;
-	ifstream >> aspect_ratio;
+	@param tokenizer_ the tokenizer over the scene file.
+*/
+void scene::init_camera(tokenizer& tokenizer_) {
+	glm::vec3 position = read_vec3(tokenizer_, "pos:");
+	float fov = read_float(tokenizer_, "fov:");
+	float focal_length = read_float(tokenizer_, "f:");
+	float aspect_ratio = read_float(tokenizer_, "a:");
 
+	delete m_camera;
 	m_camera = new camera(position, fov, focal_length, aspect_ratio);
 }
 
 /**
 	Initializes a plane and adds it to m_shapes.
 
-	@param ifstream the reference to the input file stream.
+	@param tokenizer_ the tokenizer over the scene file.
 */
-void scene::init_plane(std::ifstream& ifstream) {
-	std::string attribute;
-	ifstream >> attribute;
-
-	glm::vec3 normal;
-	ifstream >> normal.x >> normal.y >> normal.z;
-
-	ifstream >> attribute;
-
-	glm::vec3 point;
-	ifstream >> point.x >> point.y >> point.z;
-
-	ifstream >> attribute;
-
-	glm::vec3 ambient;
-	ifstream >> ambient.x >> ambient.y >> ambient.z;
-
-	ifstream >> attribute;
-
-	glm::vec3 diffuse;
-	ifstream >> diffuse.x >> diffuse.y >> diffuse.z;
-
-	ifstream >> attribute;
-
-	glm::vec3 specular;
-	ifstream >> specular.x >> specular.y >> specular.z;
-
-	ifstream >> attribute;
-
-	float shi;
-	ifstream >> shi;
-
-	shape::material mat(ambient, diffuse, specular, shi);
-	m_shapes.push_back(new plane(normal, point, mat));
+void scene::init_plane(tokenizer& tokenizer_) {
+	glm::vec3 normal = read_vec3(tokenizer_, "nor:");
+	glm::vec3 point = read_vec3(tokenizer_, "pos:");
+	shape::material mat = read_material(tokenizer_);
+	m_shapes.push_back(new plane(normal, point, add_material(mat)));
 }
 
 /**
 	Initializes a sphere and adds it to m_shapes.
 
-	@param ifstream the reference to the input file stream.
+	@param tokenizer_ the tokenizer over the scene file.
 */
-void scene::init_sphere(std::ifstream& ifstream) {
-	std::string attribute;
-	ifstream >> attribute;
-
-	glm::vec3 center;
-	ifstream >> center.x >> center.y >> center.z;
-
-	ifstream >> attribute;
+void scene::init_sphere(tokenizer& tokenizer_) {
+	glm::vec3 center = read_vec3(tokenizer_, "pos:");
+	float radius = read_float(tokenizer_, "rad:");
+	shape::material mat = read_material(tokenizer_);
+	m_shapes.push_back(new sphere(center, radius, add_material(mat)));
+}
 
-	float radius;
-	ifstream >> radius;
+/**
+	Initializes a block of spheres that share a material and adds them to m_shapes.
 
-	ifstream >> attribute;
+	The block is the number of spheres and the material, followed by the center
+	and the radius of every sphere, 4 numbers per sphere:
 
-	glm::vec3 ambient;
-	ifstream >> ambient.x >> ambient.y >> ambient.z;
+	spheres 2
+	amb: 0.3 0.8 0.4
+	dif: 0.3 0.8 0.4
+	spe: 0.3 0.8 0.4
+	shi: 1
+	-20 0 -10 10
+	-10 0 -10 10
 
-	ifstream >> attribute;
+	The block counts as one object in the number of objects of the file.
 
-	glm::vec3 diffuse;
-	ifstream >> diffuse.x >> diffuse.y >> diffuse.z;
+	@param tokenizer_ the tokenizer over the scene file.
+*/
+void scene::init_spheres(tokenizer& tokenizer_) {
+	long long count;
+	if (!tokenizer_.read_int(count) || count < 0) error(tokenizer_, "expected the number of spheres");
+	unsigned int mat = add_material(read_material(tokenizer_));
+	if ((unsigned long long)count > tokenizer_.remaining() / SCENE_MIN_BLOCK_SPHERE_SIZE) error(tokenizer_, "more spheres than the file holds");
+
+	m_shapes.reserve(m_shapes.size() + (size_t)count);
+	for (long long i = 0; i < count; i++) {
+		glm::vec3 center;
+		float radius;
+		if (!tokenizer_.read_vec3(center) || !tokenizer_.read_float(radius)) {
+			error(tokenizer_, "expected the center and the radius of sphere " + std::to_string(i + 1) + " of " + std::to_string(count));
+		}
+		m_shapes.push_back(new sphere(center, radius, mat));
+	}
+}
 
-	ifstream >> attribute;
+/**
+	Loads the meshes of m_mesh_tasks as a task graph on a thread pool.
 
-	glm::vec3 specular;
-	ifstream >> specular.x >> specular.y >> specular.z;
+	Every mesh is read first. Its smooth normals and its triangle records only
+	depend on its triangles, so they are then computed concurrently. The last of
+	the two assembles the mesh and releases the triangles. Meshes in the native
+	format are mapped in a single task. Once every task has finished, the meshes
+	take their place in m_shapes, or the first error is saved in m_error.
 
-	ifstream >> attribute;
+	With m_mesh_cache, meshes whose file is cached are not loaded again, and the
+	meshes that are loaded are added to it.
 
-	float shi;
-	ifstream >> shi;
+	@param timeline_ the timeline the tasks are added to.
+*/
+void scene::load_meshes(timeline& timeline_) {
+	/**
+		The mesh_state struct holds a mesh while it is being loaded.
+	*/
+	struct mesh_state {
+		std::vector<glm::vec3> m_positions;
+		std::vector<unsigned int> m_indices;
+		std::vector<glm::vec3> m_normals;
+		mesh* m_mesh = nullptr;
+		std::atomic<int> m_remaining{ 2 }; // the normals and the records.
+		std::string m_error;
+		std::shared_ptr<const mesh> m_cached; // the mesh found in m_mesh_cache.
+		file_fingerprint m_fingerprint; // the file, taken before it is loaded for m_mesh_cache.
+	};
+	std::vector<mesh_state> states(m_mesh_tasks.size());
+	if (states.empty()) return;
+
+	{
+		thread_pool pool(m_thread_count);
+
+		for (size_t i = 0; i < m_mesh_tasks.size(); i++) {
+			pool.submit([this, &pool, &states, &timeline_, i] {
+				const mesh_task& task = m_mesh_tasks[i];
+				mesh_state& state = states[i];
+				std::string path = m_directory + task.m_file_name;
+
+				scoped_event event("mesh load", "load", (int64_t)task.m_shape, &task.m_file_name);
+				double start = timeline_.now();
+				if (m_mesh_cache) {
+					state.m_cached = m_mesh_cache->find(path, m_triangle_algorithm);
+					if (state.m_cached) {
+						timeline_.add(task.m_file_name + " cached", start, timeline_.now());
+						return;
+					}
+					get_fingerprint(path, state.m_fingerprint);
+				}
+				if (mesh::has_extension(path, ".mesh")) {
+					state.m_mesh = new mesh(path.c_str(), task.m_material, m_triangle_algorithm);
+					state.m_error = state.m_mesh->error();
+					timeline_.add(task.m_file_name + " map", start, timeline_.now());
+					return;
+				}
+				if (!mesh::load_triangles(path.c_str(), state.m_positions, state.m_indices, state.m_error)) return;
+				timeline_.add(task.m_file_name + " read", start, timeline_.now());
+
+				// the last of the normals and the records assembles the mesh.
+				auto assemble = [&state, &timeline_, &task] {
+					if (--state.m_remaining > 0) return;
+					scoped_event event("assemble", "load", (int64_t)task.m_shape, &task.m_file_name);
+					double start = timeline_.now();
+					state.m_mesh->set_normals(std::move(state.m_normals));
+					std::vector<glm::vec3>().swap(state.m_positions);
+					std::vector<unsigned int>().swap(state.m_indices);
+					timeline_.add(task.m_file_name + " assemble", start, timeline_.now());
+				};
+
+				pool.submit([&state, &timeline_, &task, assemble] {
+					{
+						scoped_event event("normals", "load", (int64_t)task.m_shape, &task.m_file_name);
+						double start = timeline_.now();
+						state.m_normals = mesh::get_smooth_normals(state.m_positions, state.m_indices);
+						timeline_.add(task.m_file_name + " normals", start, timeline_.now());
+					}
+					assemble();
+				});
+				pool.submit([this, &state, &timeline_, &task, assemble] {
+					{
+						scoped_event event("records", "acceleration", (int64_t)task.m_shape, &task.m_file_name);
+						double start = timeline_.now();
+						state.m_mesh = new mesh(state.m_positions, state.m_indices, task.m_material, m_triangle_algorithm);
+						timeline_.add(task.m_file_name + " records", start, timeline_.now());
+					}
+					assemble();
+				});
+			});
+		}
+		pool.wait();
+	}
 
-	shape::material mat(ambient, diffuse, specular, shi);
-	m_shapes.push_back(new sphere(center, radius, mat));
+	for (size_t i = 0; i < m_mesh_tasks.size(); i++) {
+		const mesh_task& task = m_mesh_tasks[i];
+		mesh_state& state = states[i];
+		if (!state.m_error.empty()) {
+			if (m_error.empty()) m_error = state.m_error;
+			delete state.m_mesh;
+			continue;
+		}
+
+		// meshes of the cache are shared: the scene uses them with its material.
+		mesh* mesh_ = state.m_mesh;
+		if (m_mesh_cache) {
+			if (!state.m_cached) {
+				state.m_cached.reset(mesh_);
+				m_mesh_cache->insert(state.m_fingerprint, m_triangle_algorithm, state.m_cached);
+			}
+			mesh_ = new mesh(state.m_cached, task.m_material);
+		}
+		m_shapes[task.m_shape] = mesh_;
+	}
+	if (!is_loaded()) return;
+
+	for (size_t i = 0; i < m_mesh_tasks.size(); i++) {
+		const mesh_task& task = m_mesh_tasks[i];
+		const mesh* mesh_ = m_mesh_cache ? states[i].m_cached.get() : states[i].m_mesh;
+		std::cout << task.m_file_name << ": " << mesh_->triangle_count() << " triangles, "
+			<< mesh_->memory_usage() / 1024 << " KB";
+		if (mesh_->mapped_memory()) std::cout << " + " << mesh_->mapped_memory() / 1024 << " KB mapped";
+		if (m_mesh_cache) std::cout << ", shared";
+		std::cout << " (" << to_string(m_triangle_algorithm) << ")" << std::endl;
+	}
 }
 
 /**
-	Initializes a mesh and adds it to m_shapes.
+	Reads a mesh and reserves its place in m_shapes. The mesh is loaded later,
+	see load_meshes().
 
-	@param ifstream the reference to the input file stream.
+	@param tokenizer_ the tokenizer over the scene file.
 */
-void scene::init_mesh(std::ifstream& ifstream) {
-	std::string attribute;
-	ifstream >> attribute;
-
+void scene::init_mesh(tokenizer& tokenizer_) {
 	std::string file_name;
-	ifstream >> file_name;
-
-	ifstream >> attribute;
+	if (!tokenizer_.read_keyword("file:") || !tokenizer_.read_word(file_name)) error(tokenizer_, "expected \"file:\" followed by a file name");
+	shape::material mat = read_material(tokenizer_);
 
-	glm::vec3 ambient;
-	ifstream >> ambient.x >> ambient.y >> ambient.z;
-
-	ifstream >> attribute;
-
-	glm::vec3 diffuse;
-	ifstream >> diffuse.x >> diffuse.y >> diffuse.z;
+	m_mesh_tasks.push_back({ file_name, add_material(mat), m_shapes.size() });
+	m_shapes.push_back(nullptr);
+}
 
-	ifstream >> attribute;
+/**
+	Initializes the keys of the position of the previous object, a camera, a
+	light, a plane or a sphere, and adds them to m_tracks.
 
-	glm::vec3 specular;
-	ifstream >> specular.x >> specular.y >> specular.z;
+	The keys are their number, linear or smooth, then the frame and the position
+	of every key, 4 numbers per key, by increasing frame:
 
-	ifstream >> attribute;
+	keys 3 smooth
+	0 0 2 10
+	24 0 4 0
+	48 0 2 -10
 
-	float shi;
-	ifstream >> shi;
+	Between two keys, linear keys move the object in a straight line, and smooth
+	keys on a Catmull-Rom spline through the keys. Before the first key and after
+	the last one, the object stays at the position of the key.
 
-	shape::material mat(ambient, diffuse, specular, shi);
-	m_shapes.push_back(new mesh((m_directory + file_name).c_str(), mat));
+	@param tokenizer_ the tokenizer over the scene file.
+	@param previous the object the keys move, with no target if it cannot move.
+*/
+void scene::init_keys(tokenizer& tokenizer_, const track& previous) {
+	if (previous.m_target == track::target::none) error(tokenizer_, "keys must follow a camera, a light, a plane or a sphere");
+	long long count;
+	if (!tokenizer_.read_int(count) || count < 1) error(tokenizer_, "expected the number of keys");
+	track track_ = previous;
+	if (tokenizer_.read_keyword("smooth")) track_.m_smooth = true;
+	else if (!tokenizer_.read_keyword("linear")) error(tokenizer_, "expected \"linear\" or \"smooth\"");
+
+	for (long long i = 0; i < count; i++) {
+		float frame;
+		glm::vec3 position;
+		if (!tokenizer_.read_float(frame) || !tokenizer_.read_vec3(position)) {
+			error(tokenizer_, "expected the frame and the position of key " + std::to_string(i + 1) + " of " + std::to_string(count));
+		}
+		if (i > 0 && !(frame > track_.m_frames.back())) error(tokenizer_, "the frames of the keys must increase");
+		track_.m_frames.push_back(frame);
+		track_.m_positions.push_back(position);
+	}
+	m_tracks.push_back(track_);
 }
 
 /**
 	Initializes a light and adds it to m_lights.
 
-	@param ifstream the reference to the input file stream.
+	@param tokenizer_ the tokenizer over the scene file.
 */
-void scene::init_light(std::ifstream& ifstream) {
-	std::string attribute;
-	ifstream >> attribute;
-
-	glm::vec3 position;
-	ifstream >> position.x >> position.y >> position.z;
-
-	ifstream >> attribute;
-
-	glm::vec3 diffuse;
-	ifstream >> diffuse.x >> diffuse.y >> diffuse.z;
-
-	ifstream >> attribute;
-
-	glm::vec3 specular;
-	ifstream >> specular.x >> specular.y >> specular.z;
-
+void scene::init_light(tokenizer& tokenizer_) {
+	glm::vec3 position = read_vec3(tokenizer_, "pos:");
+	glm::vec3 diffuse = read_vec3(tokenizer_, "dif:");
+	glm::vec3 specular = read_vec3(tokenizer_, "spe:");
 	m_lights.push_back(light(position, diffuse, specular));
 }
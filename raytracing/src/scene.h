@@ -5,26 +5,90 @@
 #include "shapes.h"
 #include "camera.h"
 #include "light.h"
+#include "options.h"
+#include "timeline.h"
+#include "tokenizer.h"
+#include "mesh_cache.h"
 #include <vector>
 #include <string>
 
 class scene {
 public:
-	scene();
+	scene(const options& options_);
+	scene(const std::string& scene_file, const options& options_, mesh_cache* cache = nullptr);
 	~scene();
 
-	camera* m_camera;
+	bool is_loaded() const;
+	const std::string& load_error() const;
+	std::vector<std::string> files() const;
+	std::string shape_name(size_t index) const;
+	bool is_animated() const;
+	float last_key() const;
+	std::vector<size_t> set_frame(float frame);
+
+	camera* m_camera = nullptr;
 	std::vector<light> m_lights;
 	std::vector<shape*> m_shapes;
+	std::vector<shape::material> m_materials;
+	timeline m_load_timeline; // the tasks that loaded the scene, see load().
 
 private:
+	/**
+		The mesh_task struct holds a mesh of the scene file. Meshes are loaded
+		concurrently once the whole file is parsed. See load_meshes().
+	*/
+	struct mesh_task {
+		std::string m_file_name;
+		unsigned int m_material;
+		size_t m_shape; // the index of the mesh in m_shapes.
+	};
+
+	/**
+		The track struct holds the keyframes of the position of an object. See
+		init_keys().
+	*/
+	struct track {
+		enum class target { none, camera, light, shape };
+
+		glm::vec3 position_at(float frame) const;
+
+		target m_target = target::none;
+		size_t m_index = 0; // the index of the light in m_lights, or of the shape in m_shapes.
+		bool m_smooth = false; // a Catmull-Rom spline through the keys, instead of lines.
+		std::vector<float> m_frames; // the frames of the keys, increasing.
+		std::vector<glm::vec3> m_positions;
+	};
+
+	/**
+		The load_failure struct is thrown by error() to stop parsing. See load().
+	*/
+	struct load_failure {};
+
 	std::string m_directory;
+	std::string m_file_name;
+	std::string m_error; // the reason the scene could not be loaded, empty if it was.
+	triangle_algorithm m_triangle_algorithm;
+	unsigned int m_thread_count;
+	std::vector<mesh_task> m_mesh_tasks;
+	std::vector<track> m_tracks;
+	mesh_cache* m_mesh_cache = nullptr; // the cache the meshes are shared through, if any.
 	void set_directory(const std::string& abs_path);
+	unsigned int add_material(const shape::material& mat);
+	void load(const std::string& scene_file);
+	void parse(tokenizer& tokenizer_);
+	void load_meshes(timeline& timeline_);
+
+	void error(const tokenizer& tokenizer_, const std::string& message);
+	glm::vec3 read_vec3(tokenizer& tokenizer_, const char* attribute);
+	float read_float(tokenizer& tokenizer_, const char* attribute);
+	shape::material read_material(tokenizer& tokenizer_);
 
-	void init_camera(std::ifstream& ifstream);
-	void init_plane(std::ifstream& ifstream);
-	void init_sphere(std::ifstream& ifstream);
-	void init_mesh(std::ifstream& ifstream);
-	void init_light(std::ifstream& ifstream);
+	void init_camera(tokenizer& tokenizer_);
+	void init_plane(tokenizer& tokenizer_);
+	void init_sphere(tokenizer& tokenizer_);
+	void init_spheres(tokenizer& tokenizer_);
+	void init_mesh(tokenizer& tokenizer_);
+	void init_light(tokenizer& tokenizer_);
+	void init_keys(tokenizer& tokenizer_, const track& previous);
 };
 
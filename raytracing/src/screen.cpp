@@ -51,8 +51,21 @@ screen& screen::operator=(const screen& rhs) {
 	@param v v-coordinates of the pixel.
 	@return glm::vec3 the equivalent 3D world space point.
 */
-glm::vec3 screen::to_world(float u, float v) {
+glm::vec3 screen::to_world(float u, float v) const {
 	float x = m_slope_x * u + m_intersection_x;
 	float y = -(m_slope_y * v + m_intersection_y);
 	return glm::vec3(x, y, m_center.z);
+}
+
+/**
+	@return screen_view the transform of to_world(), for the kernels.
+*/
+screen_view screen::get_view() const {
+	screen_view view;
+	view.m_slope_x = m_slope_x;
+	view.m_intersection_x = m_intersection_x;
+	view.m_slope_y = m_slope_y;
+	view.m_intersection_y = m_intersection_y;
+	view.m_z = m_center.z;
+	return view;
 }
\ No newline at end of file
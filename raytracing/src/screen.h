@@ -5,11 +5,26 @@
 #include "glm/glm/glm.hpp"
 #include "camera.h"
 
+/**
+	The screen_view struct holds the transform of screen::to_world(), for the kernels:
+		x = m_slope_x * u + m_intersection_x
+		y = -(m_slope_y * v + m_intersection_y)
+		z = m_z
+*/
+struct screen_view {
+	float m_slope_x;
+	float m_intersection_x;
+	float m_slope_y;
+	float m_intersection_y;
+	float m_z;
+};
+
 class screen {
 public:
 	screen(camera camera, float height = -1.f);
 	screen& operator=(const screen& rhs);
-	glm::vec3 to_world(float u, float v);
+	glm::vec3 to_world(float u, float v) const;
+	screen_view get_view() const;
 
 	float m_width;
 	float m_height;
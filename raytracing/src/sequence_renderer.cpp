@@ -0,0 +1,158 @@
+#include "sequence_renderer.h"
+#include "tile_writer.h"
+#include "event_trace.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+/**
+	Parameterized constructor.
+
+	@param scene_ the animated scene.
+	@param raytracer_ the raytracer of the scene.
+	@param options_ the options: the frames, and the file name pattern, see
+	frame_file().
+*/
+sequence_renderer::sequence_renderer(scene& scene_, raytracer& raytracer_, const options& options_)
+	:
+	m_scene(scene_),
+	m_raytracer(raytracer_),
+	m_options(options_)
+{}
+
+/**
+	Renders the frames, and reports the time spent moving the objects, tracing
+	and writing the files, and the frames per second.
+
+	@param error [out] the reason a frame could not be written.
+	@return bool false if a frame could not be written.
+*/
+bool sequence_renderer::run(std::string& error) {
+	typedef std::chrono::steady_clock clock;
+	auto start = clock::now();
+	framebuffer images[2] = {
+		framebuffer(m_raytracer.width(), m_raytracer.height(), m_options.m_format),
+		framebuffer(m_raytracer.width(), m_raytracer.height(), m_options.m_format)
+	};
+	std::thread writer;
+	bool written = true;
+	std::string write_error;
+	std::chrono::duration<double> update_time(0), trace_time(0), write_time(0), wait_time(0);
+
+	if (!m_scene.is_animated()) std::cout << "The scene has no keys: every frame is the same." << std::endl;
+	for (unsigned int frame = m_options.m_first_frame; frame <= m_options.m_last_frame; frame++) {
+		framebuffer& image = images[(frame - m_options.m_first_frame) % 2];
+
+		auto frame_start = clock::now();
+		for (size_t index : m_scene.set_frame((float)frame)) {
+			m_raytracer.update_shape(index);
+		}
+		m_raytracer.set_camera(*m_scene.m_camera);
+		m_raytracer.set_lights(m_scene.m_lights);
+		auto traced = clock::now();
+		m_raytracer.render_frame(image);
+		auto done = clock::now();
+		update_time += traced - frame_start;
+		trace_time += done - traced;
+
+		// the previous frame was written while this one rendered.
+		if (writer.joinable()) writer.join();
+		wait_time += clock::now() - done;
+		if (!written) break;
+
+		std::chrono::duration<double, std::milli> elapsed = done - frame_start;
+		std::cout << "Frame " << frame << " rendered in " << (long long)elapsed.count() << " ms." << std::endl;
+		std::string file_name = frame_file(frame);
+		writer = std::thread([this, &image, file_name, &written, &write_error, &write_time] {
+			auto write_start = clock::now();
+			written = write_frame(image, file_name, write_error);
+			write_time += clock::now() - write_start;
+		});
+	}
+	if (writer.joinable()) writer.join();
+	if (!written) {
+		error = write_error;
+		return false;
+	}
+
+	unsigned int frame_count = m_options.m_last_frame - m_options.m_first_frame + 1;
+	std::chrono::duration<double> elapsed = clock::now() - start;
+	std::cout << "Rendered " << frame_count << " frames in " << elapsed.count() << " s, "
+		<< frame_count / elapsed.count() << " frames per second." << std::endl;
+	std::cout << "Moving objects " << update_time.count() * 1e3 << " ms, tracing " << trace_time.count()
+		<< " s, writing " << write_time.count() << " s overlapped with tracing, of which "
+		<< wait_time.count() << " s waited for." << std::endl;
+	return true;
+}
+
+/**
+	The name of the file of a frame: the run of # of the output file name is
+	replaced by the frame number, padded with zeros to as many digits, or
+	without #, the frame number is added before the extension.
+
+	@param frame the frame.
+	@return std::string the file name, such as frame_0012.png for frame_####.png
+	or frame.png.
+*/
+std::string sequence_renderer::frame_file(unsigned int frame) const {
+	const std::string& pattern = m_options.m_output;
+	size_t begin = pattern.find('#');
+	std::ostringstream name;
+	if (begin == std::string::npos) {
+		size_t dot = pattern.rfind('.');
+		size_t separator = pattern.find_last_of("/\\");
+		if (dot == std::string::npos || (separator != std::string::npos && dot < separator)) dot = pattern.size();
+		name << pattern.substr(0, dot) << "_" << std::setw(4) << std::setfill('0') << frame << pattern.substr(dot);
+	}
+	else {
+		size_t end = pattern.find_first_not_of('#', begin);
+		if (end == std::string::npos) end = pattern.size();
+		name << pattern.substr(0, begin) << std::setw((int)(end - begin)) << std::setfill('0') << frame << pattern.substr(end);
+	}
+	return name.str();
+}
+
+/**
+	Writes a frame to its file, tile by tile.
+
+	@param image the frame.
+	@param file_name the name of the file, see open_tile_writer().
+	@param error [out] the reason the file could not be written.
+	@return bool false if the file could not be written.
+*/
+bool sequence_renderer::write_frame(const framebuffer& image, const std::string& file_name, std::string& error) const {
+	scoped_event event("write frame", "output", -1, &file_name);
+	std::unique_ptr<tile_writer> writer = open_tile_writer(file_name, image.width(), image.height(), m_options.m_tile_size, error);
+	if (!writer) return false;
+
+	uint32_t tile_size = m_options.m_tile_size;
+	uint64_t index = 0;
+	for (uint32_t y = 0; y < image.height(); y += tile_size) {
+		for (uint32_t x = 0; x < image.width(); x += tile_size, index++) {
+			tile tile_;
+			tile_.m_index = index;
+			tile_.m_x = x;
+			tile_.m_y = y;
+			tile_.m_width = std::min(tile_size, image.width() - x);
+			tile_.m_height = std::min(tile_size, image.height() - y);
+			tile_.m_pixels = framebuffer(tile_.m_width, tile_.m_height, image.format());
+			size_t row_size = tile_.m_width * image.pixel_size();
+			for (uint32_t row = 0; row < tile_.m_height; row++) {
+				std::copy(image.row(y + row) + x * image.pixel_size(), image.row(y + row) + x * image.pixel_size() + row_size,
+					tile_.m_pixels.row(row));
+			}
+			if (!writer->write(tile_)) {
+				error = writer->error();
+				return false;
+			}
+		}
+	}
+	if (!writer->finish()) {
+		error = writer->error();
+		return false;
+	}
+	return true;
+}
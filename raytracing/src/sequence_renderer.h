@@ -0,0 +1,29 @@
+/**
+	The sequence_renderer class renders the frames of an animation to numbered
+	image files. See scene::set_frame().
+
+	The scene is loaded once. For every frame, only the objects that have keys
+	move, and the raytracer only updates their views. Frames are pipelined: a
+	frame is written to its file on a thread of its own while the next frame
+	renders into a second framebuffer.
+*/
+#pragma once
+#include "scene.h"
+#include "raytracer.h"
+#include "framebuffer.h"
+#include "options.h"
+#include <string>
+
+class sequence_renderer {
+public:
+	sequence_renderer(scene& scene_, raytracer& raytracer_, const options& options_);
+	bool run(std::string& error);
+
+private:
+	std::string frame_file(unsigned int frame) const;
+	bool write_frame(const framebuffer& image, const std::string& file_name, std::string& error) const;
+
+	scene& m_scene;
+	raytracer& m_raytracer;
+	options m_options;
+};
@@ -1,9 +1,24 @@
 #include "shapes.h"
 #include "ray.h"
-////using tiny obj loader for obj loading////
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
-/////////////////////////////////////////////
+#include "kernels.h"
+#include "obj_loader.h"
+#include "ply_loader.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+/**
+	@param type the kind of shape.
+	@return const char* the name of the kind, as in the scene file.
+*/
+const char* to_string(shape_type type) {
+	switch (type) {
+	case shape_type::plane: return "plane";
+	case shape_type::sphere: return "sphere";
+	case shape_type::triangle: return "triangle";
+	default: return "mesh";
+	}
+}
 
 /**
 	Parameterized constructor.
@@ -21,6 +36,16 @@ shape::material::material(glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specul
 	m_shi(shi)
 {}
 
+/**
+	Moves the shape, for the keyframes of an animation. See scene::set_frame().
+
+	@param position the new position of the shape.
+	@return bool false if the shape cannot be moved.
+*/
+bool shape::move_to(const glm::vec3&) {
+	return false;
+}
+
 /**
 	Parameterized constructor.
 
@@ -29,9 +54,9 @@ shape::material::material(glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specul
 	@param pos0 the position of the first vertex.
 	@param pos1 the position of the second vertex.
 	@param pos2 the position of the third vertex.
-	@param mat the material of the triangle.
+	@param mat the index of the material of the triangle.
 */
-triangle::triangle(glm::vec3 pos0, glm::vec3 pos1, glm::vec3 pos2, const material& mat) {
+triangle::triangle(glm::vec3 pos0, glm::vec3 pos1, glm::vec3 pos2, unsigned int mat) {
 	m_vertices[0].m_pos = pos0;
 	m_vertices[1].m_pos = pos1;
 	m_vertices[2].m_pos = pos2;
@@ -43,6 +68,50 @@ triangle::triangle(glm::vec3 pos0, glm::vec3 pos1, glm::vec3 pos2, const materia
 	m_vertices[2].m_norm = m_surface_normal;
 }
 
+/**
+	Computes the ray-triangle intersection of front-facing triangles.
+
+	See intersect().
+
+	@param ray a pointer to the current ray.
+*/
+void triangle::intersection(ray* ray) {
+	float t, u, v;
+	if (intersect(*ray, t, u, v)) ray->set_hit(t, this, 0, u, v);
+}
+
+/**
+	Computes the surface information at the hit point of ray.
+
+	The normal is interpolated from the vertex normals using the barycentric
+	coordinates of the hit.
+
+	@param ray the ray that hit the triangle.
+	@return surface the surface information at the hit point.
+*/
+surface triangle::get_surface(const ray& ray) const {
+	float u = ray.m_hit.m_u;
+	float v = ray.m_hit.m_v;
+
+	surface surface_;
+	surface_.m_position = ray.point_at(ray.m_hit.m_t);
+	surface_.m_normal = glm::normalize((1.f - u - v) * m_vertices[0].m_norm + u * m_vertices[1].m_norm + v * m_vertices[2].m_norm);
+	surface_.m_material = m_material;
+	return surface_;
+}
+
+/**
+	@return shape_view the triangle as seen by the packet kernels.
+*/
+shape_view triangle::get_view() const {
+	shape_view view = {};
+	view.m_type = shape_type::triangle;
+	view.m_material = m_material;
+	view.m_records = m_vertices;
+	view.m_count = 1;
+	return view;
+}
+
 /**
 	Computes the ray-triangle intersection of front-facing triangles.
 
@@ -50,181 +119,431 @@ triangle::triangle(glm::vec3 pos0, glm::vec3 pos1, glm::vec3 pos2, const materia
 	it is faster than finding the intersection with the plane of the triangle
 	first, and then checking if the intersection is within the triangle.
 
-	@param ray a pointer to the current ray.
+	@param ray the current ray.
+	@param t [out] the time of intersection.
+	@param u [out] the barycentric coordinate of the hit relative to the second vertex.
+	@param v [out] the barycentric coordinate of the hit relative to the third vertex.
+	@return bool true if the ray hits the triangle.
 */
-void triangle::intersection(ray* ray) {
-	if (glm::dot(ray->m_direction, m_surface_normal) > 0.f) return; // is a back face
+bool triangle::intersect(const ray& ray, float& t, float& u, float& v) const {
+	if (glm::dot(ray.m_direction, m_surface_normal) > 0.f) return false; // is a back face
 
 	const float EPSILON = 0.0000001f;
 	glm::vec3 e1, e2, s;
 	e1 = (m_vertices[1].m_pos - m_vertices[0].m_pos);
 	e2 = (m_vertices[2].m_pos - m_vertices[0].m_pos);
 
-	glm::vec3 p = glm::cross(ray->m_direction, e2);
+	glm::vec3 p = glm::cross(ray.m_direction, e2);
 	float d = glm::dot(p, e1);
 
 	//ray is parallel
-	if (abs(d) < EPSILON) return;
+	if (abs(d) < EPSILON) return false;
 
-	s = (ray->m_origin - m_vertices[0].m_pos);
+	s = (ray.m_origin - m_vertices[0].m_pos);
 
 	float alpha = glm::dot(p, s) / d;
 
-	if (alpha < 0.f || alpha > 1.f) return;
+	if (alpha < 0.f || alpha > 1.f) return false;
 
 	glm::vec3 q = glm::cross(s, e1);
-	float beta = glm::dot(ray->m_direction, q) / d;
+	float beta = glm::dot(ray.m_direction, q) / d;
+
+	if ((beta < 0.f) || (alpha + beta > 1.0f)) return false;
+
+	t = glm::dot(e2, q) / d;
+	if (t <= EPSILON) return false;
+
+	u = alpha;
+	v = beta;
+	return true;
+}
 
-	if ((beta < 0.f) || (alpha + beta > 1.0f)) return;
+/**
+	Parameterized constructor.
 
-	float t = glm::dot(e2, q) / d;
-	if (t <= EPSILON) return;
+	Loads a .mesh file in place with load_mesh_file(), or a .ply or .obj file with
+	load_file(). If the file cannot be loaded, the mesh has no triangles. See
+	error().
 
-	glm::vec3 intersection = ray->point_at(t);
-	glm::vec3 norm = glm::normalize((1.f - alpha - beta) * m_vertices[0].m_norm + alpha * m_vertices[1].m_norm + beta * m_vertices[2].m_norm);
+	@param file_name the .obj, .ply or .mesh file to load.
+	@param mat the index of the material of the mesh.
+	@param algorithm [optional] the triangle intersection algorithm.
+*/
+mesh::mesh(const char* file_name, unsigned int mat, triangle_algorithm algorithm) : m_algorithm(algorithm) {
+	m_material = mat;
 
-	ray->set_hit(t, intersection, norm, m_material);
+	if (has_extension(file_name, ".mesh")) load_mesh_file(file_name);
+	else load_file(file_name);
+}
+
+/**
+	@param file_name the name of a file.
+	@param extension the extension, with its dot.
+	@return bool true if file_name ends with extension.
+*/
+bool mesh::has_extension(const std::string& file_name, const std::string& extension) {
+	return file_name.size() >= extension.size() &&
+		file_name.compare(file_name.size() - extension.size(), extension.size(), extension) == 0;
 }
 
 /**
 	Parameterized constructor.
 
-	Loads the mesh located in the .obj file_name, and processes all the
-	vertex positions to create triangles and store them in m_triangles.
-	Disregards normals of the file. See get_smooth_normals() for more info.
+	Builds the records of algorithm from the triangles. The mesh has no normals
+	until set_normals() is called. The normals and the records can so be computed
+	concurrently.
 
-	@param file_name the .obj file to load.
-	@param mat the material of the mesh.
+	@param positions the vertex positions.
+	@param indices the indices in positions of the vertices of the triangles, 3 per triangle.
+	@param mat the index of the material of the mesh.
+	@param algorithm [optional] the triangle intersection algorithm.
 */
-mesh::mesh(const char* file_name, const material& mat) {
+mesh::mesh(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices, unsigned int mat,
+	triangle_algorithm algorithm) : m_algorithm(algorithm) {
 	m_material = mat;
+	m_triangle_count = (unsigned int)(indices.size() / triangle::VERTEX_COUNT);
+	build(positions.data(), indices.data());
+}
+
+/**
+	Parameterized constructor.
 
-	// obj loading and processing is mix of my original work  
-	// and sample code found on https://github.com/syoyo/tinyobjloader
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
+	Uses the records and normals of geometry, which is kept alive by the mesh.
 
-	std::string err;
-	bool loaded = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, file_name, NULL, false);
-	
-	if (!err.empty()) {
-		std::cerr << err << std::endl;
-	}
+	@param geometry the mesh whose triangles are used.
+	@param mat the index of the material of the mesh.
+*/
+mesh::mesh(const std::shared_ptr<const mesh>& geometry, unsigned int mat)
+	:
+	m_algorithm(geometry->m_algorithm),
+	m_geometry(geometry),
+	m_records(geometry->m_records),
+	m_normals(geometry->m_normals),
+	m_triangle_count(geometry->m_triangle_count)
+{
+	m_material = mat;
+}
+
+/**
+	Sets the vertex normals.
 
-	if (!loaded) exit(EXIT_FAILURE);
+	@param normals the vertex normals, 3 per triangle. See get_smooth_normals().
+*/
+void mesh::set_normals(std::vector<glm::vec3> normals) {
+	m_vertex_normals = std::move(normals);
+	m_normals = m_vertex_normals.data();
+}
 
-	for (size_t s = 0; s < shapes.size(); s++) {
-		m_triangle_count += shapes[s].mesh.num_face_vertices.size();
+/**
+	Loads the triangles of the .ply file_name with load_ply(), or of any other file
+	as an .obj file with load_obj().
+
+	@param file_name the .obj or .ply file to load.
+	@param positions [out] the vertex positions.
+	@param indices [out] the indices in positions of the vertices of the triangles, 3 per triangle.
+	@param error [out] the reason of the failure.
+	@return bool true if the file was loaded.
+*/
+bool mesh::load_triangles(const char* file_name, std::vector<glm::vec3>& positions,
+	std::vector<unsigned int>& indices, std::string& error) {
+	return has_extension(file_name, ".ply") ? load_ply(file_name, positions, indices, error) :
+		load_obj(file_name, positions, indices, error);
+}
+
+/**
+	Loads the triangles of file_name with load_triangles(). Disregards normals of
+	the file. See get_smooth_normals() for more info. The triangles are then turned
+	into the records of m_algorithm. See build().
+
+	@param file_name the .obj or .ply file to load.
+*/
+void mesh::load_file(const char* file_name) {
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> indices;
+	if (!load_triangles(file_name, positions, indices, m_error)) return;
+	m_triangle_count = (unsigned int)(indices.size() / triangle::VERTEX_COUNT);
+
+	set_normals(get_smooth_normals(positions, indices));
+	build(positions.data(), indices.data());
+}
+
+/**
+	Maps the .mesh file_name in memory. Its normals and the records of m_algorithm
+	are used in place. If the file has no records for m_algorithm, they are built
+	from its positions and indices.
+
+	@param file_name the .mesh file to load.
+*/
+void mesh::load_mesh_file(const char* file_name) {
+	m_file.reset(new mesh_file(file_name));
+	if (!m_file->is_valid()) {
+		m_error = m_file->error();
+		m_file.reset();
+		return;
 	}
-	m_triangles = new triangle*[m_triangle_count];
-	
-	unsigned int triangle_index = 0;
-	glm::vec3 positions[triangle::VERTEX_COUNT];
-	// Loop over shapes
-	for (size_t s = 0; s < shapes.size(); s++) {
-		// Loop over faces(polygon)
-		size_t index_offset = 0;
-		for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
-			int fv = shapes[s].mesh.num_face_vertices[f];
-			
-			// Loop over vertices in the face.
-			for (int v = 0; v < fv; v++) {
-				// access to vertex positions
-				tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-				positions[v] = glm::vec3(
-					attrib.vertices[3 * idx.vertex_index + 0],
-					attrib.vertices[3 * idx.vertex_index + 1],
-					attrib.vertices[3 * idx.vertex_index + 2]);
+	m_triangle_count = (unsigned int)m_file->header().m_triangle_count;
+	m_normals = m_file->normals();
+	m_records = m_file->records(m_algorithm);
+
+	if (!m_records) {
+		const unsigned int* indices = m_file->indices();
+		for (size_t i = 0; i < (size_t)m_triangle_count * triangle::VERTEX_COUNT; i++) {
+			if (indices[i] >= m_file->header().m_vertex_count) {
+				m_error = std::string(file_name) + " is corrupted.";
+				m_file.reset();
+				m_normals = nullptr;
+				m_triangle_count = 0;
+				return;
 			}
-			m_triangles[triangle_index++] = new triangle(positions[0], positions[1], positions[2], m_material);
-			index_offset += fv;
 		}
+		std::cout << file_name << " has no " << to_string(m_algorithm) << " records, building them." << std::endl;
+		build(m_file->positions(), m_file->indices());
 	}
-	////////////////////////////////////////////////////////////////////////////////////////////////
-
-	get_smooth_normals();
 }
 
-mesh::~mesh() {
-	if (!m_triangles) return;
+/**
+	Saves the records of m_algorithm.
+
+	@param positions the vertex positions of the mesh.
+	@param indices the indices in positions of the vertices of the triangles.
+*/
+void mesh::build(const glm::vec3* positions, const unsigned int* indices) {
+	switch (m_algorithm) {
+	case triangle_algorithm::woop: m_woop_records.reserve(m_triangle_count); break;
+	case triangle_algorithm::havel_herout: m_havel_records.reserve(m_triangle_count); break;
+	default: m_moller_records.reserve(m_triangle_count); break;
+	}
 
 	for (unsigned int i = 0; i < m_triangle_count; i++) {
-		delete m_triangles[i];
-		m_triangles[i] = nullptr;
+		const unsigned int* index = &indices[i * triangle::VERTEX_COUNT];
+		const glm::vec3& pos0 = positions[index[0]];
+		const glm::vec3& pos1 = positions[index[1]];
+		const glm::vec3& pos2 = positions[index[2]];
+
+		switch (m_algorithm) {
+		case triangle_algorithm::woop:
+			m_woop_records.push_back(woop_record(pos0, pos1, pos2));
+			break;
+		case triangle_algorithm::havel_herout:
+			m_havel_records.push_back(havel_record(pos0, pos1, pos2));
+			break;
+		default:
+			m_moller_records.push_back(moller_record(pos0, pos1, pos2));
+			break;
+		}
+	}
+
+	switch (m_algorithm) {
+	case triangle_algorithm::woop: m_records = m_woop_records.data(); break;
+	case triangle_algorithm::havel_herout: m_records = m_havel_records.data(); break;
+	default: m_records = m_moller_records.data(); break;
 	}
-	delete m_triangles;
-	m_triangles = nullptr;
+}
+
+/**
+	@return unsigned int the number of triangles in the mesh.
+*/
+unsigned int mesh::triangle_count() const {
+	return m_triangle_count;
+}
+
+/**
+	@return size_t the memory allocated for the triangles of the mesh in bytes.
+*/
+size_t mesh::memory_usage() const {
+	return m_moller_records.size() * sizeof(moller_record) +
+		m_woop_records.size() * sizeof(woop_record) +
+		m_havel_records.size() * sizeof(havel_record) +
+		m_vertex_normals.size() * sizeof(glm::vec3);
+}
+
+/**
+	@return size_t the size of the mapped .mesh file in bytes, 0 for .obj files.
+*/
+size_t mesh::mapped_memory() const {
+	return m_file ? m_file->size() : 0;
+}
+
+/**
+	@return bool true if the triangles are the ones of another mesh. They are
+	not counted by memory_usage() and mapped_memory().
+*/
+bool mesh::is_shared() const {
+	return m_geometry != nullptr;
+}
+
+/**
+	@return const std::string& the reason the file of the mesh could not be
+	loaded, empty if it was.
+*/
+const std::string& mesh::error() const {
+	return m_error;
 }
 
 /**
 	Computes the ray-mesh intersection.
 
 	Trivial  for mesh shapes. Just get the intersection with each triangle
-	in m_triangles.
+	record of m_algorithm, using the kernels selected for the CPU. The index
+	of the triangle is saved as the primitive of the hit.
 
 	@param ray a pointer to the current ray.
 */
 void mesh::intersection(ray* ray) {
-	for (unsigned int i = 0; i < m_triangle_count; i++) {
-		m_triangles[i]->intersection(ray);
+	const kernels& kernels_ = get_kernels();
+	bool closer;
+
+	switch (m_algorithm) {
+	case triangle_algorithm::woop:
+		closer = kernels_.m_intersect_woop((const woop_record*)m_records, m_triangle_count, ray->m_origin, ray->m_direction, ray->m_hit);
+		break;
+	case triangle_algorithm::havel_herout:
+		closer = kernels_.m_intersect_havel((const havel_record*)m_records, m_triangle_count, ray->m_origin, ray->m_direction, ray->m_hit);
+		break;
+	default:
+		closer = kernels_.m_intersect_moller((const moller_record*)m_records, m_triangle_count, ray->m_origin, ray->m_direction, ray->m_hit);
+		break;
 	}
+
+	if (closer) ray->m_hit.m_shape = this;
+}
+
+/**
+	Computes the surface information at the hit point of ray.
+
+	The normal is interpolated from the vertex normals of the triangle that was
+	hit using the barycentric coordinates of the hit.
+
+	@param ray the ray that hit the mesh.
+	@return surface the surface information at the hit point.
+*/
+surface mesh::get_surface(const ray& ray) const {
+	const glm::vec3* norm = &m_normals[ray.m_hit.m_primitive * triangle::VERTEX_COUNT];
+	float u = ray.m_hit.m_u;
+	float v = ray.m_hit.m_v;
+
+	surface surface_;
+	surface_.m_position = ray.point_at(ray.m_hit.m_t);
+	surface_.m_normal = glm::normalize((1.f - u - v) * norm[0] + u * norm[1] + v * norm[2]);
+	surface_.m_material = m_material;
+	return surface_;
+}
+
+/**
+	@return shape_view the mesh as seen by the packet kernels.
+*/
+shape_view mesh::get_view() const {
+	shape_view view = {};
+	view.m_type = shape_type::mesh;
+	view.m_material = m_material;
+	view.m_algorithm = m_algorithm;
+	view.m_records = m_records;
+	view.m_normals = m_normals;
+	view.m_count = m_triangle_count;
+	return view;
 }
 
 /**
 	This method computes vertex normals for smooth shading.
 
-	It loops over every vertex in m_triangles, and for every vertex,
-	computes its normal as the sum of the m_surface_normal of the triangle
-	that the vertex belongs to. It doesn't not average the result since
-	m_surface_normal is not a unit vector. So implicitely, the weight of a triangle
-	is determined by the length of its m_surface_normal. Hence the vertex normal needs
-	to only be normalized once its normal has been computed.
+	For every vertex of every triangle, it computes its normal as the sum of the
+	surface normal of the triangle and of the surface normals of the following
+	triangles that have a vertex at the same position. It doesn't not average the
+	result since the surface normals are not unit vectors. So implicitely, the weight
+	of a triangle is determined by the length of its surface normal. Hence the vertex
+	normal needs to only be normalized once its normal has been computed.
+
+	The triangles that share a position are found once by grouping the positions,
+	instead of comparing every vertex with every other one.
+
+	@param positions the vertex positions of the mesh.
+	@param indices the indices in positions of the vertices of the triangles.
+	@return std::vector<glm::vec3> the vertex normals, 3 per triangle.
 */
-void mesh::get_smooth_normals() {
-	// to keep track of duplicate normals since if two triangles are coplanar
-	// and share a vertex, we do not want to add the same normal twice.
-	std::vector<glm::vec3> vertex_normals; 
+std::vector<glm::vec3> mesh::get_smooth_normals(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices) {
 	const float EPSILON = 0.000001f; // for float equality testing
+	const unsigned int N = triangle::VERTEX_COUNT;
+	const unsigned int triangle_count = (unsigned int)(indices.size() / N);
 
-	// for each triangle
-	for (unsigned int i = 0; i < m_triangle_count; i++) {
-		// for each vertex in the triangle
-		for (unsigned int j = 0; j < triangle::VERTEX_COUNT; j++) {
-			glm::vec3 pos = m_triangles[i]->m_vertices[j].m_pos;
-			glm::vec3& norm = m_triangles[i]->m_vertices[j].m_norm;
-			vertex_normals.push_back(norm);
-			// for every other triangle
-			for (unsigned int k = i + 1; k < m_triangle_count; k++) {
-				// for each vertex in the other triangle
-				for (unsigned int l = 0; l < triangle::VERTEX_COUNT; l++) {
-					glm::vec3 pos_ = m_triangles[k]->m_vertices[l].m_pos;
-					if (pos_ == pos) { // same vertex
-						glm::vec3 norm_ = m_triangles[k]->m_vertices[l].m_norm;
-						bool dup_norm = false;
-						for (unsigned int z = 0; z < vertex_normals.size(); z++) {
-							glm::vec3 test_norm = vertex_normals[z];
-							// if true, we have a coplanar triangle with shared vertex.
-							// Disregard the normal since it was already added from previous triangle.
-							if (glm::abs(norm_.x - test_norm.x) <= EPSILON &&
-								glm::abs(norm_.y - test_norm.y) <= EPSILON &&
-								glm::abs(norm_.z - test_norm.z) <= EPSILON) {
-								dup_norm = true;
-								break;
-							}
-						}
-						if (!dup_norm) {
-							norm += norm_;
-							vertex_normals.push_back(norm_);
-						}
-						break; // no need to check other vertices of this triangle
+	std::vector<glm::vec3> surface_normals(triangle_count);
+	for (unsigned int i = 0; i < triangle_count; i++) {
+		const unsigned int* index = &indices[i * N];
+		surface_normals[i] = glm::cross(positions[index[1]] - positions[index[0]], positions[index[2]] - positions[index[0]]);
+	}
+
+	// the group of every position: equal positions are the same vertex, even
+	// when the file gives them different indices. -0 and 0 are equal.
+	struct position_hash {
+		size_t operator()(const glm::vec3& p) const {
+			unsigned int bits[3];
+			float values[3] = { p.x + 0.f, p.y + 0.f, p.z + 0.f };
+			std::memcpy(bits, values, sizeof(bits));
+			return (size_t)bits[0] * 73856093u ^ (size_t)bits[1] * 19349663u ^ (size_t)bits[2] * 83492791u;
+		}
+	};
+	std::unordered_map<glm::vec3, unsigned int, position_hash> groups_of_positions;
+	std::vector<unsigned int> groups(positions.size());
+	for (size_t i = 0; i < positions.size(); i++) {
+		groups[i] = groups_of_positions.emplace(positions[i], (unsigned int)groups_of_positions.size()).first->second;
+	}
+	size_t group_count = groups_of_positions.size();
+
+	// the triangles of every group, in order, each one once.
+	std::vector<unsigned int> first(group_count + 1, 0);
+	std::vector<unsigned int> triangles;
+	for (int pass = 0; pass < 2; pass++) {
+		if (pass == 1) {
+			for (size_t g = 0; g < group_count; g++) first[g + 1] += first[g];
+			triangles.resize(first[group_count]);
+		}
+		std::vector<unsigned int> next(first.begin(), first.end() - 1);
+		for (unsigned int i = 0; i < triangle_count; i++) {
+			for (unsigned int j = 0; j < N; j++) {
+				unsigned int g = groups[indices[i * N + j]];
+				bool seen = false;
+				for (unsigned int k = 0; k < j; k++) seen |= groups[indices[i * N + k]] == g;
+				if (seen) continue;
+
+				if (pass == 0) first[g + 1]++;
+				else triangles[next[g]++] = i;
+			}
+		}
+	}
+
+	std::vector<glm::vec3> normals((size_t)triangle_count * N);
+	// to keep track of duplicate normals since if two triangles are coplanar
+	// and share a vertex, we do not want to add the same normal twice.
+	std::vector<glm::vec3> vertex_normals;
+	for (unsigned int i = 0; i < triangle_count; i++) {
+		for (unsigned int j = 0; j < N; j++) {
+			unsigned int g = groups[indices[i * N + j]];
+			glm::vec3 norm = surface_normals[i];
+			vertex_normals.assign(1, norm);
+
+			// for every following triangle with a vertex at the same position
+			const unsigned int* following = std::upper_bound(&triangles[first[g]], &triangles[0] + first[g + 1], i);
+			for (; following != &triangles[0] + first[g + 1]; following++) {
+				glm::vec3 norm_ = surface_normals[*following];
+				bool dup_norm = false;
+				for (const glm::vec3& test_norm : vertex_normals) {
+					// if true, we have a coplanar triangle with shared vertex.
+					// Disregard the normal since it was already added from previous triangle.
+					if (glm::abs(norm_.x - test_norm.x) <= EPSILON &&
+						glm::abs(norm_.y - test_norm.y) <= EPSILON &&
+						glm::abs(norm_.z - test_norm.z) <= EPSILON) {
+						dup_norm = true;
+						break;
 					}
 				}
+				if (!dup_norm) {
+					norm += norm_;
+					vertex_normals.push_back(norm_);
+				}
 			}
-			vertex_normals.clear();
-			norm = glm::normalize(norm);
+			normals[i * N + j] = glm::normalize(norm);
 		}
 	}
+	return normals;
 }
 
 /**
@@ -232,9 +551,9 @@ void mesh::get_smooth_normals() {
 
 	@param center the sphere center point.
 	@param radius the sphere radius.
-	@param mat the sphere material.
+	@param mat the index of the sphere material.
 */
-sphere::sphere(glm::vec3 center, float radius, const material& mat) 
+sphere::sphere(glm::vec3 center, float radius, unsigned int mat) 
 	:
 	m_center(center), 
 	m_radius(radius) 
@@ -265,9 +584,44 @@ void sphere::intersection(ray* ray) {
 
 	float t = glm::min(t0, t1);
 
-	glm::vec3 intersection = ray->point_at(t);
-	glm::vec3 normal(intersection - m_center);
-	ray->set_hit(t, intersection, normal, m_material);
+	ray->set_hit(t, this);
+}
+
+/**
+	Computes the surface information at the hit point of ray.
+
+	@param ray the ray that hit the sphere.
+	@return surface the surface information at the hit point.
+*/
+surface sphere::get_surface(const ray& ray) const {
+	surface surface_;
+	surface_.m_position = ray.point_at(ray.m_hit.m_t);
+	surface_.m_normal = glm::normalize(surface_.m_position - m_center);
+	surface_.m_material = m_material;
+	return surface_;
+}
+
+/**
+	@return shape_view the sphere as seen by the packet kernels.
+*/
+shape_view sphere::get_view() const {
+	shape_view view = {};
+	view.m_type = shape_type::sphere;
+	view.m_material = m_material;
+	view.m_position = m_center;
+	view.m_radius = m_radius;
+	return view;
+}
+
+/**
+	Moves the center of the sphere.
+
+	@param position the new center.
+	@return bool true.
+*/
+bool sphere::move_to(const glm::vec3& position) {
+	m_center = position;
+	return true;
 }
 
 /**
@@ -275,9 +629,9 @@ void sphere::intersection(ray* ray) {
 
 	@param normal the plane normal.
 	@param point a point on the plane.
-	@param mat the plane material.
+	@param mat the index of the plane material.
 */
-plane::plane(glm::vec3 normal, glm::vec3 point, const material& mat) 
+plane::plane(glm::vec3 normal, glm::vec3 point, unsigned int mat) 
 	:
 	m_normal(normal), 
 	m_point(point) 
@@ -298,7 +652,43 @@ void plane::intersection(ray* ray) {
 	if (denominator != 0.f) {
 		float t = numerator / denominator;
 
-		glm::vec3 intersection = ray->point_at(t);
-		ray->set_hit(t, intersection, m_normal, m_material);
+		ray->set_hit(t, this);
 	} // else ray and plane are parallel
-}
\ No newline at end of file
+}
+
+/**
+	Computes the surface information at the hit point of ray.
+
+	@param ray the ray that hit the plane.
+	@return surface the surface information at the hit point.
+*/
+surface plane::get_surface(const ray& ray) const {
+	surface surface_;
+	surface_.m_position = ray.point_at(ray.m_hit.m_t);
+	surface_.m_normal = glm::normalize(m_normal);
+	surface_.m_material = m_material;
+	return surface_;
+}
+
+/**
+	@return shape_view the plane as seen by the packet kernels.
+*/
+shape_view plane::get_view() const {
+	shape_view view = {};
+	view.m_type = shape_type::plane;
+	view.m_material = m_material;
+	view.m_position = m_point;
+	view.m_normal = m_normal;
+	return view;
+}
+
+/**
+	Moves the plane to a point, keeping its normal.
+
+	@param position the new point of the plane.
+	@return bool true.
+*/
+bool plane::move_to(const glm::vec3& position) {
+	m_point = position;
+	return true;
+}
@@ -1,10 +1,17 @@
 #pragma once
 #include "glm/glm/glm.hpp"
+#include "triangle_records.h"
+#include "mesh_file.h"
+#include <memory>
+#include <string>
+#include <vector>
 #define XY_NORM glm::vec3(0.f, 0.f, 1.f)
 #define XZ_NORM glm::vec3(0.f, 1.f, 0.f)
 #define YZ_NORM glm::vec3(1.f, 0.f, 0.f)
 
 class ray;
+struct surface;
+struct shape_view;
 
 /**
 	The vertex struct holds the most basic vertex information.
@@ -23,9 +30,15 @@ class shape {
 public:
 	virtual ~shape() {}
 	virtual void intersection(ray* ray) = 0;
+	virtual surface get_surface(const ray& ray) const = 0;
+	virtual shape_view get_view() const = 0;
+	virtual bool move_to(const glm::vec3& position);
 
 	/**
 		The material struct hold the material information of a shape.
+
+		Materials are stored once in scene::m_materials. Shapes only hold
+		the index of their material in that table.
 	*/
 	struct material {
 		material() = default;
@@ -35,7 +48,52 @@ public:
 		glm::vec3 m_diffuse;
 		glm::vec3 m_specular;
 		float m_shi;
-	} m_material;
+	};
+
+	unsigned int m_material;
+};
+
+/**
+	The surface struct holds the information at the closest intersection of a ray.
+*/
+struct surface {
+	glm::vec3 m_position;
+	glm::vec3 m_normal;
+	unsigned int m_material;
+};
+
+/**
+	The kinds of shapes, as seen by the packet kernels.
+*/
+enum class shape_type {
+	plane,
+	sphere,
+	triangle,
+	mesh
+};
+
+const char* to_string(shape_type type);
+
+/**
+	The shape_view struct is a plain description of a shape for the packet kernels,
+	which do not call the virtual methods of the shapes. See kernels.inl.
+
+	Only the members of m_type are set:
+		plane: m_position (a point on the plane), m_normal.
+		sphere: m_position (the center), m_radius.
+		triangle: m_records (the 3 vertices).
+		mesh: m_algorithm, m_records, m_normals, m_count.
+*/
+struct shape_view {
+	shape_type m_type;
+	unsigned int m_material;
+	glm::vec3 m_position;
+	glm::vec3 m_normal;
+	float m_radius;
+	triangle_algorithm m_algorithm;
+	const void* m_records;
+	const glm::vec3* m_normals;
+	unsigned int m_count;
 };
 
 /**
@@ -43,8 +101,11 @@ public:
 */
 class triangle : public shape {
 public:
-	triangle(glm::vec3 pos0, glm::vec3 pos1, glm::vec3 pos2, const material& mat);
+	triangle(glm::vec3 pos0, glm::vec3 pos1, glm::vec3 pos2, unsigned int mat);
 	virtual void intersection(ray* ray);
+	virtual surface get_surface(const ray& ray) const;
+	virtual shape_view get_view() const;
+	bool intersect(const ray& ray, float& t, float& u, float& v) const;
 
 	static const unsigned int VERTEX_COUNT = 3;
 
@@ -56,17 +117,50 @@ private:
 
 /**
 	The mesh class.
+
+	Triangles are only kept as precomputed records for the selected intersection
+	algorithm, and as vertex normals for shading. See triangle_records.h.
+
+	The records and normals of a .mesh file are used in place in the mapped file.
+	See mesh_file.h. A mesh can also use the triangles of another mesh, so that
+	scenes can share them. See mesh_cache.h.
 */
 class mesh : public shape {
 public:
-	mesh(const char* file_name, const material& mat);
-	virtual ~mesh();
+	mesh(const char* file_name, unsigned int mat, triangle_algorithm algorithm = TRIANGLE_ALGORITHM);
+	mesh(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices, unsigned int mat,
+		triangle_algorithm algorithm = TRIANGLE_ALGORITHM);
+	mesh(const std::shared_ptr<const mesh>& geometry, unsigned int mat);
+	void set_normals(std::vector<glm::vec3> normals);
 	virtual void intersection(ray* ray);
+	virtual surface get_surface(const ray& ray) const;
+	virtual shape_view get_view() const;
+	unsigned int triangle_count() const;
+	size_t memory_usage() const;
+	size_t mapped_memory() const;
+	bool is_shared() const;
+	const std::string& error() const;
+
+	static std::vector<glm::vec3> get_smooth_normals(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices);
+	static bool has_extension(const std::string& file_name, const std::string& extension);
+	static bool load_triangles(const char* file_name, std::vector<glm::vec3>& positions,
+		std::vector<unsigned int>& indices, std::string& error);
 
 private:
-	void get_smooth_normals();
-
-	triangle** m_triangles;
+	void load_file(const char* file_name);
+	void load_mesh_file(const char* file_name);
+	void build(const glm::vec3* positions, const unsigned int* indices);
+
+	triangle_algorithm m_algorithm;
+	std::vector<moller_record> m_moller_records;
+	std::vector<woop_record> m_woop_records;
+	std::vector<havel_record> m_havel_records;
+	std::vector<glm::vec3> m_vertex_normals;
+	std::unique_ptr<mesh_file> m_file;
+	std::shared_ptr<const mesh> m_geometry; // the mesh whose triangles are used, if shared.
+	std::string m_error; // the reason the file could not be loaded, empty if it was.
+	const void* m_records = nullptr; // the records of m_algorithm, owned, mapped or shared.
+	const glm::vec3* m_normals = nullptr; // the vertex normals, 3 per triangle, owned, mapped or shared.
 	unsigned int m_triangle_count = 0;
 };
 
@@ -75,8 +169,11 @@ private:
 */
 class sphere : public shape {
 public:
-	sphere(glm::vec3 center, float radius, const material& mat);
+	sphere(glm::vec3 center, float radius, unsigned int mat);
 	virtual void intersection(ray* ray);
+	virtual surface get_surface(const ray& ray) const;
+	virtual shape_view get_view() const;
+	virtual bool move_to(const glm::vec3& position);
 
 private:
 	glm::vec3 m_center;
@@ -88,8 +185,11 @@ private:
 */
 class plane : public shape {
 public:
-	plane(glm::vec3 normal, glm::vec3 point, const material& mat);
+	plane(glm::vec3 normal, glm::vec3 point, unsigned int mat);
 	virtual void intersection(ray* ray);
+	virtual surface get_surface(const ray& ray) const;
+	virtual shape_view get_view() const;
+	virtual bool move_to(const glm::vec3& position);
 
 private:
 	glm::vec3 m_normal;
@@ -0,0 +1,404 @@
+#include "stream_socket.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const uintptr_t INVALID_HANDLE = ~(uintptr_t)0;
+
+#ifdef _WIN32
+typedef SOCKET native_socket;
+
+/**
+	Starts Winsock once, for all the sockets.
+*/
+void start_sockets() {
+	struct winsock {
+		winsock() {
+			WSADATA data;
+			WSAStartup(MAKEWORD(2, 2), &data);
+		}
+	};
+	static winsock winsock_;
+}
+
+void close_socket(uintptr_t socket_) {
+	closesocket((native_socket)socket_);
+}
+#else
+typedef int native_socket;
+
+void start_sockets() {}
+
+void close_socket(uintptr_t socket_) {
+	::close((native_socket)socket_);
+}
+#endif
+
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL; // a closed peer fails the send instead of raising SIGPIPE.
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+/**
+	Fills the address of a path.
+
+	@param path the path of the socket.
+	@param address [out] the address.
+	@param error [out] the reason of the failure.
+	@return bool false if the path is too long.
+*/
+bool get_address(const std::string& path, sockaddr_un& address, std::string& error) {
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+		error = "Invalid socket path " + path + ".";
+		return false;
+	}
+	std::memcpy(address.sun_path, path.c_str(), path.size());
+	return true;
+}
+
+}
+
+/**
+	Default constructor. A closed socket.
+*/
+stream_socket::stream_socket() : m_socket(INVALID_HANDLE) {}
+
+/**
+	Destructor. Closes the socket.
+*/
+stream_socket::~stream_socket() {
+	close();
+}
+
+/**
+	Move constructor.
+*/
+stream_socket::stream_socket(stream_socket&& other)
+	:
+	m_socket(other.m_socket),
+	m_buffer(std::move(other.m_buffer)),
+	m_path(std::move(other.m_path))
+{
+	other.m_socket = INVALID_HANDLE;
+	other.m_path.clear();
+}
+
+/**
+	Move assignment. Closes the socket first.
+*/
+stream_socket& stream_socket::operator=(stream_socket&& other) {
+	if (this != &other) {
+		close();
+		m_socket = other.m_socket;
+		m_buffer = std::move(other.m_buffer);
+		m_path = std::move(other.m_path);
+		other.m_socket = INVALID_HANDLE;
+		other.m_path.clear();
+	}
+	return *this;
+}
+
+/**
+	Binds the socket to path and listens for connections.
+
+	A file left at path by a server that is gone is replaced. A path where a
+	server still listens is an error.
+
+	@param path the path of the socket.
+	@param error [out] the reason of the failure.
+	@return bool true if the socket listens.
+*/
+bool stream_socket::listen(const std::string& path, std::string& error) {
+	close();
+	start_sockets();
+	sockaddr_un address;
+	if (!get_address(path, address, error)) return false;
+
+	stream_socket existing;
+	std::string ignored;
+	if (existing.connect(path, ignored)) {
+		error = "A server already listens on " + path + ".";
+		return false;
+	}
+	std::remove(path.c_str());
+
+	native_socket socket_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	m_socket = (uintptr_t)socket_;
+	if (m_socket == INVALID_HANDLE) {
+		error = "Cannot create a socket.";
+		return false;
+	}
+	if (::bind(socket_, (const sockaddr*)&address, sizeof(address)) != 0 || ::listen(socket_, SOMAXCONN) != 0) {
+		error = "Cannot listen on " + path + ".";
+		close();
+		return false;
+	}
+	m_path = path;
+	return true;
+}
+
+/**
+	Waits for a connection on a listening socket.
+
+	@return stream_socket the socket of the connection, closed on failure.
+*/
+stream_socket stream_socket::accept() {
+	stream_socket client;
+	native_socket socket_ = ::accept((native_socket)m_socket, nullptr, nullptr);
+	client.m_socket = (uintptr_t)socket_;
+	if (client.is_open() && m_path.empty()) {
+		int no_delay = 1;
+		::setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, (const char*)&no_delay, sizeof(no_delay));
+	}
+	return client;
+}
+
+/**
+	Connects the socket to a server.
+
+	@param path the path the server listens on.
+	@param error [out] the reason of the failure.
+	@return bool true if the socket is connected.
+*/
+bool stream_socket::connect(const std::string& path, std::string& error) {
+	close();
+	start_sockets();
+	sockaddr_un address;
+	if (!get_address(path, address, error)) return false;
+
+	native_socket socket_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	m_socket = (uintptr_t)socket_;
+	if (m_socket == INVALID_HANDLE || ::connect(socket_, (const sockaddr*)&address, sizeof(address)) != 0) {
+		error = "Cannot connect to " + path + ".";
+		close();
+		return false;
+	}
+	return true;
+}
+
+/**
+	Binds the socket to a TCP port of every interface and listens for
+	connections.
+
+	@param port the port.
+	@param error [out] the reason of the failure.
+	@return bool true if the socket listens.
+*/
+bool stream_socket::listen_tcp(uint16_t port, std::string& error) {
+	close();
+	start_sockets();
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+
+	native_socket socket_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	m_socket = (uintptr_t)socket_;
+	if (m_socket == INVALID_HANDLE) {
+		error = "Cannot create a socket.";
+		return false;
+	}
+	// a port left in TIME_WAIT by a previous server can be bound again.
+	int reuse = 1;
+	::setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+	if (::bind(socket_, (const sockaddr*)&address, sizeof(address)) != 0 || ::listen(socket_, SOMAXCONN) != 0) {
+		error = "Cannot listen on port " + std::to_string(port) + ".";
+		close();
+		return false;
+	}
+	return true;
+}
+
+/**
+	Connects the socket to a TCP server. Small writes are sent at once, without
+	waiting to be coalesced (TCP_NODELAY), as requests and responses alternate.
+
+	@param host the name or address of the server.
+	@param port the port the server listens on.
+	@param error [out] the reason of the failure.
+	@return bool true if the socket is connected.
+*/
+bool stream_socket::connect_tcp(const std::string& host, uint16_t port, std::string& error) {
+	close();
+	start_sockets();
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	addrinfo* addresses = nullptr;
+	if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) {
+		error = "Cannot resolve " + host + ".";
+		return false;
+	}
+
+	for (addrinfo* address = addresses; address; address = address->ai_next) {
+		native_socket socket_ = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		m_socket = (uintptr_t)socket_;
+		if (m_socket == INVALID_HANDLE) continue;
+		if (::connect(socket_, address->ai_addr, (int)address->ai_addrlen) == 0) break;
+		close();
+	}
+	::freeaddrinfo(addresses);
+	if (m_socket == INVALID_HANDLE) {
+		error = "Cannot connect to " + host + ":" + std::to_string(port) + ".";
+		return false;
+	}
+	int no_delay = 1;
+	::setsockopt((native_socket)m_socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&no_delay, sizeof(no_delay));
+	return true;
+}
+
+/**
+	Makes the reads fail once nothing was received for a while, so that a peer
+	that hangs is detected.
+
+	@param milliseconds the time a read waits for data, 0 for ever.
+*/
+void stream_socket::set_timeout(unsigned int milliseconds) {
+#ifdef _WIN32
+	DWORD timeout = milliseconds;
+#else
+	timeval timeout;
+	timeout.tv_sec = milliseconds / 1000;
+	timeout.tv_usec = (milliseconds % 1000) * 1000;
+#endif
+	::setsockopt((native_socket)m_socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+}
+
+/**
+	@return bool true if the socket is open.
+*/
+bool stream_socket::is_open() const {
+	return m_socket != INVALID_HANDLE;
+}
+
+/**
+	Reads a line, without its end of line.
+
+	@param line [out] the line.
+	@return bool false at the end of the stream, on failure, or if the line is
+	longer than SOCKET_MAX_LINE.
+*/
+bool stream_socket::read_line(std::string& line) {
+	size_t end;
+	size_t searched = 0; // the bytes of m_buffer that have no end of line.
+	while ((end = m_buffer.find('\n', searched)) == std::string::npos) {
+		searched = m_buffer.size();
+		if (searched > SOCKET_MAX_LINE) return false;
+		char data[4096];
+		int count = (int)::recv((native_socket)m_socket, data, sizeof(data), 0);
+		if (count <= 0) return false;
+		m_buffer.append(data, (size_t)count);
+	}
+	if (end > SOCKET_MAX_LINE) return false;
+	line.assign(m_buffer, 0, end);
+	if (!line.empty() && line.back() == '\r') line.pop_back();
+	m_buffer.erase(0, end + 1);
+	return true;
+}
+
+/**
+	Reads size bytes, such as the binary data that follows a line.
+
+	@param data [out] the bytes.
+	@param size the number of bytes.
+	@return bool false if the stream ended before, or on failure.
+*/
+bool stream_socket::read(void* data, size_t size) {
+	char* bytes = (char*)data;
+	size_t buffered = std::min(size, m_buffer.size());
+	std::memcpy(bytes, m_buffer.data(), buffered);
+	m_buffer.erase(0, buffered);
+	for (size_t read = buffered; read < size;) {
+		int count = (int)::recv((native_socket)m_socket, bytes + read, (int)std::min<size_t>(size - read, 1 << 30), 0);
+		if (count <= 0) return false;
+		read += (size_t)count;
+	}
+	return true;
+}
+
+/**
+	Writes all the bytes of data.
+
+	@param data the bytes.
+	@return bool false if the peer is gone.
+*/
+bool stream_socket::write(const std::string& data) {
+	return write(data.data(), data.size());
+}
+
+/**
+	Writes all the bytes of data.
+
+	@param data the bytes.
+	@param size the number of bytes.
+	@return bool false if the peer is gone.
+*/
+bool stream_socket::write(const void* data, size_t size) {
+	const char* bytes = (const char*)data;
+	size_t written = 0;
+	while (written < size) {
+		int count = (int)::send((native_socket)m_socket, bytes + written, (int)std::min<size_t>(size - written, 1 << 30), SEND_FLAGS);
+		if (count <= 0) return false;
+		written += (size_t)count;
+	}
+	return true;
+}
+
+/**
+	Tells the peer that nothing more will be written. The socket can still read.
+*/
+void stream_socket::shutdown_write() {
+#ifdef _WIN32
+	::shutdown((native_socket)m_socket, SD_SEND);
+#else
+	::shutdown((native_socket)m_socket, SHUT_WR);
+#endif
+}
+
+/**
+	Stops the reads and writes of the socket, which wakes up a thread that waits
+	to read it. May be called from any thread, while the socket is open.
+*/
+void stream_socket::shutdown() {
+#ifdef _WIN32
+	::shutdown((native_socket)m_socket, SD_BOTH);
+#else
+	::shutdown((native_socket)m_socket, SHUT_RDWR);
+#endif
+}
+
+/**
+	Closes the socket, and removes the path of a listening socket.
+*/
+void stream_socket::close() {
+	if (m_socket != INVALID_HANDLE) close_socket(m_socket);
+	m_socket = INVALID_HANDLE;
+	m_buffer.clear();
+	if (!m_path.empty()) std::remove(m_path.c_str());
+	m_path.clear();
+}
@@ -0,0 +1,46 @@
+/**
+	The stream_socket class is a stream socket: either bound to a path of the file
+	system, a Unix domain socket, to serve and send requests on the same machine,
+	or a TCP socket, to talk to other machines. On Windows, Unix domain sockets
+	need Windows 10 or later.
+
+	Requests and responses are lines of text, see read_line(), that can be
+	followed by binary data, see read().
+*/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// the longest line read_line() accepts, in bytes, so that a peer cannot make it buffer without end.
+#define SOCKET_MAX_LINE (1 << 16)
+
+class stream_socket {
+public:
+	stream_socket();
+	~stream_socket();
+	stream_socket(stream_socket&& other);
+	stream_socket& operator=(stream_socket&& other);
+	stream_socket(const stream_socket&) = delete;
+	stream_socket& operator=(const stream_socket&) = delete;
+
+	bool listen(const std::string& path, std::string& error);
+	stream_socket accept();
+	bool connect(const std::string& path, std::string& error);
+	bool listen_tcp(uint16_t port, std::string& error);
+	bool connect_tcp(const std::string& host, uint16_t port, std::string& error);
+	void set_timeout(unsigned int milliseconds);
+	bool is_open() const;
+	bool read_line(std::string& line);
+	bool read(void* data, size_t size);
+	bool write(const std::string& data);
+	bool write(const void* data, size_t size);
+	void shutdown_write();
+	void shutdown();
+	void close();
+
+private:
+	uintptr_t m_socket; // the socket or file descriptor.
+	std::string m_buffer; // the bytes read past the last line.
+	std::string m_path; // the path bound by listen(), removed by close().
+};
@@ -0,0 +1,128 @@
+#include "thread_pool.h"
+#include "event_trace.h"
+#include <algorithm>
+
+/**
+	Parameterized constructor.
+
+	@param thread_count [optional] the number of threads, 0 for one per core.
+*/
+thread_pool::thread_pool(unsigned int thread_count) {
+	if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned int i = 0; i < thread_count; i++) {
+		m_threads.push_back(std::thread(&thread_pool::work, this));
+	}
+}
+
+/**
+	Finishes the queued tasks and joins the threads.
+*/
+thread_pool::~thread_pool() {
+	wait();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_task_ready.notify_all();
+	for (std::thread& thread : m_threads) {
+		thread.join();
+	}
+}
+
+/**
+	Queues a task. Can be called from a task.
+
+	@param task the task to run on one of the threads.
+	@param priority [optional] the priority of the task, higher first.
+*/
+void thread_pool::submit(std::function<void()> task, int priority) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks[priority].push_back(std::move(task));
+		m_pending++;
+	}
+	m_task_ready.notify_one();
+}
+
+/**
+	Waits until every task has finished. Must not be called from a task.
+*/
+void thread_pool::wait() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_all_done.wait(lock, [this] { return m_pending == 0; });
+}
+
+/**
+	@return unsigned int the number of threads.
+*/
+unsigned int thread_pool::thread_count() const {
+	return (unsigned int)m_threads.size();
+}
+
+/**
+	The loop of every thread: runs the queued tasks until the pool stops.
+*/
+void thread_pool::work() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		if (!m_stop && m_tasks.empty()) {
+			// the time the thread had no task, see event_trace.
+			scoped_event event("idle", "scheduler");
+			m_task_ready.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+		}
+		if (m_tasks.empty()) return;
+
+		auto first = m_tasks.begin();
+		std::function<void()> task = std::move(first->second.front());
+		first->second.pop_front();
+		if (first->second.empty()) m_tasks.erase(first);
+		lock.unlock();
+		task();
+		lock.lock();
+
+		if (--m_pending == 0) m_all_done.notify_all();
+	}
+}
+
+/**
+	Parameterized constructor.
+
+	@param pool the thread pool the tasks run on.
+	@param priority [optional] the priority of the tasks in the pool.
+*/
+task_group::task_group(thread_pool& pool, int priority) : m_pool(pool), m_priority(priority) {}
+
+/**
+	Waits for the tasks of the group.
+*/
+task_group::~task_group() {
+	wait();
+}
+
+/**
+	Queues a task of the group. Can be called from a task.
+
+	@param task the task to run on one of the threads of the pool.
+*/
+void task_group::submit(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending++;
+	}
+	m_pool.submit([this, task] {
+		task();
+		// notified under the lock, as the group may be destroyed once wait() returns.
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_pending == 0) m_all_done.notify_all();
+	}, m_priority);
+}
+
+/**
+	Waits until every task of the group has finished. Must not be called from a
+	task of the pool.
+*/
+void task_group::wait() {
+	scoped_event event("wait", "scheduler");
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_all_done.wait(lock, [this] { return m_pending == 0; });
+}
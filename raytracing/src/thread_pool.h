@@ -0,0 +1,63 @@
+/**
+	The thread_pool class runs tasks on a fixed set of threads.
+
+	Tasks may submit more tasks, which is how a task graph is expressed: a task
+	submits the tasks that depend on it when it finishes. wait() returns once
+	every task, including the ones submitted by other tasks, has finished.
+
+	Tasks of higher priority run first, and tasks of the same priority run in
+	the order they were submitted.
+*/
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class thread_pool {
+public:
+	thread_pool(unsigned int thread_count = 0);
+	~thread_pool();
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	void submit(std::function<void()> task, int priority = 0);
+	void wait();
+	unsigned int thread_count() const;
+
+private:
+	void work();
+
+	std::vector<std::thread> m_threads;
+	std::map<int, std::deque<std::function<void()>>, std::greater<int>> m_tasks; // the queued tasks by priority.
+	std::mutex m_mutex;
+	std::condition_variable m_task_ready;
+	std::condition_variable m_all_done;
+	size_t m_pending = 0; // the tasks queued or running.
+	bool m_stop = false;
+};
+
+/**
+	The task_group class submits tasks to a thread pool that is shared with
+	other groups, and waits for its own tasks only.
+*/
+class task_group {
+public:
+	task_group(thread_pool& pool, int priority = 0);
+	~task_group();
+	task_group(const task_group&) = delete;
+	task_group& operator=(const task_group&) = delete;
+
+	void submit(std::function<void()> task);
+	void wait();
+
+private:
+	thread_pool& m_pool;
+	int m_priority;
+	std::mutex m_mutex;
+	std::condition_variable m_all_done;
+	size_t m_pending = 0; // the tasks of the group queued or running.
+};
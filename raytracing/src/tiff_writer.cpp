@@ -0,0 +1,170 @@
+#include "tiff_writer.h"
+
+// the types of the fields of the directory.
+#define TIFF_SHORT 3
+#define TIFF_LONG 4
+#define TIFF_LONG8 16
+
+/**
+	Appends a value to a buffer, little endian.
+
+	@param buffer the buffer.
+	@param value the value.
+	@param size the size of the value in bytes.
+*/
+static void append(std::vector<unsigned char>& buffer, uint64_t value, int size) {
+	for (int i = 0; i < size; i++) {
+		buffer.push_back((unsigned char)(value >> (8 * i)));
+	}
+}
+
+/**
+	Appends an entry of the directory whose values fit in the entry.
+
+	@param buffer the directory.
+	@param tag the tag of the field.
+	@param type the type of the values.
+	@param values the values.
+	@param count the number of values.
+*/
+static void append_entry(std::vector<unsigned char>& buffer, uint16_t tag, uint16_t type, const uint64_t* values, uint64_t count) {
+	int size = type == TIFF_SHORT ? 2 : type == TIFF_LONG ? 4 : 8;
+	append(buffer, tag, 2);
+	append(buffer, type, 2);
+	append(buffer, count, 8);
+	for (uint64_t i = 0; i < count; i++) append(buffer, values[i], size);
+	for (uint64_t i = count * size; i < 8; i++) buffer.push_back(0);
+}
+
+/**
+	Appends an entry of the directory whose values are stored elsewhere in the file.
+
+	@param buffer the directory.
+	@param tag the tag of the field.
+	@param type the type of the values.
+	@param count the number of values.
+	@param offset the offset of the values in the file.
+*/
+static void append_entry_at(std::vector<unsigned char>& buffer, uint16_t tag, uint16_t type, uint64_t count, uint64_t offset) {
+	append(buffer, tag, 2);
+	append(buffer, type, 2);
+	append(buffer, count, 8);
+	append(buffer, offset, 8);
+}
+
+/**
+	Parameterized constructor.
+
+	Writes the header. The offset of the directory is set by finish().
+
+	@param file_name the .tif file to write.
+	@param width the width of the image in pixels.
+	@param height the height of the image in pixels.
+	@param tile_size the side of the tiles in pixels, a multiple of 16.
+*/
+tiff_writer::tiff_writer(const std::string& file_name, uint32_t width, uint32_t height, uint32_t tile_size)
+	:
+	tile_writer(width, height, tile_size),
+	m_file_name(file_name),
+	m_file(file_name, std::ios::binary)
+{
+	if (!m_file) {
+		m_error = "Cannot write " + file_name + ".";
+		return;
+	}
+	m_offsets.assign(tiles_across() * tiles_down(), 0);
+
+	std::vector<unsigned char> header = { 'I', 'I', 43, 0 };
+	append(header, 8, 2); // the size of the offsets.
+	append(header, 0, 2);
+	append(header, 0, 8); // the offset of the directory.
+	m_file.write((const char*)header.data(), header.size());
+}
+
+/**
+	Writes a tile at the end of the file. Tiles of the last row and column are
+	padded with black to the full tile size, as TIFF requires.
+
+	@param tile_ the tile.
+	@return bool false if the file could not be written.
+*/
+bool tiff_writer::write(const tile& tile_) {
+	m_buffer.assign((size_t)m_tile_size * m_tile_size * 3, 0);
+	for (uint32_t y = 0; y < tile_.m_height; y++) {
+		unsigned char* pixel = &m_buffer[(size_t)y * m_tile_size * 3];
+		for (uint32_t x = 0; x < tile_.m_width; x++) {
+			glm::vec3 color = tile_.color(x, y);
+			*pixel++ = to_byte(color.x);
+			*pixel++ = to_byte(color.y);
+			*pixel++ = to_byte(color.z);
+		}
+	}
+
+	m_offsets[tile_.m_index] = (uint64_t)m_file.tellp();
+	m_file.write((const char*)m_buffer.data(), m_buffer.size());
+	if (!m_file) m_error = "Cannot write " + m_file_name + ".";
+	return m_error.empty();
+}
+
+/**
+	Writes the offsets of the tiles and the directory of the image, and points
+	the header to the directory.
+
+	@return bool false if a tile is missing or the file could not be written.
+*/
+bool tiff_writer::finish() {
+	if (!m_error.empty()) return false;
+	for (uint64_t offset : m_offsets) {
+		if (offset == 0) {
+			m_error = m_file_name + ": missing tiles.";
+			return false;
+		}
+	}
+
+	// the offsets and sizes of the tiles, if they do not fit in their entries.
+	uint64_t tile_count = m_offsets.size();
+	uint64_t tile_bytes = (uint64_t)m_tile_size * m_tile_size * 3;
+	uint64_t offsets_at = 0, sizes_at = 0;
+	if (tile_count > 1) {
+		std::vector<unsigned char> arrays;
+		for (uint64_t offset : m_offsets) append(arrays, offset, 8);
+		for (uint64_t i = 0; i < tile_count; i++) append(arrays, tile_bytes, 8);
+		offsets_at = (uint64_t)m_file.tellp();
+		sizes_at = offsets_at + tile_count * 8;
+		m_file.write((const char*)arrays.data(), arrays.size());
+	}
+
+	const uint64_t bits[] = { 8, 8, 8 };
+	const uint64_t width = m_width, height = m_height, tile_size = m_tile_size, one = 1, rgb = 2, three = 3;
+	std::vector<unsigned char> directory;
+	append(directory, 11, 8);
+	append_entry(directory, 256, TIFF_LONG, &width, 1);
+	append_entry(directory, 257, TIFF_LONG, &height, 1);
+	append_entry(directory, 258, TIFF_SHORT, bits, 3);
+	append_entry(directory, 259, TIFF_SHORT, &one, 1); // no compression.
+	append_entry(directory, 262, TIFF_SHORT, &rgb, 1);
+	append_entry(directory, 277, TIFF_SHORT, &three, 1);
+	append_entry(directory, 284, TIFF_SHORT, &one, 1); // interleaved channels.
+	append_entry(directory, 322, TIFF_LONG, &tile_size, 1);
+	append_entry(directory, 323, TIFF_LONG, &tile_size, 1);
+	if (tile_count > 1) {
+		append_entry_at(directory, 324, TIFF_LONG8, tile_count, offsets_at);
+		append_entry_at(directory, 325, TIFF_LONG8, tile_count, sizes_at);
+	}
+	else {
+		append_entry(directory, 324, TIFF_LONG8, m_offsets.data(), 1);
+		append_entry(directory, 325, TIFF_LONG8, &tile_bytes, 1);
+	}
+	append(directory, 0, 8); // no next directory.
+
+	uint64_t directory_at = (uint64_t)m_file.tellp();
+	m_file.write((const char*)directory.data(), directory.size());
+	m_file.seekp(8);
+	std::vector<unsigned char> offset;
+	append(offset, directory_at, 8);
+	m_file.write((const char*)offset.data(), offset.size());
+	m_file.close();
+
+	if (!m_file) m_error = "Cannot write " + m_file_name + ".";
+	return m_error.empty();
+}
@@ -0,0 +1,25 @@
+/**
+	The tiff_writer class streams an image to a tiled BigTIFF file.
+
+	Every tile is written as soon as it arrives, in any order, as 8 bit RGB
+	without compression. Only the offsets of the tiles are kept, and written with
+	the directory of the image by finish(). BigTIFF has 64 bit offsets, so the
+	file may exceed 4 GB.
+*/
+#pragma once
+#include "tile_writer.h"
+#include <fstream>
+#include <vector>
+
+class tiff_writer : public tile_writer {
+public:
+	tiff_writer(const std::string& file_name, uint32_t width, uint32_t height, uint32_t tile_size);
+	virtual bool write(const tile& tile_);
+	virtual bool finish();
+
+private:
+	std::string m_file_name;
+	std::ofstream m_file;
+	std::vector<uint64_t> m_offsets; // the offset of every tile in the file, 0 until written.
+	std::vector<unsigned char> m_buffer;
+};
@@ -0,0 +1,36 @@
+/**
+	The tile struct holds a rectangle of the image and its colors.
+
+	The image is rendered one tile at a time, so that a tile can be written out
+	as soon as it is done, and the whole image is never held in memory.
+*/
+#pragma once
+#include "glm/glm/glm.hpp"
+#include "framebuffer.h"
+#include <cstdint>
+
+struct tile {
+	uint64_t m_index; // the index of the tile, in row order.
+	uint32_t m_x; // the column of the upper left pixel.
+	uint32_t m_y; // the row of the upper left pixel.
+	uint32_t m_width;
+	uint32_t m_height;
+	framebuffer m_pixels; // m_width x m_height colors, from 0 to 1.
+
+	/**
+		@return glm::vec3 the color of the pixel (x, y) of the tile.
+	*/
+	glm::vec3 color(uint32_t x, uint32_t y) const {
+		return m_pixels.get(x, y);
+	}
+};
+
+/**
+	Quantizes a color channel to 8 bits, the way the image was always saved.
+
+	@param channel the channel, from 0 to 1.
+	@return unsigned char the channel, from 0 to 255.
+*/
+inline unsigned char to_byte(float channel) {
+	return (unsigned char)glm::clamp(channel * 255.f, 0.f, 255.f);
+}
@@ -0,0 +1,71 @@
+#include "tile_writer.h"
+#include "tiff_writer.h"
+#include "png_writer.h"
+#include <cctype>
+
+/**
+	Parameterized constructor.
+
+	@param width the width of the image in pixels.
+	@param height the height of the image in pixels.
+	@param tile_size the side of the tiles in pixels. The tiles of the last row
+	and column may be smaller.
+*/
+tile_writer::tile_writer(uint32_t width, uint32_t height, uint32_t tile_size)
+	:
+	m_width(width),
+	m_height(height),
+	m_tile_size(tile_size)
+{}
+
+/**
+	@return const std::string& the reason why write() or finish() failed.
+*/
+const std::string& tile_writer::error() const {
+	return m_error;
+}
+
+/**
+	@return uint64_t the number of tiles in a row of the image.
+*/
+uint64_t tile_writer::tiles_across() const {
+	return ((uint64_t)m_width + m_tile_size - 1) / m_tile_size;
+}
+
+/**
+	@return uint64_t the number of tiles in a column of the image.
+*/
+uint64_t tile_writer::tiles_down() const {
+	return ((uint64_t)m_height + m_tile_size - 1) / m_tile_size;
+}
+
+/**
+	Creates the writer of the format given by the extension of file_name: tiled
+	TIFF for .tif and .tiff, PNG for .png.
+
+	@param file_name the image file to write.
+	@param width the width of the image in pixels.
+	@param height the height of the image in pixels.
+	@param tile_size the side of the tiles in pixels.
+	@param error [out] the reason of the failure.
+	@return std::unique_ptr<tile_writer> the writer, or nullptr on failure.
+*/
+std::unique_ptr<tile_writer> open_tile_writer(const std::string& file_name, uint32_t width, uint32_t height,
+	uint32_t tile_size, std::string& error) {
+	std::string extension = file_name.substr(file_name.find_last_of('.') + 1);
+	for (char& c : extension) c = (char)tolower(c);
+
+	std::unique_ptr<tile_writer> writer;
+	if (extension == "tif" || extension == "tiff") writer.reset(new tiff_writer(file_name, width, height, tile_size));
+	else if (extension == "png") writer.reset(new png_writer(file_name, width, height, tile_size));
+	else {
+		error = file_name + ": unknown image format, use .tif or .png.";
+		return nullptr;
+	}
+
+	if (!writer->error().empty()) {
+		error = writer->error();
+		return nullptr;
+	}
+	return writer;
+}
@@ -0,0 +1,35 @@
+/**
+	The tile_writer class is the base of the writers that stream the tiles of an
+	image to a file as they are rendered.
+
+	Tiles may arrive in any order. A writer only keeps the tiles it cannot write
+	yet, so that the memory used stays bounded by the tiles in flight. Writers are
+	not thread safe: a single thread at a time calls write().
+*/
+#pragma once
+#include "tile.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class tile_writer {
+public:
+	tile_writer(uint32_t width, uint32_t height, uint32_t tile_size);
+	virtual ~tile_writer() {}
+
+	virtual bool write(const tile& tile_) = 0;
+	virtual bool finish() = 0;
+	const std::string& error() const;
+
+	uint64_t tiles_across() const;
+	uint64_t tiles_down() const;
+
+protected:
+	uint32_t m_width;
+	uint32_t m_height;
+	uint32_t m_tile_size;
+	std::string m_error;
+};
+
+std::unique_ptr<tile_writer> open_tile_writer(const std::string& file_name, uint32_t width, uint32_t height,
+	uint32_t tile_size, std::string& error);
@@ -0,0 +1,84 @@
+#include "timeline.h"
+#include <algorithm>
+#include <iomanip>
+
+/**
+	Default constructor. Starts the clock.
+*/
+timeline::timeline() : m_start(std::chrono::steady_clock::now()) {}
+
+/**
+	Clears the tasks, and starts the clock again.
+*/
+void timeline::restart() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_events.clear();
+	m_start = std::chrono::steady_clock::now();
+}
+
+/**
+	@return double the time since the timeline was created or restarted, in
+	milliseconds.
+*/
+double timeline::now() const {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+/**
+	Records a task that ran on the calling thread.
+
+	@param name the name of the task.
+	@param start the start time of the task. See now().
+	@param end the end time of the task.
+*/
+void timeline::add(const std::string& name, double start, double end) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_events.push_back({ name, start, end, std::this_thread::get_id() });
+}
+
+/**
+	@param suffix the end of the names of the tasks, such as " normals".
+	@return double the time the tasks with that suffix took, summed over the
+	threads, in milliseconds.
+*/
+double timeline::total(const std::string& suffix) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	double sum = 0.;
+	for (const event& event_ : m_events) {
+		const std::string& name = event_.m_name;
+		if (name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+			sum += event_.m_end - event_.m_start;
+		}
+	}
+	return sum;
+}
+
+/**
+	Prints the tasks in the order they started, one per line, with their start and
+	end times, and the thread they ran on. Threads are numbered in the order they
+	first ran a task.
+
+	@param stream the stream to print to.
+*/
+void timeline::print(std::ostream& stream) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::vector<event> events(m_events);
+	std::stable_sort(events.begin(), events.end(), [](const event& a, const event& b) { return a.m_start < b.m_start; });
+
+	std::ios::fmtflags flags = stream.flags();
+	std::streamsize precision = stream.precision();
+	std::vector<std::thread::id> threads;
+	size_t width = 0;
+	for (const event& event_ : events) width = std::max(width, event_.m_name.size());
+
+	for (const event& event_ : events) {
+		size_t thread = std::find(threads.begin(), threads.end(), event_.m_thread) - threads.begin();
+		if (thread == threads.size()) threads.push_back(event_.m_thread);
+
+		stream << "  " << std::left << std::setw((int)width) << event_.m_name << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(10) << event_.m_start << " -" << std::setw(10) << event_.m_end << " ms"
+			<< "   thread " << thread << std::endl;
+	}
+	stream.flags(flags);
+	stream.precision(precision);
+}
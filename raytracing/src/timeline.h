@@ -0,0 +1,39 @@
+/**
+	The timeline class records when named tasks ran, and on which thread.
+
+	Tasks may be added from any thread. The times are in milliseconds since the
+	timeline was created.
+*/
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class timeline {
+public:
+	timeline();
+
+	void restart();
+	double now() const;
+	void add(const std::string& name, double start, double end);
+	double total(const std::string& suffix) const;
+	void print(std::ostream& stream) const;
+
+private:
+	/**
+		The event struct holds a task that ran.
+	*/
+	struct event {
+		std::string m_name;
+		double m_start;
+		double m_end;
+		std::thread::id m_thread;
+	};
+
+	std::chrono::steady_clock::time_point m_start;
+	mutable std::mutex m_mutex;
+	std::vector<event> m_events;
+};
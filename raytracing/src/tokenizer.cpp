@@ -0,0 +1,134 @@
+#include "tokenizer.h"
+#include "parse.h"
+#include <cstring>
+
+/**
+	@return bool true if c separates words.
+*/
+static bool is_blank(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/**
+	Parameterized constructor.
+
+	@param begin the start of the text.
+	@param end the end of the text, which does not need to be null terminated.
+*/
+tokenizer::tokenizer(const char* begin, const char* end) : m_p(begin), m_end(end) {}
+
+/**
+	Skips the blanks before the next word, counting the lines.
+*/
+void tokenizer::skip_blanks() {
+	while (m_p < m_end && is_blank(*m_p)) {
+		if (*m_p == '\n') m_line++;
+		m_p++;
+	}
+}
+
+/**
+	@return const char* the end of the word at p.
+*/
+const char* tokenizer::word_end(const char* p) const {
+	while (p < m_end && !is_blank(*p)) p++;
+	return p;
+}
+
+/**
+	@return bool true if there is no word left.
+*/
+bool tokenizer::at_end() {
+	skip_blanks();
+	return m_p == m_end;
+}
+
+/**
+	@return size_t the line of the next word, from 1.
+*/
+size_t tokenizer::line() const {
+	return m_line;
+}
+
+/**
+	@return size_t the number of characters left, to check the counts of a file
+	before reserving anything.
+*/
+size_t tokenizer::remaining() const {
+	return m_end - m_p;
+}
+
+/**
+	Reads the next word if it is keyword.
+
+	@param keyword the expected word.
+	@return bool true if the word was keyword. Nothing is read otherwise.
+*/
+bool tokenizer::read_keyword(const char* keyword) {
+	skip_blanks();
+	const char* end = word_end(m_p);
+	size_t size = std::strlen(keyword);
+	if ((size_t)(end - m_p) != size || std::memcmp(m_p, keyword, size) != 0) return false;
+	m_p = end;
+	return true;
+}
+
+/**
+	Reads the next word as a float.
+
+	@param value [out] the number.
+	@return bool true if the word was a number. Nothing is read otherwise.
+*/
+bool tokenizer::read_float(float& value) {
+	skip_blanks();
+	const char* end = parse_float(m_p, m_end, value);
+	if (!end || end != word_end(m_p)) return false;
+	m_p = end;
+	return true;
+}
+
+/**
+	Reads the next three words as the coordinates of a vector.
+
+	@param value [out] the vector.
+	@return bool true if the words were numbers.
+*/
+bool tokenizer::read_vec3(glm::vec3& value) {
+	return read_float(value.x) && read_float(value.y) && read_float(value.z);
+}
+
+/**
+	Reads the next word as an integer.
+
+	@param value [out] the integer.
+	@return bool true if the word was an integer. Nothing is read otherwise.
+*/
+bool tokenizer::read_int(long long& value) {
+	skip_blanks();
+	const char* end = parse_int(m_p, m_end, value);
+	if (!end || end != word_end(m_p)) return false;
+	m_p = end;
+	return true;
+}
+
+/**
+	Reads the next word.
+
+	@param word [out] the word.
+	@return bool false if there is no word left.
+*/
+bool tokenizer::read_word(std::string& word) {
+	skip_blanks();
+	const char* end = word_end(m_p);
+	word.assign(m_p, end);
+	m_p = end;
+	return !word.empty();
+}
+
+/**
+	@return std::string the next word, without reading it. For error messages.
+*/
+std::string tokenizer::peek_word() {
+	skip_blanks();
+	return std::string(m_p, word_end(m_p));
+}
@@ -0,0 +1,34 @@
+/**
+	The tokenizer class reads the words and numbers of a text file in memory.
+
+	Words are separated by spaces, tabs and new lines. Nothing is copied or
+	allocated: words are compared in place, and numbers are parsed in place with
+	the parsers of parse.h. The line of the current word is kept for errors.
+*/
+#pragma once
+#include "glm/glm/glm.hpp"
+#include <cstddef>
+#include <string>
+
+class tokenizer {
+public:
+	tokenizer(const char* begin, const char* end);
+
+	bool at_end();
+	size_t line() const;
+	size_t remaining() const;
+	bool read_keyword(const char* keyword);
+	bool read_float(float& value);
+	bool read_vec3(glm::vec3& value);
+	bool read_int(long long& value);
+	bool read_word(std::string& word);
+	std::string peek_word();
+
+private:
+	void skip_blanks();
+	const char* word_end(const char* p) const;
+
+	const char* m_p;
+	const char* m_end;
+	size_t m_line = 1;
+};
@@ -0,0 +1,99 @@
+#include "triangle_records.h"
+
+/**
+	@param algorithm the triangle intersection algorithm.
+	@return const char* the name of the algorithm as given on the command line.
+*/
+const char* to_string(triangle_algorithm algorithm) {
+	switch (algorithm) {
+	case triangle_algorithm::woop: return "woop";
+	case triangle_algorithm::havel_herout: return "havel";
+	default: return "moller";
+	}
+}
+
+/**
+	Finds the triangle intersection algorithm with the given name.
+
+	@param name the name of the algorithm. See to_string().
+	@param algorithm [out] the algorithm, if found.
+	@return bool true if name is a valid algorithm name.
+*/
+bool from_string(const std::string& name, triangle_algorithm& algorithm) {
+	const triangle_algorithm algorithms[] = {
+		triangle_algorithm::moller_trumbore,
+		triangle_algorithm::woop,
+		triangle_algorithm::havel_herout
+	};
+
+	for (triangle_algorithm algorithm_ : algorithms) {
+		if (name == to_string(algorithm_)) {
+			algorithm = algorithm_;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+	Parameterized constructor.
+
+	@param pos0 the position of the first vertex.
+	@param pos1 the position of the second vertex.
+	@param pos2 the position of the third vertex.
+*/
+moller_record::moller_record(glm::vec3 pos0, glm::vec3 pos1, glm::vec3 pos2)
+	:
+	m_v0(pos0),
+	m_e1(pos1 - pos0),
+	m_e2(pos2 - pos0)
+{}
+
+/**
+	Parameterized constructor.
+
+	The unit triangle space has the edges of the triangle and its normal as basis,
+	and the first vertex as origin. The rows of the record are the rows of the
+	inverse of that transform.
+
+	@param pos0 the position of the first vertex.
+	@param pos1 the position of the second vertex.
+	@param pos2 the position of the third vertex.
+*/
+woop_record::woop_record(glm::vec3 pos0, glm::vec3 pos1, glm::vec3 pos2) {
+	glm::vec3 e1 = pos1 - pos0;
+	glm::vec3 e2 = pos2 - pos0;
+	glm::vec3 normal = glm::cross(e1, e2);
+
+	// degenerate triangle, the transform has no inverse. Zero rows are never hit.
+	if (glm::dot(normal, normal) == 0.f) {
+		m_rows[0] = m_rows[1] = m_rows[2] = glm::vec4(0.f);
+		return;
+	}
+
+	glm::mat3 to_unit = glm::transpose(glm::inverse(glm::mat3(e1, e2, normal)));
+	for (unsigned int i = 0; i < 3; i++) {
+		m_rows[i] = glm::vec4(to_unit[i], -glm::dot(to_unit[i], pos0));
+	}
+}
+
+/**
+	Parameterized constructor.
+
+	@param pos0 the position of the first vertex.
+	@param pos1 the position of the second vertex.
+	@param pos2 the position of the third vertex.
+*/
+havel_record::havel_record(glm::vec3 pos0, glm::vec3 pos1, glm::vec3 pos2) {
+	glm::vec3 e1 = pos1 - pos0;
+	glm::vec3 e2 = pos2 - pos0;
+
+	m_n0 = glm::cross(e1, e2);
+	m_d0 = glm::dot(m_n0, pos0);
+
+	float inv_length2 = 1.f / glm::dot(m_n0, m_n0);
+	m_n1 = glm::cross(e2, m_n0) * inv_length2;
+	m_d1 = -glm::dot(m_n1, pos0);
+	m_n2 = glm::cross(m_n0, e1) * inv_length2;
+	m_d2 = -glm::dot(m_n2, pos0);
+}
@@ -0,0 +1,172 @@
+/**
+	Precomputed triangle records and their ray intersection kernels.
+
+	A mesh transforms its triangles once at load time into one of these records,
+	so that the intersection kernels do not recompute anything per ray.
+*/
+#pragma once
+#include "glm/glm/glm.hpp"
+#include <string>
+
+/**
+	The intersection algorithms a mesh can use for its triangles.
+*/
+enum class triangle_algorithm {
+	moller_trumbore,
+	woop,
+	havel_herout
+};
+
+// the algorithm used when none is given on the command line.
+#ifndef TRIANGLE_ALGORITHM
+#define TRIANGLE_ALGORITHM triangle_algorithm::moller_trumbore
+#endif
+
+#define TRIANGLE_EPSILON 0.0000001f
+
+const char* to_string(triangle_algorithm algorithm);
+bool from_string(const std::string& name, triangle_algorithm& algorithm);
+
+/**
+	The moller_record struct holds the first vertex and the two edges of a triangle.
+*/
+struct moller_record {
+	moller_record(glm::vec3 pos0, glm::vec3 pos1, glm::vec3 pos2);
+
+	glm::vec3 m_v0;
+	glm::vec3 m_e1;
+	glm::vec3 m_e2;
+};
+
+/**
+	The woop_record struct holds the affine transform that maps a triangle to the
+	unit triangle (0, 0, 0), (1, 0, 0), (0, 1, 0).
+
+	Each row is applied as dot(row, (p, 1)) for points and dot(row, (d, 0)) for
+	directions. The third row maps the triangle normal to the z axis.
+*/
+struct woop_record {
+	woop_record(glm::vec3 pos0, glm::vec3 pos1, glm::vec3 pos2);
+
+	glm::vec4 m_rows[3];
+};
+
+/**
+	The havel_record struct holds the plane of a triangle and two planes through
+	its edges, scaled so that they directly give the barycentric coordinates.
+*/
+struct havel_record {
+	havel_record(glm::vec3 pos0, glm::vec3 pos1, glm::vec3 pos2);
+
+	glm::vec3 m_n0;
+	float m_d0;
+	glm::vec3 m_n1;
+	float m_d1;
+	glm::vec3 m_n2;
+	float m_d2;
+};
+
+/**
+	Computes the intersection of a ray with a front-facing triangle.
+
+	MOLLER-TRUMBORE with precomputed edges. The sign of the determinant
+	doubles as the back face test.
+
+	@param record the triangle.
+	@param origin the origin of the ray.
+	@param direction the direction of the ray.
+	@param t [out] the time of intersection.
+	@param u [out] the barycentric coordinate of the hit relative to the second vertex.
+	@param v [out] the barycentric coordinate of the hit relative to the third vertex.
+	@return bool true if the ray hits the triangle.
+*/
+inline bool intersect(const moller_record& record, const glm::vec3& origin, const glm::vec3& direction, float& t, float& u, float& v) {
+	glm::vec3 p = glm::cross(direction, record.m_e2);
+	float d = glm::dot(p, record.m_e1);
+
+	// back face or parallel
+	if (d < TRIANGLE_EPSILON) return false;
+
+	float inv_d = 1.f / d;
+	glm::vec3 s = origin - record.m_v0;
+	u = glm::dot(p, s) * inv_d;
+	if (u < 0.f || u > 1.f) return false;
+
+	glm::vec3 q = glm::cross(s, record.m_e1);
+	v = glm::dot(direction, q) * inv_d;
+	if (v < 0.f || u + v > 1.f) return false;
+
+	t = glm::dot(record.m_e2, q) * inv_d;
+	return t > TRIANGLE_EPSILON;
+}
+
+/**
+	Computes the intersection of a ray with a front-facing triangle.
+
+	WOOP's unit triangle test. The ray is transformed into the space of the
+	unit triangle, where the hit is found with the z = 0 plane.
+
+	@param record the triangle.
+	@param origin the origin of the ray.
+	@param direction the direction of the ray.
+	@param t [out] the time of intersection.
+	@param u [out] the barycentric coordinate of the hit relative to the second vertex.
+	@param v [out] the barycentric coordinate of the hit relative to the third vertex.
+	@return bool true if the ray hits the triangle.
+*/
+inline bool intersect(const woop_record& record, const glm::vec3& origin, const glm::vec3& direction, float& t, float& u, float& v) {
+	const glm::vec4* m = record.m_rows;
+
+	float dz = glm::dot(glm::vec3(m[2]), direction);
+
+	// back face or parallel
+	if (dz > -TRIANGLE_EPSILON) return false;
+
+	float oz = glm::dot(glm::vec3(m[2]), origin) + m[2].w;
+	t = -oz / dz;
+	if (t <= TRIANGLE_EPSILON) return false;
+
+	glm::vec3 p = origin + direction * t;
+	u = glm::dot(glm::vec3(m[0]), p) + m[0].w;
+	if (u < 0.f || u > 1.f) return false;
+
+	v = glm::dot(glm::vec3(m[1]), p) + m[1].w;
+	return v >= 0.f && u + v <= 1.f;
+}
+
+/**
+	Computes the intersection of a ray with a front-facing triangle.
+
+	HAVEL-HEROUT's plane test. The barycentric coordinates are compared against
+	the determinant before dividing, so misses never pay for the division.
+
+	@param record the triangle.
+	@param origin the origin of the ray.
+	@param direction the direction of the ray.
+	@param t [out] the time of intersection.
+	@param u [out] the barycentric coordinate of the hit relative to the second vertex.
+	@param v [out] the barycentric coordinate of the hit relative to the third vertex.
+	@return bool true if the ray hits the triangle.
+*/
+inline bool intersect(const havel_record& record, const glm::vec3& origin, const glm::vec3& direction, float& t, float& u, float& v) {
+	float det = glm::dot(record.m_n0, direction);
+
+	// back face or parallel
+	if (det > -TRIANGLE_EPSILON) return false;
+
+	// every value below is scaled by det, which is negative.
+	float t_ = record.m_d0 - glm::dot(record.m_n0, origin);
+	glm::vec3 p = det * origin + t_ * direction;
+
+	float u_ = glm::dot(record.m_n1, p) + det * record.m_d1;
+	if (u_ > 0.f || u_ < det) return false;
+
+	float v_ = glm::dot(record.m_n2, p) + det * record.m_d2;
+	if (v_ > 0.f || u_ + v_ < det) return false;
+
+	float inv_det = 1.f / det;
+	t = t_ * inv_det;
+	u = u_ * inv_det;
+	v = v_ * inv_det;
+	return t > TRIANGLE_EPSILON;
+}